@@ -7,11 +7,21 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cmath>
+
+namespace {
+    // Rise over run when walking along a unit XZ heading over ground with the given slope
+    // and aspect (downhill direction), both in degrees
+    float gradeAlong(const glm::vec2& heading, float slope, float aspect) {
+        float downhill = glm::radians(aspect);
+        return -std::tan(glm::radians(slope)) * glm::dot(heading, glm::vec2(std::cos(downhill), std::sin(downhill)));
+    }
+}
 
 /// Constructor
 Hiker::Hiker(const std::string& pathFile)
     : pathFile(pathFile), pathVAO(0), pathVBO(0), currentPosition(glm::vec3(0.0f)),
-    maxSlopeAngle(30.0f), progress(0.0f), currentPathIndex(0),
+    maxSlopeAngle(30.0f), progress(0.0f), currentPathIndex(0), pathDirection(1), steepnessRevision(0),
     horizontalScale(1.0f), heightScale(1.0f) {}
 
 // Set horizontal and vertical scales
@@ -20,6 +30,11 @@ void Hiker::setScales(float hScale, float vScale) {
     heightScale = vScale;
 }
 
+// Set the steepest grade the hiker walks
+void Hiker::setMaxSlopeAngle(float degrees) {
+    maxSlopeAngle = degrees;
+}
+
 // Load hiker path data from file and align with terrain
 bool Hiker::loadPathData(const Terrain& terrain) {
     std::ifstream file(pathFile);
@@ -32,20 +47,27 @@ bool Hiker::loadPathData(const Terrain& terrain) {
     float hScale = terrain.getHorizontalScale();
     float vScale = terrain.getHeightScale();
 
+    std::vector<float> pathX, pathZ;
     while (file >> x >> y >> z) {
-        x *= hScale;
-        z *= hScale;
-        y = terrain.getHeightAtPosition(x, z) + 0.1f; // Offset to ensure visibility
-        pathPoints.emplace_back(glm::vec3(x, y, z));
+        pathX.push_back(x * hScale);
+        pathZ.push_back(z * hScale);
     }
     file.close();
 
+    // Drape the whole path onto the terrain in one query
+    std::vector<float> pathHeights(pathX.size());
+    terrain.getHeightsAtPositions(pathX.data(), pathZ.data(), pathX.size(), pathHeights.data());
+    for (size_t i = 0; i < pathX.size(); ++i) {
+        pathPoints.emplace_back(glm::vec3(pathX[i], pathHeights[i] + 0.1f, pathZ[i])); // Offset to ensure visibility
+    }
+
     if (pathPoints.empty()) {
         std::cerr << "ERROR: No path points loaded from file: " << pathFile << std::endl;
         return false;
     }
 
     currentPosition = pathPoints[0];
+    measureSegmentSteepness(terrain);
 
     // Output number of path points
 //    std::cout << "INFO: Number of hiker path points loaded: " << pathPoints.size() << std::endl;
@@ -76,20 +98,32 @@ void Hiker::setupPathVAO() {
 
 // Update hiker's position along the path
 void Hiker::updatePosition(float deltaTime, const Terrain& terrain) {
-    if (currentPathIndex >= pathPoints.size() - 1)
+    if (pathPoints.size() < 2)
         return;
+    if (terrain.getHeightRevision() != steepnessRevision) {
+        measureSegmentSteepness(terrain); // The terrain was edited or reloaded
+    }
 
     glm::vec3 start = pathPoints[currentPathIndex];
     glm::vec3 end = pathPoints[currentPathIndex + 1];
-    float speed = 10.0f; // Adjusted speed for visible movement
-
-    progress += speed * deltaTime / glm::distance(start, end);
-    if (progress > 1.0f) {
-        progress = 0.0f;
-        currentPathIndex++;
-        if (currentPathIndex >= pathPoints.size() - 1) {
-            currentPathIndex = 0; // Loop back to the start
-        }
+    float speed = 10.0f; // Adjusted speed for visible movement on flat ground
+
+    // Tobler's hiking function on the grade under the hiker in the walking direction: fastest
+    // on a gentle descent, slower the steeper the ground gets either way, but never stalled
+    glm::vec2 heading(end.x - start.x, end.z - start.z);
+    if (glm::length(heading) > 0.0f) {
+        float aspect;
+        float slope = terrain.getSlopeAtPosition(currentPosition.x, currentPosition.z, &aspect);
+        float grade = gradeAlong(glm::normalize(heading) * static_cast<float>(pathDirection), slope, aspect);
+        speed *= std::max(std::exp(-3.5f * (std::abs(grade + 0.05f) - 0.05f)), 0.1f);
+    }
+
+    float distance = glm::distance(start, end);
+    progress += pathDirection * (distance > 0.0f ? speed * deltaTime / distance : 1.0f);
+    if (progress > 1.0f || progress < 0.0f) {
+        advanceSegment();
+        start = pathPoints[currentPathIndex];
+        end = pathPoints[currentPathIndex + 1];
     }
 
     glm::vec3 nextPosition = glm::mix(start, end, progress);
@@ -100,6 +134,72 @@ void Hiker::updatePosition(float deltaTime, const Terrain& terrain) {
     currentPosition = nextPosition;
 }
 
+// Forwards the path loops back to the start; backwards it turns around at the start
+void Hiker::advanceSegment() {
+    const size_t segmentCount = pathPoints.size() - 1;
+    size_t nextSegment = 0;
+    int nextDirection = pathDirection;
+    if (pathDirection > 0) {
+        nextSegment = currentPathIndex + 1 < segmentCount ? currentPathIndex + 1 : 0;
+    } else if (currentPathIndex > 0) {
+        nextSegment = currentPathIndex - 1;
+    } else {
+        nextDirection = 1;
+    }
+
+    if (segmentSteepness[nextSegment] <= maxSlopeAngle) {
+        currentPathIndex = nextSegment;
+        pathDirection = nextDirection;
+        progress = nextDirection > 0 ? 0.0f : 1.0f;
+        return;
+    }
+
+    // Refuse the segment: stop at the point just reached and head back the way the hiker came.
+    // If that is too steep as well (after an edit, say) it waits there until the terrain changes.
+    progress = pathDirection > 0 ? 1.0f : 0.0f;
+    if (segmentSteepness[currentPathIndex] <= maxSlopeAngle) {
+        pathDirection = -pathDirection;
+    }
+}
+
+// Samples the slope rasters about once per terrain unit along every segment, all in one batch
+void Hiker::measureSegmentSteepness(const Terrain& terrain) {
+    steepnessRevision = terrain.getHeightRevision();
+    const size_t segmentCount = pathPoints.size() - 1;
+    std::vector<size_t> firstSample(segmentCount + 1, 0);
+    for (size_t i = 0; i < segmentCount; ++i) {
+        float length = glm::length(glm::vec2(pathPoints[i + 1].x - pathPoints[i].x, pathPoints[i + 1].z - pathPoints[i].z));
+        int count = std::clamp(static_cast<int>(std::ceil(length / terrain.getHorizontalScale())) + 1, 2, 256);
+        firstSample[i + 1] = firstSample[i] + count;
+    }
+
+    const size_t sampleCount = firstSample[segmentCount];
+    std::vector<float> xs(sampleCount), zs(sampleCount), slopes(sampleCount), aspects(sampleCount);
+    for (size_t i = 0; i < segmentCount; ++i) {
+        const size_t count = firstSample[i + 1] - firstSample[i];
+        for (size_t k = 0; k < count; ++k) {
+            glm::vec3 position = glm::mix(pathPoints[i], pathPoints[i + 1], static_cast<float>(k) / (count - 1));
+            xs[firstSample[i] + k] = position.x;
+            zs[firstSample[i] + k] = position.z;
+        }
+    }
+    terrain.getSlopesAtPositions(xs.data(), zs.data(), sampleCount, slopes.data(), aspects.data());
+
+    segmentSteepness.assign(segmentCount, 0.0f);
+    for (size_t i = 0; i < segmentCount; ++i) {
+        glm::vec2 run(pathPoints[i + 1].x - pathPoints[i].x, pathPoints[i + 1].z - pathPoints[i].z);
+        if (glm::length(run) <= 0.0f) {
+            continue;
+        }
+        glm::vec2 heading = glm::normalize(run);
+        float steepestGrade = 0.0f;
+        for (size_t k = firstSample[i]; k < firstSample[i + 1]; ++k) {
+            steepestGrade = std::max(steepestGrade, std::abs(gradeAlong(heading, slopes[k], aspects[k])));
+        }
+        segmentSteepness[i] = glm::degrees(std::atan(steepestGrade));
+    }
+}
+
 // Render the hiker's path as a red line
 void Hiker::renderPath(const glm::mat4& view, const glm::mat4& projection, Shader& shader) {
     glDisable(GL_DEPTH_TEST); // Disable depth testing to ensure the path is visible
@@ -32,7 +32,9 @@ public:
     bool loadPathData(const Terrain& terrain);
 
     /**
-     * @brief Updates the hiker's position along the path based on deltaTime.
+     * @brief Updates the hiker's position along the path based on deltaTime. The hiker slows
+     *        down on steep ground, and on reaching a path point turns back rather than walk a
+     *        segment steeper than the maximum slope angle, up or down.
      * @param deltaTime Time elapsed since the last frame.
      * @param terrain Reference to the Terrain object for height alignment.
      */
@@ -64,6 +66,12 @@ public:
      */
     void setScales(float hScale, float vScale);
 
+    /**
+     * @brief Sets the steepest grade the hiker walks, up or down.
+     * @param degrees Maximum slope angle in degrees.
+     */
+    void setMaxSlopeAngle(float degrees);
+
 private:
     std::string pathFile;               ///< Path to the hiker's path data file.
     std::vector<glm::vec3> pathPoints;  ///< Vector of path points.
@@ -72,6 +80,9 @@ private:
     float maxSlopeAngle;                ///< Maximum slope angle the hiker can traverse.
     float progress;                     ///< Progress between two path points.
     size_t currentPathIndex;            ///< Current index in the pathPoints vector.
+    int pathDirection;                  ///< 1 while walking the path forwards, -1 while walking it back.
+    std::vector<float> segmentSteepness; ///< Steepest grade of each path segment, up or down, in degrees.
+    unsigned int steepnessRevision;     ///< Terrain height revision segmentSteepness was measured on.
 
     float horizontalScale; ///< Horizontal scaling factor to align with terrain.
     float heightScale;     ///< Vertical scaling factor to align with terrain.
@@ -80,6 +91,18 @@ private:
      * @brief Sets up the VAO and VBO for the hiker's path.
      */
     void setupPathVAO();
+
+    /**
+     * @brief Moves on from the path point just reached: into the next segment, back along the
+     *        last one if the next is too steep, or nowhere if both are.
+     */
+    void advanceSegment();
+
+    /**
+     * @brief Fills segmentSteepness from the terrain's slope rasters with one batch query.
+     * @param terrain Reference to the Terrain object for slope queries.
+     */
+    void measureSegmentSteepness(const Terrain& terrain);
 };
 
 #endif // HIKER_H
@@ -7,10 +7,24 @@
 #include <iostream>
 #include <cmath>
 
+namespace {
+    const char* const terrainPath = "/Users/sumaia/Desktop/triangle/triangle/resources/graydata.png";
+
+    /// Longest side, in samples, of the preview grid shown while the full terrain loads.
+    const int terrainPreviewResolution = 256;
+}
+
 
 // Constructor
 HikingSimulator::HikingSimulator()
     : terrain(),
+    previewState(PrepareState::Pending),
+    terrainState(PrepareState::Pending),
+    terrainMapped(false),
+    previewShown(false),
+    terrainShown(false),
+    terrainFailed(false),
+    skyboxLoaded(false),
     hiker("/Users/sumaia/Desktop/triangle/triangle/resources/hiker_path.txt"),
       windowWidth(1280),
       windowHeight(720),
@@ -28,41 +42,118 @@ void HikingSimulator::setWindowDimensions(int width, int height) {
 
 bool HikingSimulator::initialize() {
     std::cout << "INFO: Initializing HikingSimulator..." << std::endl;
+    setupProjection();
 
-    // Load terrain data
-    if (!terrain.loadTerrainData("/Users/sumaia/Desktop/triangle/triangle/resources/graydata.png")) {
-        std::cerr << "ERROR: Failed to load terrain heightmap!" << std::endl;
+    // The sky is drawn from the first frame, so it is loaded before the terrain
+    skyboxLoaded = Skybox::getInstance().initialize("/Users/sumaia/Desktop/triangle/triangle/textures/skybox");
+    if (!skyboxLoaded) {
+        std::cerr << "WARNING: Failed to load the skybox, drawing without it" << std::endl;
+    }
+
+    // Initialize path shader
+    pathShader = std::make_unique<Shader>("/Users/sumaia/Desktop/triangle/triangle/shaders/hikerVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/hikerFrag.glsl");
+    if (!pathShader->isLoaded()) {
+        std::cerr << "ERROR: Failed to load path hiker shader during initialization." << std::endl;
         return false;
     }
+
+    // Decoding and mesh building run on the loader thread; updateTerrainLoad maps the vertex
+    // buffer for it to fill and uploads the rest on this thread. Shaders are compiled here
+    // since the loader has no context.
+    // The preview is cut from the full terrain's grid as soon as that is decoded or mapped
+    // from the cache, so the image is read once and a warm cache is never bypassed.
+    previewTerrain = std::make_unique<Terrain>();
+    previewTerrain->setHeightScale(terrain.getHeightScale());
+    previewTerrain->setHorizontalScale(terrain.getHorizontalScale());
+    previewTerrain->setPreviewResolution(terrainPreviewResolution);
+    terrainLoader = std::thread([this] {
+        bool prepared = terrain.prepareTerrainData(terrainPath, [this](const float* heights) {
+            previewState = previewTerrain->preparePreviewData(terrain, heights) ? PrepareState::Prepared : PrepareState::Failed;
+        });
+        terrainState = prepared ? PrepareState::Prepared : PrepareState::Failed;
+    });
+
+    std::cout << "INFO: HikingSimulator initialized; loading terrain in the background." << std::endl;
+    return true;
+}
+
+// Called once per frame. The full terrain replaces the preview as soon as it is ready, and
+// the preview is skipped if the full terrain is ready first.
+void HikingSimulator::updateTerrainLoad() {
+    if (terrainShown || terrainFailed) {
+        return;
+    }
+
+    PrepareState state = terrainState;
+    if (state == PrepareState::Pending) {
+        // The loader is done with the preview once its state is set
+        if (previewTerrain && !previewShown && previewState != PrepareState::Pending) {
+            if (previewState == PrepareState::Prepared && previewTerrain->finishTerrainData()) {
+                previewShown = true;
+                setupMatrices(*previewTerrain);
+            } else {
+                std::cerr << "WARNING: Failed to load the terrain preview" << std::endl;
+                previewTerrain->cleanup();
+                previewTerrain.reset();
+            }
+        }
+        return;
+    }
+
+    terrainLoader.join();
+    if (state == PrepareState::Prepared && !terrainMapped && terrain.mapVertexBuffer()) {
+        // The loader writes the vertices straight into the mapped buffer while frames go on
+        terrainMapped = true;
+        terrainState = PrepareState::Pending;
+        terrainLoader = std::thread([this] {
+            terrain.fillVertexBuffer();
+            terrainState = PrepareState::Prepared;
+        });
+        return;
+    }
+    if (previewTerrain) {
+        previewTerrain->cleanup();
+        previewTerrain.reset();
+    }
+    if (state == PrepareState::Failed || !terrain.finishTerrainData()) {
+        std::cerr << "ERROR: Failed to load terrain heightmap!" << std::endl;
+        terrainFailed = true;
+        return;
+    }
     hiker.setScales(terrain.getHorizontalScale(), terrain.getHeightScale());
-    setupMatrices();
+    if (!previewShown) {
+        setupMatrices(terrain);
+    }
 
     // Load hiker path data
     if (!hiker.loadPathData(terrain)) {
         std::cerr << "ERROR: Failed to load hiker path!" << std::endl;
-          return false;
-      }
-      else {
-          std::cout << "INFO: Hiker path loaded successfully." << std::endl;
-      }
-  
-      // Initialize path shader
-      pathShader = std::make_unique<Shader>("/Users/sumaia/Desktop/triangle/triangle/shaders/hikerVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/hikerFrag.glsl");
-      if (!pathShader->isLoaded()) {
-          std::cerr << "ERROR: Failed to load path hiker shader during initialization." << std::endl;
-          return false;
-      }
-    std::cout << "INFO: HikingSimulator initialized successfully." << std::endl;
-    return true;
+        terrainFailed = true;
+        return;
+    }
+    std::cout << "INFO: Hiker path loaded successfully." << std::endl;
+    terrainShown = true;
 }
-void HikingSimulator::setupMatrices() {
+
+// The preview until the full terrain is ready, or nothing before either is
+Terrain* HikingSimulator::getShownTerrain() {
+    if (terrainShown) {
+        return &terrain;
+    }
+    return previewShown && previewTerrain ? previewTerrain.get() : nullptr;
+}
+
+void HikingSimulator::setupProjection() {
     float aspectRatio = static_cast<float>(windowWidth) / static_cast<float>(windowHeight);
 //    projectionMatrix = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 20000.0f);
     projectionMatrix = glm::perspective(glm::radians(45.0f), aspectRatio, 1.0f, 50000.0f);
+}
 
+void HikingSimulator::setupMatrices(const Terrain& shown) {
+    setupProjection();
 
-    float terrainWidth = terrain.getWidth() * terrain.getHorizontalScale();
-    float terrainHeight = terrain.getHeight() * terrain.getHorizontalScale();
+    float terrainWidth = shown.getWidth() * shown.getHorizontalScale();
+    float terrainHeight = shown.getHeight() * shown.getHorizontalScale();
 
     cameraPosition = glm::vec3(
         terrainWidth / 2.0f,   // Center X
@@ -97,37 +188,55 @@ void HikingSimulator::setupMatrices() {
 
 void HikingSimulator::render(float deltaTime) {
     glEnable(GL_DEPTH_TEST);
-    
-    hiker.updatePosition(deltaTime, terrain);
-    
-    // Set uniforms for lighting and view projection matrices
-    terrain.getShader().use();
-    terrain.getShader().setVec3("lightPos", glm::vec3(0.0f, 200.0f, 0.0f));
-    terrain.getShader().setMat4("view", viewMatrix);
-    terrain.getShader().setMat4("projection", projectionMatrix);
-    terrain.getShader().setMat4("model", modelMatrix);
-    terrain.getShader().setVec3("viewPos", cameraPosition);
-//    terrain.getShader().setFloat("maxHeight", terrain.getHeightScale() * 255.0f * 3.0f); // Adjusted for height amplification
-    // Corrected maxHeight
-    float maxHeight = terrain.getHeightScale() * 255.0f * 3.0f; // Multiply by 3.0f
-    terrain.getShader().setFloat("maxHeight", maxHeight);
-
-    
-    // Render terrain
-    terrain.render(modelMatrix, viewMatrix, projectionMatrix, cameraPosition);
-    
+    updateTerrainLoad();
+
+    Terrain* shown = getShownTerrain();
+    if (shown) {
+        if (terrainShown) {
+            hiker.updatePosition(deltaTime, terrain);
+        }
+
+        // Set uniforms for lighting and view projection matrices
+        Shader& shader = shown->getShader();
+        shader.use();
+        shader.setVec3("lightPos", glm::vec3(0.0f, 200.0f, 0.0f));
+        shader.setMat4("view", viewMatrix);
+        shader.setMat4("projection", projectionMatrix);
+        shader.setMat4("model", modelMatrix);
+        shader.setVec3("viewPos", cameraPosition);
+//        shader.setFloat("maxHeight", terrain.getHeightScale() * 255.0f * 3.0f); // Adjusted for height amplification
+        // Corrected maxHeight
+        float maxHeight = shown->getHeightScale() * 255.0f * 3.0f; // Multiply by 3.0f
+        shader.setFloat("maxHeight", maxHeight);
+
+        // Render terrain
+        shown->render(modelMatrix, viewMatrix, projectionMatrix, cameraPosition);
+    }
+
     // Render hiker path
-    if (pathShader && pathShader->isLoaded()) {
-        hiker.renderPath(viewMatrix, projectionMatrix, *pathShader);
-    } else {
-        std::cerr << "ERROR: Path shader not loaded." << std::endl;
-    }
-    
-    
-    // Render seasonal effects and skybox if applicable
+    if (terrainShown) {
+        if (pathShader && pathShader->isLoaded()) {
+            hiker.renderPath(viewMatrix, projectionMatrix, *pathShader);
+        } else {
+            std::cerr << "ERROR: Path shader not loaded." << std::endl;
+        }
+    }
+
+    // Last, so it only fills the pixels the terrain left empty
+    renderSkybox();
+
+    // Render seasonal effects if applicable
         // ...
 }
 
+void HikingSimulator::renderSkybox() {
+    if (!skyboxLoaded) {
+        return;
+    }
+    // Rotation only, so the sky stays at infinity
+    Skybox::getInstance().render(glm::mat4(glm::mat3(viewMatrix)), projectionMatrix);
+}
+
 void HikingSimulator::processCameraInput(GLFWwindow* window, float deltaTime) {
     float cameraSpeed = 500.0f * deltaTime;
 
@@ -140,11 +249,17 @@ void HikingSimulator::processCameraInput(GLFWwindow* window, float deltaTime) {
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         cameraPosition += cameraSpeed * glm::vec3(1.0f, 0.0f, 0.0f);
 
+    // The loading terrain belongs to the loader thread until it is shown
+    const Terrain* shown = getShownTerrain();
+    if (!shown) {
+        return;
+    }
+
     // Update view matrix
     glm::vec3 cameraTarget = glm::vec3(
-        terrain.getWidth() * terrain.getHorizontalScale() / 2.0f,
+        shown->getWidth() * shown->getHorizontalScale() / 2.0f,
         0.0f,
-        terrain.getHeight() * terrain.getHorizontalScale() / 2.0f
+        shown->getHeight() * shown->getHorizontalScale() / 2.0f
     );
     viewMatrix = glm::lookAt(cameraPosition, cameraTarget, glm::vec3(0.0f, 1.0f, 0.0f));
 }
@@ -154,6 +269,14 @@ void HikingSimulator::processCameraInput(GLFWwindow* window, float deltaTime) {
  * @brief Cleans up all resources.
  */
 void HikingSimulator::cleanup() {
+    // The loader cannot be interrupted; wait for the step it is on
+    if (terrainLoader.joinable()) {
+        terrainLoader.join();
+    }
+    if (previewTerrain) {
+        previewTerrain->cleanup();
+        previewTerrain.reset();
+    }
     terrain.cleanup();
     hiker.cleanup();
     Skybox::getInstance().cleanup();
@@ -170,6 +293,9 @@ const glm::mat4& HikingSimulator::getViewMatrix() const { return viewMatrix; }
  * @brief Retrieves the projection matrix.
  */
 const glm::mat4& HikingSimulator::getProjectionMatrix() const { return projectionMatrix; }
+
+bool HikingSimulator::isTerrainLoading() const { return !terrainShown && !terrainFailed; }
+bool HikingSimulator::hasTerrainLoadFailed() const { return terrainFailed; }
 //void checkOpenGLError(const std::string& location) {
 //    GLenum err;
 //    while((err = glGetError()) != GL_NO_ERROR) {
@@ -0,0 +1,299 @@
+#include "cdlodTerrain.h"
+#include <iostream>
+#include <algorithm>
+#include <limits>
+
+void checkOpenGLError(const std::string& location); // Defined in terrain.cpp
+
+namespace {
+    // Distance from a point to an axis-aligned box, zero when inside
+    bool sphereIntersectsBox(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+        glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+        glm::vec3 delta = center - closest;
+        return glm::dot(delta, delta) <= radius * radius;
+    }
+
+    int log2Int(int value) {
+        int result = 0;
+        while ((1 << (result + 1)) <= value) {
+            ++result;
+        }
+        return result;
+    }
+}
+
+// Constructor
+CdlodTerrain::CdlodTerrain()
+    : cdlodShader("/Users/sumaia/Desktop/triangle/triangle/shaders/cdlodVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainFrag.glsl"),
+    patchVAO(0), patchVBO(0), patchEBO(0), instanceVBO(0), heightTexture(0),
+    quadrantIndexCount(0),
+    pyramid(nullptr),
+    gridWidth(0), gridHeight(0), spacing(1.0f), topLevel(0),
+    lodDistance(400.0f) {
+    updateLodRanges();
+}
+
+// Upload heights and build the patch mesh
+bool CdlodTerrain::initialize(const float* heights, int gridWidth, int gridHeight,
+                              float spacing, const HeightPyramid& pyramid) {
+    cleanup();
+
+    this->gridWidth = gridWidth;
+    this->gridHeight = gridHeight;
+    this->spacing = spacing;
+    this->pyramid = &pyramid;
+
+    // Root nodes sit at the pyramid level whose blocks are patchCells << topLevel cells wide
+    int patchPyramidLevel = log2Int(patchCells);
+    topLevel = std::min(maxLodLevels - 1, pyramid.getLevelCount() - 1 - patchPyramidLevel);
+    if (topLevel < 0) {
+        std::cerr << "ERROR: Height grid too small for CDLOD patches of " << patchCells << " cells" << std::endl;
+        return false;
+    }
+    updateLodRanges();
+
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, gridWidth, gridHeight, 0, GL_RED, GL_FLOAT, heights);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkOpenGLError("CdlodTerrain::initialize after height texture upload");
+
+    setupPatchMesh();
+
+    std::cout << "INFO: CDLOD terrain ready (" << (topLevel + 1) << " levels, "
+        << patchCells << " cell patches)" << std::endl;
+    return true;
+}
+
+// One (patchCells + 1)^2 grid in [0, 1]^2, indexed quadrant by quadrant (TL, TR, BL, BR) so
+// a partially covered node can draw only the quarters its children did not take.
+void CdlodTerrain::setupPatchMesh() {
+    const int side = patchCells + 1;
+    const int half = patchCells / 2;
+
+    std::vector<glm::vec2> gridPositions;
+    gridPositions.reserve(side * side);
+    for (int z = 0; z < side; ++z) {
+        for (int x = 0; x < side; ++x) {
+            gridPositions.emplace_back(static_cast<float>(x) / patchCells, static_cast<float>(z) / patchCells);
+        }
+    }
+
+    std::vector<GLushort> patchIndices;
+    patchIndices.reserve(patchCells * patchCells * 6);
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        int x0 = (quadrant % 2) * half;
+        int z0 = (quadrant / 2) * half;
+        for (int z = z0; z < z0 + half; ++z) {
+            for (int x = x0; x < x0 + half; ++x) {
+                GLushort topLeft = static_cast<GLushort>(z * side + x);
+                GLushort topRight = topLeft + 1;
+                GLushort bottomLeft = static_cast<GLushort>((z + 1) * side + x);
+                GLushort bottomRight = bottomLeft + 1;
+
+                patchIndices.push_back(topLeft);
+                patchIndices.push_back(bottomLeft);
+                patchIndices.push_back(topRight);
+                patchIndices.push_back(topRight);
+                patchIndices.push_back(bottomLeft);
+                patchIndices.push_back(bottomRight);
+            }
+        }
+    }
+    quadrantIndexCount = static_cast<GLsizei>(patchIndices.size() / 4);
+
+    glGenVertexArrays(1, &patchVAO);
+    glGenBuffers(1, &patchVBO);
+    glGenBuffers(1, &patchEBO);
+    glGenBuffers(1, &instanceVBO);
+
+    glBindVertexArray(patchVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
+    glBufferData(GL_ARRAY_BUFFER, gridPositions.size() * sizeof(glm::vec2), gridPositions.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, patchIndices.size() * sizeof(GLushort), patchIndices.data(), GL_STATIC_DRAW);
+
+    // Node data advances once per instance
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glVertexAttribDivisor(1, 1);
+
+    glBindVertexArray(0);
+    checkOpenGLError("CdlodTerrain::setupPatchMesh");
+}
+
+// Ranges double per level. Each level morphs into the next coarser one over the last third
+// of its range, so a node is fully morphed by the time its parent replaces it.
+void CdlodTerrain::updateLodRanges() {
+    const float morphStartRatio = 0.66f;
+    float previousRange = 0.0f;
+    for (int level = 0; level < maxLodLevels; ++level) {
+        lodRanges[level] = lodDistance * static_cast<float>(1 << level);
+
+        if (level >= topLevel) {
+            // Root nodes have no coarser level to morph into
+            lodRanges[level] = std::numeric_limits<float>::max();
+            morphConstants[level] = glm::vec2(1.0f, 0.0f);
+            continue;
+        }
+
+        float morphEnd = lodRanges[level];
+        float morphStart = previousRange + (morphEnd - previousRange) * morphStartRatio;
+        morphConstants[level] = glm::vec2(morphEnd / (morphEnd - morphStart), 1.0f / (morphEnd - morphStart));
+        previousRange = morphEnd;
+    }
+}
+
+bool CdlodTerrain::selectNode(int level, int nodeX, int nodeZ, const glm::vec3& localCamera) {
+    const int nodeCells = patchCells << level;
+    float minHeight, maxHeight;
+    if (!pyramid->getMinMax(log2Int(patchCells) + level, nodeX, nodeZ, minHeight, maxHeight)) {
+        return true; // Past the edge of the terrain, nothing to draw
+    }
+
+    float nodeSize = nodeCells * spacing;
+    glm::vec3 boxMin(nodeX * nodeSize, minHeight, nodeZ * nodeSize);
+    glm::vec3 boxMax(boxMin.x + nodeSize, maxHeight, boxMin.z + nodeSize);
+
+    if (!sphereIntersectsBox(localCamera, lodRanges[level], boxMin, boxMax)) {
+        return false;
+    }
+    if (!frustum.intersectsAABB(boxMin, boxMax)) {
+        return true; // Handled: invisible
+    }
+
+    glm::vec4 node(boxMin.x, boxMin.z, nodeSize, static_cast<float>(level));
+    if (level == 0 || !sphereIntersectsBox(localCamera, lodRanges[level - 1], boxMin, boxMax)) {
+        selection[0].push_back(node);
+        return true;
+    }
+
+    // Children take the quarters they can; this node fills in the rest at its own level
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        int childX = nodeX * 2 + (quadrant % 2);
+        int childZ = nodeZ * 2 + (quadrant / 2);
+        if (!selectNode(level - 1, childX, childZ, localCamera)) {
+            selection[1 + quadrant].push_back(node);
+        }
+    }
+    return true;
+}
+
+// Select nodes and draw every group with one instanced call
+void CdlodTerrain::render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                          const glm::vec3& localCamera) {
+    if (!pyramid || !patchVAO) {
+        return;
+    }
+
+    frustum.extractPlanes(projection * view * model);
+    for (auto& group : selection) {
+        group.clear();
+    }
+
+    int rootCells = patchCells << topLevel;
+    int rootsX = (gridWidth - 1 + rootCells - 1) / rootCells;
+    int rootsZ = (gridHeight - 1 + rootCells - 1) / rootCells;
+    for (int z = 0; z < rootsZ; ++z) {
+        for (int x = 0; x < rootsX; ++x) {
+            selectNode(topLevel, x, z, localCamera);
+        }
+    }
+
+    instanceData.clear();
+    for (const auto& group : selection) {
+        instanceData.insert(instanceData.end(), group.begin(), group.end());
+    }
+    if (instanceData.empty()) {
+        return;
+    }
+
+    cdlodShader.setInt("heightMap", 0);
+    cdlodShader.setVec2("terrainSize", glm::vec2((gridWidth - 1) * spacing, (gridHeight - 1) * spacing));
+    cdlodShader.setVec2("heightMapSize", glm::vec2(static_cast<float>(gridWidth), static_cast<float>(gridHeight)));
+    cdlodShader.setFloat("gridDim", static_cast<float>(patchCells));
+    cdlodShader.setVec3("cameraPos", localCamera);
+    for (int level = 0; level < maxLodLevels; ++level) {
+        cdlodShader.setVec2("morphConsts[" + std::to_string(level) + "]", morphConstants[level]);
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glBindVertexArray(patchVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(glm::vec4), instanceData.data(), GL_STREAM_DRAW);
+
+    // Group 0 draws all four quadrants, groups 1-4 draw a single quadrant each
+    size_t firstInstance = 0;
+    for (int group = 0; group < 5; ++group) {
+        GLsizei instances = static_cast<GLsizei>(selection[group].size());
+        if (instances == 0) {
+            continue;
+        }
+        GLsizei count = group == 0 ? quadrantIndexCount * 4 : quadrantIndexCount;
+        size_t indexOffset = group == 0 ? 0 : static_cast<size_t>(quadrantIndexCount) * (group - 1);
+
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)(firstInstance * sizeof(glm::vec4)));
+        glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_SHORT,
+            (void*)(indexOffset * sizeof(GLushort)), instances);
+        firstInstance += instances;
+    }
+    checkOpenGLError("CdlodTerrain::render after glDrawElementsInstanced");
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void CdlodTerrain::updateHeights(const float* heights, int x0, int z0, int width, int height) {
+    if (!heightTexture) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, z0, width, height, GL_RED, GL_FLOAT, heights);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkOpenGLError("CdlodTerrain::updateHeights");
+}
+
+// Cleanup CDLOD resources
+void CdlodTerrain::cleanup() {
+    if (patchVAO) glDeleteVertexArrays(1, &patchVAO);
+    if (patchVBO) glDeleteBuffers(1, &patchVBO);
+    if (patchEBO) glDeleteBuffers(1, &patchEBO);
+    if (instanceVBO) glDeleteBuffers(1, &instanceVBO);
+    if (heightTexture) glDeleteTextures(1, &heightTexture);
+
+    patchVAO = 0;
+    patchVBO = 0;
+    patchEBO = 0;
+    instanceVBO = 0;
+    heightTexture = 0;
+    pyramid = nullptr;
+}
+
+void CdlodTerrain::setLodDistance(float distance) {
+    lodDistance = std::max(distance, 1.0f);
+    updateLodRanges();
+}
+
+// Getters
+Shader& CdlodTerrain::getShader() { return cdlodShader; }
+bool CdlodTerrain::isInitialized() const { return pyramid != nullptr; }
+
+size_t CdlodTerrain::getSelectedNodeCount() const {
+    size_t count = 0;
+    for (const auto& group : selection) {
+        count += group.size();
+    }
+    return count;
+}
@@ -0,0 +1,120 @@
+#ifndef CDLODTERRAIN_H
+#define CDLODTERRAIN_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "frustum.h"
+#include "heightPyramid.h"
+
+/**
+ * @class CdlodTerrain
+ * @brief Continuous distance-dependent LOD renderer for a height grid.
+ *
+ * A min/max quadtree (the HeightPyramid) is walked every frame to select nodes whose
+ * size matches their distance to the camera. Every selected node is drawn as an instance
+ * of one small grid patch; the vertex shader reads heights from a texture and morphs
+ * vertices towards the next coarser level so transitions never pop.
+ */
+class CdlodTerrain {
+public:
+    /**
+     * @brief Constructor.
+     */
+    CdlodTerrain();
+
+    /**
+     * @brief Uploads the height texture and builds the shared patch mesh.
+     * @param heights Row-major height grid in world units.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @param pyramid Min/max pyramid built from the same grid; must outlive this object.
+     * @return True if successful, false otherwise.
+     */
+    bool initialize(const float* heights, int gridWidth, int gridHeight,
+                    float spacing, const HeightPyramid& pyramid);
+
+    /**
+     * @brief Uploads the heights of an edited rectangle. Bounds come from the pyramid, which
+     *        the caller updates.
+     * @param heights Row-major heights of the rectangle, width * height values.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param width Number of columns.
+     * @param height Number of rows.
+     */
+    void updateHeights(const float* heights, int x0, int z0, int width, int height);
+
+    /**
+     * @brief Selects quadtree nodes and draws them. The shader must already be in use with
+     *        the model, view, projection and lighting uniforms set.
+     * @param model Model matrix.
+     * @param view View matrix.
+     * @param projection Projection matrix.
+     * @param localCamera Camera position in terrain (model) space.
+     */
+    void render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                const glm::vec3& localCamera);
+
+    /**
+     * @brief Cleans up OpenGL resources.
+     */
+    void cleanup();
+
+    /**
+     * @brief Sets the distance covered by the finest LOD level; each coarser level doubles it.
+     * @param distance Range of level 0 in world units.
+     */
+    void setLodDistance(float distance);
+
+    // Getters
+    Shader& getShader();
+    bool isInitialized() const;
+    size_t getSelectedNodeCount() const;
+
+private:
+    static const int patchCells = 32;        ///< Cells per side of the instanced grid patch.
+    static const int maxLodLevels = 6;       ///< Quadtree depth below the root nodes.
+
+    Shader cdlodShader;                      ///< Morphing vertex shader with the shared terrain fragment shader.
+    GLuint patchVAO, patchVBO, patchEBO;     ///< Grid patch mesh.
+    GLuint instanceVBO;                      ///< Per-node instance data, refilled every frame.
+    GLuint heightTexture;                    ///< Height grid as a single-channel float texture.
+    GLsizei quadrantIndexCount;              ///< Indices covering one quarter of the patch.
+
+    const HeightPyramid* pyramid;            ///< Node bounds source.
+    int gridWidth, gridHeight;               ///< Dimensions of the height grid.
+    float spacing;                           ///< World distance between samples.
+    int topLevel;                            ///< Level of the root nodes.
+    float lodDistance;                       ///< Range of level 0.
+    float lodRanges[maxLodLevels];           ///< Selection range per level.
+    glm::vec2 morphConstants[maxLodLevels];  ///< Morph start/end terms per level for the shader.
+
+    Frustum frustum;                         ///< Frustum used to reject nodes.
+    std::vector<glm::vec4> selection[5];     ///< Selected nodes (origin x/z, size, level): whole patch, then each quadrant.
+    std::vector<glm::vec4> instanceData;     ///< Selection packed for upload.
+
+    /**
+     * @brief Builds the grid patch with its indices grouped by quadrant.
+     */
+    void setupPatchMesh();
+
+    /**
+     * @brief Recomputes the per-level ranges and morph constants from lodDistance.
+     */
+    void updateLodRanges();
+
+    /**
+     * @brief Recursively selects nodes for drawing.
+     * @param level Quadtree level of the node (0 is finest).
+     * @param nodeX Node column at that level.
+     * @param nodeZ Node row at that level.
+     * @param localCamera Camera position in terrain space.
+     * @return False if the node is beyond its level's range and the parent has to cover it.
+     */
+    bool selectNode(int level, int nodeX, int nodeZ, const glm::vec3& localCamera);
+};
+
+#endif // CDLODTERRAIN_H
@@ -0,0 +1,140 @@
+#ifndef CLIPMAPTERRAIN_H
+#define CLIPMAPTERRAIN_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "heightMips.h"
+
+/**
+ * @class ClipmapTerrain
+ * @brief Geometry clipmap renderer for a height grid.
+ *
+ * The terrain is drawn as nested square grids centred on the camera, each covering twice the
+ * area of the previous one at half its resolution. Every level keeps its window of heights in
+ * one layer of a texture array addressed toroidally (sample x lands in texel x mod size), so
+ * when the camera moves only the rows and columns that entered the window are uploaded. The
+ * vertex shader blends each level into the next coarser one near its outer border, which
+ * keeps the rings crack-free. Draw cost and GPU memory depend on the level count only, not on
+ * the extent of the map.
+ */
+class ClipmapTerrain {
+public:
+    /**
+     * @brief Constructor.
+     */
+    ClipmapTerrain();
+
+    /**
+     * @brief Builds the filtered source levels, the level texture and the ring meshes.
+     * @param heights Row-major height grid in world units.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @param filter Filter used to reduce each level to the next.
+     * @return True if successful, false otherwise.
+     */
+    bool initialize(const float* heights, int gridWidth, int gridHeight, float spacing, HeightFilter filter);
+
+    /**
+     * @brief Replaces the heights of an edited rectangle, refilters the coarser levels under it
+     *        and uploads whatever part of it lies inside the level windows.
+     * @param heights Row-major heights of the rectangle, width * height values.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param width Number of columns.
+     * @param height Number of rows.
+     */
+    void updateHeights(const float* heights, int x0, int z0, int width, int height);
+
+    /**
+     * @brief Moves the level windows to the camera, uploads the samples that entered them and
+     *        draws every active level. The shader must already be in use with the model, view,
+     *        projection and lighting uniforms set.
+     * @param localCamera Camera position in terrain (model) space.
+     */
+    void render(const glm::vec3& localCamera);
+
+    /**
+     * @brief Cleans up OpenGL resources and the source levels.
+     */
+    void cleanup();
+
+    // Getters
+    Shader& getShader();
+    bool isInitialized() const;
+    int getLevelCount() const;
+    size_t getDrawnTriangleCount() const;
+    size_t getUploadedSampleCount() const;
+
+private:
+    static const int clipCells = 128;              ///< Cells per side of every level window (power of two).
+    static const int clipSize = clipCells + 1;     ///< Samples per side of a window and of a texture layer.
+    static const int maxLevels = 12;               ///< Upper bound on the number of levels.
+
+    /// Heights of one level over the whole terrain, each sample the filtered 2x2 block below it.
+    struct SourceLevel {
+        int width, height;
+        std::vector<float> heights;
+    };
+
+    /// Window of one level currently held by its texture layer.
+    struct LevelWindow {
+        glm::ivec2 origin;      ///< First sample of the window, in this level's samples.
+        bool valid;             ///< The layer holds the window at origin.
+    };
+
+    Shader clipmapShader;                    ///< Blending vertex shader with the shared terrain fragment shader.
+    GLuint ringVAO, ringVBO, ringEBO;        ///< Window grid and its index lists.
+    GLuint heightTexture;                    ///< One clipSize x clipSize R32F layer per level.
+    GLsizei ringIndexCounts[5];              ///< Full grid, then the grid around a hole at each of its 4 offsets.
+    size_t ringIndexOffsets[5];              ///< First index of each list.
+
+    std::vector<SourceLevel> sourceLevels;   ///< Filtered height grids, level 0 at full resolution.
+    std::vector<LevelWindow> windows;        ///< Per level texture contents.
+    std::vector<float> uploadBuffer;         ///< Staging for a rectangle of samples.
+    HeightFilter filter;                     ///< Filter used to build the source levels.
+    int gridWidth, gridHeight;               ///< Dimensions of the height grid.
+    float spacing;                           ///< World distance between level 0 samples.
+    size_t drawnTriangles;                   ///< Triangles submitted by the last render.
+    size_t uploadedSamples;                  ///< Samples uploaded by the last render.
+
+    /**
+     * @brief Builds the window grid and its index lists.
+     */
+    void setupRingMesh();
+
+    /**
+     * @brief Window origin of a level for a camera position: the window is centred on the
+     *        camera and starts on an even sample, so its corners lie on the next coarser level.
+     * @param level Clipmap level.
+     * @param localCamera Camera position in terrain space.
+     */
+    glm::ivec2 windowOrigin(int level, const glm::vec3& localCamera) const;
+
+    /**
+     * @brief Moves a level window, uploading only the samples that were not in the old one.
+     * @param level Clipmap level.
+     * @param origin New window origin.
+     */
+    void moveWindow(int level, const glm::ivec2& origin);
+
+    /**
+     * @brief Uploads a rectangle of a level, given in the level's samples and lying inside
+     *        its window, split where it wraps around the texture.
+     * @param level Clipmap level.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param columns Number of columns.
+     * @param rows Number of rows.
+     */
+    void uploadRegion(int level, int x0, int z0, int columns, int rows);
+
+    /**
+     * @brief Source height of a level sample, clamped to the level's grid.
+     */
+    float getSourceHeight(int level, int x, int z) const;
+};
+
+#endif // CLIPMAPTERRAIN_H
@@ -0,0 +1,35 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+/**
+ * @class Frustum
+ * @brief View frustum stored as six planes, used to cull bounding boxes before drawing.
+ */
+class Frustum {
+public:
+    /**
+     * @brief Constructor. The frustum accepts everything until planes are extracted.
+     */
+    Frustum();
+
+    /**
+     * @brief Extracts the six clip planes from a combined projection * view (* model) matrix.
+     * @param viewProjection Matrix that takes the tested coordinates to clip space.
+     */
+    void extractPlanes(const glm::mat4& viewProjection);
+
+    /**
+     * @brief Tests an axis-aligned bounding box against the frustum.
+     * @param boxMin Minimum corner of the box.
+     * @param boxMax Maximum corner of the box.
+     * @return False only if the box is completely outside one of the planes.
+     */
+    bool intersectsAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+private:
+    glm::vec4 planes[6]; ///< Plane equations (normal.xyz, distance.w), normals pointing inwards.
+};
+
+#endif // FRUSTUM_H
@@ -0,0 +1,75 @@
+#ifndef HEIGHTMIPS_H
+#define HEIGHTMIPS_H
+
+#include <string>
+#include <vector>
+
+/// Filters used to build coarser height levels.
+enum class HeightFilter {
+    Point,     ///< Keep every other sample (aliases ridges).
+    Box,       ///< [1 2 1] / 4 tent, the box filter over the linearly interpolated grid.
+    Lanczos    ///< Lanczos-2 at half resolution: sharper, with a slight overshoot at cliffs.
+};
+
+/**
+ * @class HeightMipChain
+ * @brief Height grid and successively halved copies of it.
+ *
+ * Samples sit on grid vertices, so sample i of level L lies on sample i * 2^L of level 0 and
+ * a level has (size - 1) / 2 + 1 samples per side. Each level is filtered from the one above
+ * with a separable kernel: a vertical pass vectorized across the row, then a horizontal pass,
+ * both split across worker threads by rows.
+ */
+class HeightMipChain {
+public:
+    /**
+     * @brief Builds level 0 from a copy of the grid and every coarser level down to a side of 2.
+     * @param heights Row-major height grid.
+     * @param width Number of samples along X.
+     * @param height Number of samples along Z.
+     * @param filter Downsampling filter.
+     * @param levelLimit Stop after this many levels, or 0 for the full chain.
+     */
+    void build(const float* heights, int width, int height, HeightFilter filter, int levelLimit = 0);
+
+    /**
+     * @brief Builds one level at half the resolution of a grid.
+     * @param heights Row-major source grid.
+     * @param width Number of source samples along X.
+     * @param height Number of source samples along Z.
+     * @param filter Downsampling filter.
+     * @param out Receives ((width - 1) / 2 + 1) x ((height - 1) / 2 + 1) samples.
+     */
+    static void downsample(const float* heights, int width, int height, HeightFilter filter, std::vector<float>& out);
+
+    /**
+     * @brief Releases every level.
+     */
+    void clear();
+
+    // Getters
+    int getLevelCount() const;
+    int getWidth(int level) const;
+    int getHeight(int level) const;
+    const float* getLevel(int level) const;
+
+private:
+    struct Level {
+        int width, height;
+        std::vector<float> heights;
+    };
+    std::vector<Level> levels;
+};
+
+/**
+ * @brief Parses a filter name ("point", "box" or "lanczos", any case).
+ * @return True if the name is known.
+ */
+bool parseHeightFilter(const std::string& name, HeightFilter& filter);
+
+/**
+ * @brief Lower-case name of a filter, as accepted by parseHeightFilter.
+ */
+const char* heightFilterName(HeightFilter filter);
+
+#endif // HEIGHTMIPS_H
@@ -0,0 +1,121 @@
+#include "heightPyramid.h"
+#include <algorithm>
+
+// Constructor
+HeightPyramid::HeightPyramid() {}
+
+// Build the per-cell level from the grid corners, then reduce 2x2 blocks until one block is left
+void HeightPyramid::build(const float* heights, int gridWidth, int gridHeight) {
+    levels.clear();
+    if (!heights || gridWidth < 2 || gridHeight < 2) {
+        return;
+    }
+
+    Level base;
+    base.width = gridWidth - 1;
+    base.height = gridHeight - 1;
+    base.minHeights.resize(base.width * base.height);
+    base.maxHeights.resize(base.width * base.height);
+    for (int z = 0; z < base.height; ++z) {
+        const float* row0 = heights + z * gridWidth;
+        const float* row1 = row0 + gridWidth;
+        for (int x = 0; x < base.width; ++x) {
+            float a = row0[x], b = row0[x + 1], c = row1[x], d = row1[x + 1];
+            base.minHeights[z * base.width + x] = std::min(std::min(a, b), std::min(c, d));
+            base.maxHeights[z * base.width + x] = std::max(std::max(a, b), std::max(c, d));
+        }
+    }
+    levels.push_back(std::move(base));
+
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const Level& fine = levels.back();
+        Level coarse;
+        coarse.width = (fine.width + 1) / 2;
+        coarse.height = (fine.height + 1) / 2;
+        coarse.minHeights.resize(coarse.width * coarse.height);
+        coarse.maxHeights.resize(coarse.width * coarse.height);
+
+        for (int z = 0; z < coarse.height; ++z) {
+            for (int x = 0; x < coarse.width; ++x) {
+                reduceBlock(fine, coarse, x, z);
+            }
+        }
+        levels.push_back(std::move(coarse));
+    }
+}
+
+// Only the cells inside the region and their ancestors change; each level's dirty range is
+// the parent range of the one below.
+void HeightPyramid::update(const float* region, int regionX, int regionZ, int regionWidth, int regionHeight) {
+    if (levels.empty() || !region) {
+        return;
+    }
+    Level& base = levels[0];
+    int x0 = std::max(regionX, 0);
+    int z0 = std::max(regionZ, 0);
+    int x1 = std::min(regionX + regionWidth - 1, base.width);
+    int z1 = std::min(regionZ + regionHeight - 1, base.height);
+    if (x0 >= x1 || z0 >= z1) {
+        return;
+    }
+    for (int z = z0; z < z1; ++z) {
+        const float* row0 = region + static_cast<size_t>(z - regionZ) * regionWidth + (x0 - regionX);
+        const float* row1 = row0 + regionWidth;
+        for (int x = x0; x < x1; ++x, ++row0, ++row1) {
+            float a = row0[0], b = row0[1], c = row1[0], d = row1[1];
+            base.minHeights[z * base.width + x] = std::min(std::min(a, b), std::min(c, d));
+            base.maxHeights[z * base.width + x] = std::max(std::max(a, b), std::max(c, d));
+        }
+    }
+
+    for (size_t level = 1; level < levels.size(); ++level) {
+        x0 >>= 1;
+        z0 >>= 1;
+        x1 = std::min(((x1 - 1) >> 1) + 1, levels[level].width);
+        z1 = std::min(((z1 - 1) >> 1) + 1, levels[level].height);
+        for (int z = z0; z < z1; ++z) {
+            for (int x = x0; x < x1; ++x) {
+                reduceBlock(levels[level - 1], levels[level], x, z);
+            }
+        }
+    }
+}
+
+// Odd-sized levels have blocks with only one or two children
+void HeightPyramid::reduceBlock(const Level& fine, Level& coarse, int x, int z) {
+    int fx1 = std::min(2 * x + 1, fine.width - 1);
+    int fz1 = std::min(2 * z + 1, fine.height - 1);
+    int i00 = (2 * z) * fine.width + 2 * x;
+    int i01 = (2 * z) * fine.width + fx1;
+    int i10 = fz1 * fine.width + 2 * x;
+    int i11 = fz1 * fine.width + fx1;
+
+    coarse.minHeights[z * coarse.width + x] = std::min(
+        std::min(fine.minHeights[i00], fine.minHeights[i01]),
+        std::min(fine.minHeights[i10], fine.minHeights[i11]));
+    coarse.maxHeights[z * coarse.width + x] = std::max(
+        std::max(fine.maxHeights[i00], fine.maxHeights[i01]),
+        std::max(fine.maxHeights[i10], fine.maxHeights[i11]));
+}
+
+void HeightPyramid::clear() {
+    levels.clear();
+}
+
+bool HeightPyramid::getMinMax(int level, int x, int z, float& minHeight, float& maxHeight) const {
+    if (level < 0 || level >= static_cast<int>(levels.size())) {
+        return false;
+    }
+    const Level& l = levels[level];
+    if (x < 0 || z < 0 || x >= l.width || z >= l.height) {
+        return false;
+    }
+    minHeight = l.minHeights[z * l.width + x];
+    maxHeight = l.maxHeights[z * l.width + x];
+    return true;
+}
+
+// Getters
+int HeightPyramid::getLevelCount() const { return static_cast<int>(levels.size()); }
+int HeightPyramid::getLevelWidth(int level) const { return levels[level].width; }
+int HeightPyramid::getLevelHeight(int level) const { return levels[level].height; }
@@ -0,0 +1,76 @@
+#ifndef HEIGHTPYRAMID_H
+#define HEIGHTPYRAMID_H
+
+#include <vector>
+
+/**
+ * @class HeightPyramid
+ * @brief Min/max mip pyramid over the cells of a height grid.
+ *
+ * Level 0 holds the lowest and highest corner of every grid cell; each further level
+ * halves the resolution, so a texel at level k bounds a block of 2^k x 2^k cells.
+ */
+class HeightPyramid {
+public:
+    /**
+     * @brief Constructor. The pyramid is empty until build() is called.
+     */
+    HeightPyramid();
+
+    /**
+     * @brief Builds all levels from a row-major height grid.
+     * @param heights Height samples, gridWidth * gridHeight values.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     */
+    void build(const float* heights, int gridWidth, int gridHeight);
+
+    /**
+     * @brief Recomputes the cells of an edited region and the blocks above them.
+     * @param region Row-major heights of regionWidth x regionHeight samples starting at
+     *        grid sample (regionX, regionZ). Every cell with all four corners in the region is
+     *        recomputed, so a region one sample larger than the edit on each side covers it.
+     * @param regionX First column of the region.
+     * @param regionZ First row of the region.
+     * @param regionWidth Number of columns in the region.
+     * @param regionHeight Number of rows in the region.
+     */
+    void update(const float* region, int regionX, int regionZ, int regionWidth, int regionHeight);
+
+    /**
+     * @brief Releases all levels.
+     */
+    void clear();
+
+    /**
+     * @brief Looks up the height range of a block.
+     * @param level Pyramid level; the block covers 2^level cells per side.
+     * @param x Block column at that level.
+     * @param z Block row at that level.
+     * @param minHeight Receives the lowest height in the block.
+     * @param maxHeight Receives the highest height in the block.
+     * @return False if the block lies outside the grid.
+     */
+    bool getMinMax(int level, int x, int z, float& minHeight, float& maxHeight) const;
+
+    // Getters
+    int getLevelCount() const;
+    int getLevelWidth(int level) const;
+    int getLevelHeight(int level) const;
+
+private:
+    struct Level {
+        int width, height;               ///< Blocks along X and Z.
+        std::vector<float> minHeights;   ///< Lowest height per block.
+        std::vector<float> maxHeights;   ///< Highest height per block.
+    };
+
+    std::vector<Level> levels;           ///< Level 0 is per cell, the last level is a single block.
+
+    /**
+     * @brief Sets block (x, z) of a level from its (up to) four children in the level below.
+     */
+    static void reduceBlock(const Level& fine, Level& coarse, int x, int z);
+};
+
+#endif // HEIGHTPYRAMID_H
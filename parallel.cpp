@@ -0,0 +1,133 @@
+#include "parallel.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+namespace {
+    // One parallelFor call; remaining is guarded by the pool mutex
+    struct Job {
+        const std::function<void(int, int)>* body;
+        int begin, count, rangeCount;
+        int remaining;
+    };
+
+    struct Task {
+        Job* job;
+        int range;
+    };
+
+    // Threads started once and kept for the lifetime of the program. Callers run one range
+    // themselves and, while they wait, take their own job's queued ranges (never another
+    // call's), so nested calls cannot starve and a short call on the render thread is not held
+    // up by the long ranges of a load running at the same time.
+    class WorkerPool {
+    public:
+        explicit WorkerPool(int threadCount) {
+            threads.reserve(threadCount);
+            for (int i = 0; i < threadCount; ++i) {
+                threads.emplace_back(&WorkerPool::workerLoop, this);
+            }
+        }
+
+        ~WorkerPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            taskReady.notify_all();
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+
+        void run(Job& job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (int range = 1; range < job.rangeCount; ++range) {
+                    tasks.push_back({&job, range});
+                }
+            }
+            taskReady.notify_all();
+            execute({&job, 0});
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (job.remaining > 0) {
+                auto own = std::find_if(tasks.begin(), tasks.end(), [&job](const Task& task) { return task.job == &job; });
+                if (own != tasks.end()) {
+                    Task task = *own;
+                    tasks.erase(own);
+                    lock.unlock();
+                    execute(task);
+                    lock.lock();
+                } else {
+                    taskDone.wait(lock);
+                }
+            }
+        }
+
+    private:
+        void workerLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                Task task = tasks.front();
+                tasks.pop_front();
+                lock.unlock();
+                execute(task);
+                lock.lock();
+            }
+        }
+
+        void execute(const Task& task) {
+            const Job& job = *task.job;
+            int rangeBegin = job.begin + static_cast<int>(static_cast<long long>(job.count) * task.range / job.rangeCount);
+            int rangeEnd = job.begin + static_cast<int>(static_cast<long long>(job.count) * (task.range + 1) / job.rangeCount);
+            (*job.body)(rangeBegin, rangeEnd);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--task.job->remaining == 0) {
+                taskDone.notify_all();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable taskReady;
+        std::condition_variable taskDone;
+        std::deque<Task> tasks;
+        std::vector<std::thread> threads;
+        bool stopping = false;
+    };
+
+    WorkerPool& getPool() {
+        // The calling thread always takes a range, so one thread fewer than the worker count
+        static WorkerPool pool(getWorkerCount() - 1);
+        return pool;
+    }
+}
+
+int getWorkerCount() {
+    static const int workerCount = std::max(1u, std::thread::hardware_concurrency());
+    return workerCount;
+}
+
+void parallelFor(int begin, int end, const std::function<void(int, int)>& body, int minRangeSize) {
+    int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+
+    int rangeCount = std::min(getWorkerCount(), std::max(1, count / std::max(minRangeSize, 1)));
+    if (rangeCount == 1) {
+        body(begin, end);
+        return;
+    }
+
+    Job job{&body, begin, count, rangeCount, rangeCount};
+    getPool().run(job);
+}
@@ -0,0 +1,26 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+/**
+ * @brief Number of worker threads used by parallelFor (at least 1).
+ */
+int getWorkerCount();
+
+/**
+ * @brief Splits [begin, end) into contiguous ranges and runs them on worker threads.
+ *
+ * Ranges run on a pool of threads started on first use and kept until exit. The calling
+ * thread processes one of the ranges itself, runs its own queued ranges while it waits
+ * (never those of another call), and returns once all of them are done. Small ranges run
+ * inline. Safe to call from inside a body and from several threads at once.
+ *
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param body Called as body(rangeBegin, rangeEnd) for each range.
+ * @param minRangeSize Smallest range worth handing to another thread.
+ */
+void parallelFor(int begin, int end, const std::function<void(int, int)>& body, int minRangeSize = 1);
+
+#endif // PARALLEL_H
@@ -12,12 +12,17 @@
 class Shader {
 public:
     Shader(const char* vertexPath, const char* fragmentPath);
+    // Adds tessellation control and evaluation stages; stays unloaded without OpenGL 4.1
+    Shader(const char* vertexPath, const char* tessControlPath, const char* tessEvaluationPath, const char* fragmentPath);
     ~Shader();
     void use() const;
     GLuint getProgramID() const;
     bool isLoaded() const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
+    void setMat3(const std::string& name, const glm::mat3& mat) const;
+    void setVec2(const std::string& name, const glm::vec2& value) const;
     void setVec3(const std::string& name, const glm::vec3& value) const;
+    void setVec4(const std::string& name, const glm::vec4& value) const;
     void setFloat(const std::string& name, float value) const;
     void setInt(const std::string& name, int value) const;
     std::string getErrorLog() const;
@@ -30,6 +35,7 @@ private:
     std::string errorLog;
     mutable std::unordered_map<std::string, GLint> uniformCache;
     unsigned int compileShader(const std::string& source, GLenum shaderType);
+    void buildProgram(const char* const* paths, const GLenum* types, int stageCount);
     GLint getUniformLocation(const std::string& name) const;
 };
 
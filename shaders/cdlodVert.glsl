@@ -0,0 +1,54 @@
+#version 330 core
+
+layout(location = 0) in vec2 aGridPos;   // Patch-space position in [0, 1]
+layout(location = 1) in vec4 aNode;      // Per instance: node origin x/z, node size, LOD level
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform sampler2D heightMap;
+uniform vec2 terrainSize;      // World extent of the height grid along X and Z
+uniform vec2 heightMapSize;    // Height grid dimensions in samples
+uniform float gridDim;         // Cells per side of the patch
+uniform vec3 cameraPos;        // Camera position in terrain space
+uniform vec2 morphConsts[6];   // Per level: end / (end - start), 1 / (end - start)
+
+out vec3 fragNormal;
+out vec3 fragPosition;
+
+float sampleHeight(vec2 worldXZ) {
+    // Map world positions onto texel centres so sample i lands exactly on grid vertex i
+    vec2 uv = (worldXZ / terrainSize * (heightMapSize - 1.0) + 0.5) / heightMapSize;
+    return textureLod(heightMap, uv, 0.0).r;
+}
+
+// Slide odd vertices onto their even neighbours so the patch matches the next coarser level
+vec2 morphVertex(vec2 gridPos, vec2 worldXZ, float morphK) {
+    vec2 fracPart = fract(gridPos * gridDim * 0.5) * 2.0 / gridDim;
+    return worldXZ - fracPart * aNode.z * morphK;
+}
+
+void main() {
+    vec2 worldXZ = aNode.xy + aGridPos * aNode.z;
+    float height = sampleHeight(clamp(worldXZ, vec2(0.0), terrainSize));
+
+    vec2 morph = morphConsts[int(aNode.w)];
+    float dist = distance(cameraPos, vec3(worldXZ.x, height, worldXZ.y));
+    float morphK = 1.0 - clamp(morph.x - dist * morph.y, 0.0, 1.0);
+
+    worldXZ = clamp(morphVertex(aGridPos, worldXZ, morphK), vec2(0.0), terrainSize);
+    height = sampleHeight(worldXZ);
+
+    // Normal from central differences of the height texture
+    vec2 texel = terrainSize / (heightMapSize - 1.0);
+    float hLeft = sampleHeight(worldXZ - vec2(texel.x, 0.0));
+    float hRight = sampleHeight(worldXZ + vec2(texel.x, 0.0));
+    float hBack = sampleHeight(worldXZ - vec2(0.0, texel.y));
+    float hFront = sampleHeight(worldXZ + vec2(0.0, texel.y));
+    vec3 normal = normalize(vec3((hLeft - hRight) * texel.y, 2.0 * texel.x * texel.y, (hBack - hFront) * texel.x));
+
+    fragPosition = vec3(model * vec4(worldXZ.x, height, worldXZ.y, 1.0));
+    fragNormal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * view * vec4(fragPosition, 1.0);
+}
@@ -0,0 +1,76 @@
+#version 330 core
+
+layout(location = 0) in vec2 aGridPos;   // Sample inside the level window, 0..clipSize - 1
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform sampler2DArray clipHeights; // One toroidally addressed window of heights per level
+uniform int clipSize;               // Samples per window side
+uniform vec2 terrainSize;           // World extent of the height grid along X and Z
+uniform vec3 cameraPos;             // Camera position in terrain space
+
+uniform int level;                  // Layer of this level; the coarser level is the next layer
+uniform float levelSpacing;         // World distance between samples of this level
+uniform vec2 levelOrigin;           // First window sample, in this level's samples
+uniform vec2 texOffset;             // Texel holding the first window sample
+uniform bool hasCoarser;            // A coarser level surrounds this one
+uniform vec2 coarseOffset;          // Window origin inside the coarser window, in this level's samples
+uniform vec2 coarseTexOffset;       // Texel holding the first sample of the coarser window
+
+out vec3 fragNormal;
+out vec3 fragPosition;
+
+float fetchHeight(int layer, ivec2 windowPos, vec2 offset) {
+    ivec2 texel = (clamp(windowPos, ivec2(0), ivec2(clipSize - 1)) + ivec2(offset)) % clipSize;
+    return texelFetch(clipHeights, ivec3(texel, layer), 0).r;
+}
+
+// Height the coarser level draws at a sample of this one: its own sample on even positions,
+// the average of the two or four samples around it otherwise
+float coarseHeight(ivec2 windowPos) {
+    ivec2 pos = windowPos + ivec2(coarseOffset);
+    ivec2 low = pos / 2;
+    ivec2 high = (pos + 1) / 2;
+    return 0.25 * (fetchHeight(level + 1, low, coarseTexOffset) + fetchHeight(level + 1, ivec2(high.x, low.y), coarseTexOffset) +
+                   fetchHeight(level + 1, ivec2(low.x, high.y), coarseTexOffset) + fetchHeight(level + 1, high, coarseTexOffset));
+}
+
+void main() {
+    ivec2 windowPos = ivec2(aGridPos);
+    vec2 samplePos = levelOrigin + aGridPos;
+    float height = fetchHeight(level, windowPos, texOffset);
+
+    // Normal from central differences of this level
+    float hLeft = fetchHeight(level, windowPos - ivec2(1, 0), texOffset);
+    float hRight = fetchHeight(level, windowPos + ivec2(1, 0), texOffset);
+    float hBack = fetchHeight(level, windowPos - ivec2(0, 1), texOffset);
+    float hFront = fetchHeight(level, windowPos + ivec2(0, 1), texOffset);
+    vec3 normal = normalize(vec3(hLeft - hRight, 2.0 * levelSpacing, hBack - hFront));
+
+    // Blend into the coarser level over the outer tenth of the window, reaching it exactly on
+    // the border so the two levels share their edge vertices
+    if (hasCoarser) {
+        float windowCells = float(clipSize - 1);
+        float transition = windowCells * 0.1;
+        vec2 fromCamera = abs(cameraPos.xz / levelSpacing - samplePos);
+        vec2 blend = clamp((fromCamera - (windowCells * 0.5 - transition - 2.0)) / transition, 0.0, 1.0);
+        float alpha = max(blend.x, blend.y);
+        if (alpha > 0.0) {
+            float coarseLeft = coarseHeight(windowPos - ivec2(2, 0));
+            float coarseRight = coarseHeight(windowPos + ivec2(2, 0));
+            float coarseBack = coarseHeight(windowPos - ivec2(0, 2));
+            float coarseFront = coarseHeight(windowPos + ivec2(0, 2));
+            vec3 coarseNormal = normalize(vec3(coarseLeft - coarseRight, 4.0 * levelSpacing, coarseBack - coarseFront));
+            height = mix(height, coarseHeight(windowPos), alpha);
+            normal = normalize(mix(normal, coarseNormal, alpha));
+        }
+    }
+
+    // Windows reaching past the terrain collapse onto its edge
+    vec2 worldXZ = clamp(samplePos * levelSpacing, vec2(0.0), terrainSize);
+    fragPosition = vec3(model * vec4(worldXZ.x, height, worldXZ.y, 1.0));
+    fragNormal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * view * vec4(fragPosition, 1.0);
+}
@@ -7,6 +7,19 @@ uniform vec3 lightPos;
 uniform vec3 viewPos;
 uniform float maxHeight;
 
+// Baked normals replace the interpolated vertex normal when set
+uniform bool useNormalMap;
+uniform sampler2D normalMap;      // RG = normal X and Z, Y is rebuilt
+uniform mat4 worldToTerrain;      // Inverse model matrix
+uniform vec4 terrainMapTransform; // xy: terrain units to texture units, zw: half-texel offset
+uniform mat3 normalMatrix;
+
+// With the horizon map the terrain is lit by a directional sun and shadowed by its horizons
+uniform bool useHorizonMap;
+uniform sampler2DArray horizonMap; // Horizon elevation sines, directions 0-3 then 4-7
+uniform vec3 sunDirection;         // Towards the sun, world space
+uniform vec2 sunHorizon;           // x: sun azimuth in direction steps [0, 8), y: sun elevation sine (terrain space)
+
 out vec4 FragColor;
 
 void main() {
@@ -39,7 +52,36 @@ void main() {
         vec3 lightDir = normalize(lightPos - fragPosition);
         vec3 viewDir = normalize(viewPos - fragPosition);
 
-        float diffIntensity = max(dot(normalize(fragNormal), lightDir), 0.0);
+        vec2 mapCoord = vec2(0.0);
+        if (useNormalMap || useHorizonMap) {
+            vec2 terrainXZ = (worldToTerrain * vec4(fragPosition, 1.0)).xz;
+            mapCoord = terrainXZ * terrainMapTransform.xy + terrainMapTransform.zw;
+        }
+
+        vec3 normal = fragNormal;
+        if (useNormalMap) {
+            vec2 n = texture(normalMap, mapCoord).rg;
+            normal = normalMatrix * vec3(n.x, sqrt(max(1.0 - dot(n, n), 0.0)), n.y);
+        }
+
+        float shadow = 1.0;
+        if (useHorizonMap) {
+            vec4 h0 = texture(horizonMap, vec3(mapCoord, 0.0));
+            vec4 h1 = texture(horizonMap, vec3(mapCoord, 1.0));
+            float horizon[8] = float[8](h0.r, h0.g, h0.b, h0.a, h1.r, h1.g, h1.b, h1.a);
+
+            // Horizon towards the sun, interpolated between the two nearest stored directions
+            int d0 = int(sunHorizon.x);
+            float sunHorizonSine = mix(horizon[d0], horizon[(d0 + 1) % 8], fract(sunHorizon.x));
+            shadow = smoothstep(sunHorizonSine - 0.02, sunHorizonSine + 0.02, sunHorizon.y);
+
+            // Cosine-weighted sky occlusion: a horizon at elevation e hides sin^2(e) of its slice
+            float occlusion = (dot(h0, h0) + dot(h1, h1)) / 8.0;
+            ambient *= 1.0 - occlusion;
+            lightDir = normalize(sunDirection);
+        }
+
+        float diffIntensity = max(dot(normalize(normal), lightDir), 0.0) * shadow;
         vec3 diffuse = diffIntensity * color;
 
         vec3 finalColor = ambient + diffuse;
@@ -0,0 +1,37 @@
+#version 330 core
+
+layout(location = 0) in vec2 aGrid;    // Vertex of the shared chunk grid, in cells
+layout(location = 1) in vec2 aChunk;   // Per instance: chunk origin, in cells
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform sampler2D heightMap;   // One texel per grid vertex
+uniform float gridSpacing;     // World distance between grid vertices
+uniform float minHeight;       // Height at a texel value of 0
+uniform float heightRange;     // Height difference between texel values 1 and 0
+
+out vec3 fragNormal;
+out vec3 fragPosition;
+
+float heightAt(ivec2 cell) {
+    cell = clamp(cell, ivec2(0), textureSize(heightMap, 0) - 1);
+    return minHeight + heightRange * texelFetch(heightMap, cell, 0).r;
+}
+
+void main() {
+    ivec2 cell = ivec2(aChunk + aGrid);
+    float height = heightAt(cell);
+
+    // Central differences with clamped borders, as on the CPU
+    float hLeft = heightAt(cell - ivec2(1, 0));
+    float hRight = heightAt(cell + ivec2(1, 0));
+    float hBack = heightAt(cell - ivec2(0, 1));
+    float hFront = heightAt(cell + ivec2(0, 1));
+    vec3 normal = normalize(vec3(hLeft - hRight, 2.0 * gridSpacing, hBack - hFront));
+
+    fragPosition = vec3(model * vec4(vec2(cell).x * gridSpacing, height, vec2(cell).y * gridSpacing, 1.0));
+    fragNormal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * view * vec4(fragPosition, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+
+layout(location = 0) in vec2 aGrid;        // Grid column and row
+layout(location = 1) in float aHeight;     // Height normalized to [0, 1] over the terrain's range
+layout(location = 2) in vec2 aOctNormal;   // Octahedral normal, [-127, 127] per component
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform float gridSpacing;   // World distance between grid vertices
+uniform float minHeight;     // Height at aHeight = 0
+uniform float heightRange;   // Height difference between aHeight = 1 and aHeight = 0
+
+out vec3 fragNormal;
+out vec3 fragPosition;
+
+// Inverse of the +Y-centred octahedral mapping used when packing the vertices
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    if (n.y < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+        n.xz = (1.0 - abs(n.zx)) * signs;
+    }
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = vec3(aGrid.x * gridSpacing, minHeight + aHeight * heightRange, aGrid.y * gridSpacing);
+    vec3 normal = decodeOctahedral(clamp(aOctNormal / 127.0, -1.0, 1.0));
+
+    fragPosition = vec3(model * vec4(position, 1.0));
+    fragNormal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * view * vec4(fragPosition, 1.0);
+}
@@ -0,0 +1,137 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/**
+ * @file simd.h
+ * @brief Minimal four-lane float vector used by the terrain kernels.
+ *
+ * Maps onto SSE on x86, NEON on ARM (Apple silicon) and plain arrays elsewhere, so the
+ * kernels are written once and every loop that uses them also needs a scalar tail.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TERRAIN_SIMD_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TERRAIN_SIMD_NEON 1
+#endif
+
+namespace simd {
+
+#if defined(TERRAIN_SIMD_SSE)
+
+typedef __m128 float4;
+typedef __m128 mask4;
+
+inline float4 load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, float4 v) { _mm_storeu_ps(p, v); }
+inline float4 splat(float value) { return _mm_set1_ps(value); }
+inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 div(float4 a, float4 b) { return _mm_div_ps(a, b); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+inline float4 sqrt(float4 v) { return _mm_sqrt_ps(v); }
+
+inline mask4 greaterEqual(float4 a, float4 b) { return _mm_cmpge_ps(a, b); }
+inline mask4 less(float4 a, float4 b) { return _mm_cmplt_ps(a, b); }
+inline mask4 both(mask4 a, mask4 b) { return _mm_and_ps(a, b); }
+inline float4 select(mask4 m, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+inline float4 truncate(float4 v) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(v)); }
+inline void storeTruncated(int* p, float4 v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(v)); }
+
+// Writes x0 y0 z0 x1 y1 z1 ... to twelve consecutive floats
+inline void storeInterleaved3(float* p, float4 x, float4 y, float4 z) {
+    __m128 xyLow = _mm_unpacklo_ps(x, y);                               // x0 y0 x1 y1
+    __m128 xyHigh = _mm_unpackhi_ps(x, y);                              // x2 y2 x3 y3
+    __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));          // z0 z0 x1 x1
+    __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(2, 1, 2, 1));          // y1 y2 z1 z2
+    __m128 zxy = _mm_shuffle_ps(z, xyHigh, _MM_SHUFFLE(3, 2, 3, 2));    // z2 z3 x3 y3
+    _mm_storeu_ps(p, _mm_shuffle_ps(xyLow, zx, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xyHigh, _MM_SHUFFLE(1, 0, 2, 0)));
+    _mm_storeu_ps(p + 8, _mm_shuffle_ps(zxy, zxy, _MM_SHUFFLE(1, 3, 2, 0)));
+}
+
+#elif defined(TERRAIN_SIMD_NEON)
+
+typedef float32x4_t float4;
+typedef uint32x4_t mask4;
+
+inline float4 load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, float4 v) { vst1q_f32(p, v); }
+inline float4 splat(float value) { return vdupq_n_f32(value); }
+inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+inline float4 min(float4 a, float4 b) { return vminq_f32(a, b); }
+inline float4 max(float4 a, float4 b) { return vmaxq_f32(a, b); }
+inline mask4 greaterEqual(float4 a, float4 b) { return vcgeq_f32(a, b); }
+inline mask4 less(float4 a, float4 b) { return vcltq_f32(a, b); }
+inline mask4 both(mask4 a, mask4 b) { return vandq_u32(a, b); }
+inline float4 select(mask4 m, float4 a, float4 b) { return vbslq_f32(m, a, b); }
+inline float4 truncate(float4 v) { return vcvtq_f32_s32(vcvtq_s32_f32(v)); }
+inline void storeTruncated(int* p, float4 v) { vst1q_s32(p, vcvtq_s32_f32(v)); }
+#if defined(__aarch64__)
+inline float4 div(float4 a, float4 b) { return vdivq_f32(a, b); }
+inline float4 sqrt(float4 v) { return vsqrtq_f32(v); }
+#else
+// ARMv7 has no vector divide; refine the reciprocal estimate twice
+inline float4 div(float4 a, float4 b) {
+    float32x4_t r = vrecpeq_f32(b);
+    r = vmulq_f32(r, vrecpsq_f32(b, r));
+    r = vmulq_f32(r, vrecpsq_f32(b, r));
+    return vmulq_f32(a, r);
+}
+inline float4 sqrt(float4 v) {
+    float32x4_t r = vrsqrteq_f32(v);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(v, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(v, r), r));
+    return vmulq_f32(v, r);
+}
+#endif
+
+inline void storeInterleaved3(float* p, float4 x, float4 y, float4 z) {
+    float32x4x3_t xyz = { { x, y, z } };
+    vst3q_f32(p, xyz);
+}
+
+#else
+
+#include <cmath>
+
+struct float4 { float v[4]; };
+struct mask4 { bool v[4]; };
+
+inline float4 load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+inline void store(float* p, float4 v) { for (int i = 0; i < 4; ++i) p[i] = v.v[i]; }
+inline float4 splat(float value) { return { { value, value, value, value } }; }
+inline float4 add(float4 a, float4 b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+inline float4 sub(float4 a, float4 b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+inline float4 mul(float4 a, float4 b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+inline float4 div(float4 a, float4 b) { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+inline float4 min(float4 a, float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline float4 max(float4 a, float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline float4 sqrt(float4 v) { for (int i = 0; i < 4; ++i) v.v[i] = std::sqrt(v.v[i]); return v; }
+
+inline mask4 greaterEqual(float4 a, float4 b) { mask4 m; for (int i = 0; i < 4; ++i) m.v[i] = a.v[i] >= b.v[i]; return m; }
+inline mask4 less(float4 a, float4 b) { mask4 m; for (int i = 0; i < 4; ++i) m.v[i] = a.v[i] < b.v[i]; return m; }
+inline mask4 both(mask4 a, mask4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] && b.v[i]; return a; }
+inline float4 select(mask4 m, float4 a, float4 b) { for (int i = 0; i < 4; ++i) a.v[i] = m.v[i] ? a.v[i] : b.v[i]; return a; }
+inline float4 truncate(float4 v) { for (int i = 0; i < 4; ++i) v.v[i] = static_cast<float>(static_cast<int>(v.v[i])); return v; }
+inline void storeTruncated(int* p, float4 v) { for (int i = 0; i < 4; ++i) p[i] = static_cast<int>(v.v[i]); }
+
+inline void storeInterleaved3(float* p, float4 x, float4 y, float4 z) {
+    for (int i = 0; i < 4; ++i) {
+        p[i * 3] = x.v[i];
+        p[i * 3 + 1] = y.v[i];
+        p[i * 3 + 2] = z.v[i];
+    }
+}
+
+#endif
+
+} // namespace simd
+
+#endif // SIMD_H
@@ -3,8 +3,118 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <functional>
 #include <glm/glm.hpp>
 #include "shader.h"
+#include "frustum.h"
+#include "heightPyramid.h"
+#include "heightField.h"
+#include "terrainRaycast.h"
+#include "cdlodTerrain.h"
+#include "clipmapTerrain.h"
+#include "tessTerrain.h"
+#include "terrainStreamer.h"
+#include "terrainNormalMap.h"
+#include "terrainHorizonMap.h"
+#include "terrainRtin.h"
+#include "terrainOcclusion.h"
+#include "terrainSlopeMap.h"
+#include "heightMips.h"
+
+class TerrainCache;
+struct TerrainCacheKey;
+
+/// Number of geomipmap levels; level L samples every 2^L-th grid vertex.
+const int terrainLodLevels = 4;
+
+/// Edge flags used to pick a stitched index list when a neighbouring chunk is one level coarser.
+enum TerrainChunkEdge {
+    EDGE_TOP = 1,      ///< Neighbour towards -Z.
+    EDGE_RIGHT = 2,    ///< Neighbour towards +X.
+    EDGE_BOTTOM = 4,   ///< Neighbour towards +Z.
+    EDGE_LEFT = 8      ///< Neighbour towards -X.
+};
+
+/// Ways the terrain can be turned into geometry. Chosen before loadTerrainData.
+enum class TerrainRenderMode {
+    Geomipmap,   ///< Static full-grid vertex buffer drawn per chunk at a stitched LOD level.
+    CDLOD,       ///< Quadtree-selected instanced patches displaced from a height texture.
+    Streaming,   ///< Full-resolution tiles paged in around the camera from a pre-split tile file.
+    Tessellation, ///< Coarse patches subdivided on the GPU by screen-space edge length (OpenGL 4.1+, else Geomipmap).
+    HeightTexture, ///< Geomipmap chunks drawn as instances of one flat grid displaced from a height texture.
+    Adaptive,    ///< Geomipmap vertex buffer drawn with per-chunk RTIN triangles within a maximum vertical error.
+    Clipmap      ///< Nested camera-centred grids at halving resolutions, heights kept in toroidally updated textures.
+};
+
+/// Layout of the vertex buffer used by the Geomipmap mode, and of the height texture (R32F or
+/// R16) in HeightTexture mode. Chosen before loadTerrainData.
+enum class TerrainVertexFormat {
+    Float,    ///< Position and normal as six floats (24 bytes), or the position alone (12 bytes) with the normal map.
+    Packed    ///< 16-bit grid indices, 16-bit unorm height and an 8-bit octahedral normal (8 bytes).
+};
+
+/// How a TerrainBrush changes the heights under it.
+enum class TerrainBrushMode {
+    Raise,    ///< Adds strength world units at full weight.
+    Lower,    ///< Subtracts strength world units at full weight.
+    Flatten   ///< Moves towards targetHeight by the fraction strength (0-1) at full weight.
+};
+
+/**
+ * @struct TerrainBrush
+ * @brief Circular height edit. Samples within hardness * radius of the centre get full
+ *        weight, which falls off along a cosine to zero at the radius.
+ */
+struct TerrainBrush {
+    TerrainBrushMode mode = TerrainBrushMode::Raise;
+    float radius = 20.0f;         ///< World units.
+    float strength = 1.0f;        ///< Height change, or blend factor for Flatten.
+    float hardness = 0.5f;        ///< Share of the radius at full weight.
+    float targetHeight = 0.0f;    ///< Height Flatten moves towards.
+};
+
+/**
+ * @struct PackedTerrainVertex
+ * @brief Quantized terrain vertex. X/Z are grid indices, the height is normalized to the
+ *        terrain's height range and the normal is octahedral-encoded around +Y.
+ */
+struct PackedTerrainVertex {
+    GLushort gridX, gridZ;   ///< Grid column and row.
+    GLushort height;         ///< Height mapped from [minHeight, maxHeight] to [0, 65535].
+    GLbyte normal[2];        ///< Octahedral normal, [-127, 127] per component.
+};
+
+/**
+ * @struct TerrainChunk
+ * @brief A square block of the terrain grid with its own world-space bounds and LOD state.
+ */
+struct TerrainChunk {
+    GLint baseVertex;                  ///< Index of the chunk's first vertex in the vertex buffer.
+    glm::vec3 boundsMin;               ///< Minimum corner of the chunk's bounding box.
+    glm::vec3 boundsMax;               ///< Maximum corner of the chunk's bounding box.
+    float lodError[terrainLodLevels];  ///< Maximum vertical error of each level against full resolution.
+    int lodLevel;                      ///< Level selected for the current frame.
+};
+
+/**
+ * @struct TerrainIndexRange
+ * @brief Location of one shared index list inside the element buffer.
+ */
+struct TerrainIndexRange {
+    size_t indexOffset;      ///< Offset of the first index in the element buffer.
+    GLsizei indexCount;      ///< Number of indices in the list, including strip restarts.
+    GLsizei triangleCount;   ///< Number of triangles the list draws.
+};
+
+/**
+ * @struct TerrainLodIndexSet
+ * @brief The 16-bit index lists of every LOD level and edge mask, relative to a chunk's first vertex.
+ */
+struct TerrainLodIndexSet {
+    std::vector<GLushort> indices;                        ///< All lists back to back.
+    TerrainIndexRange ranges[terrainLodLevels][16];      ///< Location of each list.
+};
 
 /**
  * @class Terrain
@@ -19,12 +129,68 @@ public:
 //    Terrain(const std::string& heightmapPath, float yScale, float yShift);
 
     /**
-     * @brief Loads terrain data from a heightmap image.
+     * @brief Destructor. OpenGL resources are released by cleanup().
+     */
+    ~Terrain();
+
+    /**
+     * @brief Loads terrain data from a heightmap image. The sample step and height filter
+     *        may be overridden by a TerrainSettings file next to the image or the environment.
+     *        Same as prepareTerrainData followed by finishTerrainData.
      * @param texturePath Path to the heightmap image.
      * @return True if successful, false otherwise.
      */
     bool loadTerrainData(const std::string& texturePath);
 
+    /**
+     * @brief The CPU half of loadTerrainData: decodes the heightmap (or maps the cache) and
+     *        builds the height grid, pyramid, normal and horizon maps and chunks without
+     *        calling OpenGL, so it may run on a worker thread. Nothing else may use
+     *        this terrain until finishTerrainData has run on the GL thread.
+     * @param texturePath Path to the heightmap image.
+     * @param onHeightGrid Optional; called on the same thread with the row-major height grid
+     *        as soon as it is decoded or mapped from the cache, before the slower bakes.
+     *        Grid dimensions and sample step are already set, so it may pass the terrain to
+     *        preparePreviewData.
+     * @return True if successful, false otherwise.
+     */
+    bool prepareTerrainData(const std::string& texturePath,
+                            const std::function<void(const float*)>& onHeightGrid = nullptr);
+
+    /**
+     * @brief Like prepareTerrainData, but takes the heights from another terrain's grid halved
+     *        down to the preview resolution instead of reading the image again. Meant to be
+     *        called from that terrain's onHeightGrid callback.
+     * @param source Terrain whose height grid is being prepared.
+     * @param heights Row-major height grid of source.
+     * @return True if successful, false otherwise.
+     */
+    bool preparePreviewData(const Terrain& source, const float* heights);
+
+    /**
+     * @brief The OpenGL half of loadTerrainData: uploads what prepareTerrainData built and
+     *        sets up the render mode. Must run on the thread that owns the context.
+     * @return True if successful, false otherwise.
+     */
+    bool finishTerrainData();
+
+    /**
+     * @brief Optional step between prepareTerrainData and finishTerrainData, on the GL thread:
+     *        allocates the vertex buffer of the prepared mesh and maps it (persistently where
+     *        ARB_buffer_storage is available) for fillVertexBuffer.
+     * @return True if a buffer was mapped; fillVertexBuffer must then run before
+     *         finishTerrainData. False if the mode builds no mesh or mapping failed, in which
+     *         case finishTerrainData uploads the vertices itself.
+     */
+    bool mapVertexBuffer();
+
+    /**
+     * @brief Writes the prepared vertices into the buffer mapVertexBuffer mapped, so the GL
+     *        thread neither builds nor copies them. Calls no OpenGL, so it may run on a
+     *        worker thread.
+     */
+    void fillVertexBuffer();
+
     /**
      * @brief Renders the terrain.
      * @param model Model matrix.
@@ -47,12 +213,207 @@ public:
      */
     float getHeightAtPosition(float x, float z) const;
 
+    /**
+     * @brief Batched getHeightAtPosition for many positions at once, vectorized and split
+     *        across threads for large batches. Positions outside the terrain get height 0,
+     *        an upward normal and zero slope.
+     * @param xs X-coordinates.
+     * @param zs Z-coordinates.
+     * @param count Number of positions.
+     * @param outHeights Receives count heights.
+     * @param outNormals Optional; receives count unit surface normals.
+     * @param outSlopes Optional; receives count slope angles in degrees.
+     */
+    void getHeightsAtPositions(const float* xs, const float* zs, size_t count, float* outHeights,
+                               glm::vec3* outNormals = nullptr, float* outSlopes = nullptr) const;
+
+    /**
+     * @brief Slope and aspect at a position, read from the precomputed rasters in constant
+     *        time (the nearest grid sample). Aspect is the downhill direction in degrees,
+     *        measured from +X towards +Z in [0, 360). Positions outside the terrain are flat.
+     * @param x X-coordinate.
+     * @param z Z-coordinate.
+     * @param aspect Optional; receives the aspect in degrees.
+     * @return Slope angle in degrees.
+     */
+    float getSlopeAtPosition(float x, float z, float* aspect = nullptr) const;
+
+    /**
+     * @brief Batched getSlopeAtPosition, vectorized and split across threads for large batches.
+     * @param xs X-coordinates.
+     * @param zs Z-coordinates.
+     * @param count Number of positions.
+     * @param outSlopes Receives count slope angles in degrees.
+     * @param outAspects Optional; receives count aspects in degrees.
+     */
+    void getSlopesAtPositions(const float* xs, const float* zs, size_t count, float* outSlopes,
+                              float* outAspects = nullptr) const;
+
+    /**
+     * @brief Finds the nearest point where a ray meets the terrain, skipping empty space with
+     *        the min/max height pyramid. Works in terrain (model) space.
+     * @param origin Ray origin.
+     * @param direction Ray direction; does not need to be normalized.
+     * @param maxDistance Hits further away than this are ignored.
+     * @param hit Receives position, normal and distance of the hit.
+     * @return True if the ray hits the terrain within maxDistance. Always false in Streaming
+     *         mode, which keeps no height grid for the whole terrain.
+     */
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, TerrainRayHit& hit) const;
+
+    /**
+     * @brief Casts many rays at once, split across threads for large batches.
+     * @param origins Ray origins.
+     * @param directions Ray directions.
+     * @param count Number of rays.
+     * @param maxDistance Hits further away than this are ignored.
+     * @param hits Receives count hits; entries without a hit are left untouched.
+     * @param didHit Receives count flags telling which rays hit.
+     * @return Number of rays that hit.
+     */
+    size_t raycast(const glm::vec3* origins, const glm::vec3* directions, size_t count, float maxDistance,
+                   TerrainRayHit* hits, bool* didHit) const;
+
+    /**
+     * @brief Edits the heights under a circular brush. Only the edited rectangle and the
+     *        structures derived from it are refreshed: normals within one sample of it, the
+     *        chunk bounds, pyramid, normal and horizon maps, and the matching ranges of the
+     *        vertex buffer or height texture. Edits live in memory and are not written to the
+     *        cache.
+     * @param x Brush centre X in terrain (model) space.
+     * @param z Brush centre Z in terrain (model) space.
+     * @param brush Shape and effect of the brush.
+     * @return False if no editable height grid is loaded, which is always the case in
+     *         Streaming mode.
+     */
+    bool applyBrush(float x, float z, const TerrainBrush& brush);
+
+    /**
+     * @brief Adds a grid of height offsets centred on a position, one stamp value per grid
+     *        sample, and refreshes the edited rectangle like applyBrush.
+     * @param x Stamp centre X in terrain (model) space.
+     * @param z Stamp centre Z in terrain (model) space.
+     * @param stamp Row-major offsets, stampWidth * stampHeight values.
+     * @param stampWidth Number of stamp columns.
+     * @param stampHeight Number of stamp rows.
+     * @param scale World units per stamp unit.
+     * @return False if no editable height grid is loaded.
+     */
+    bool stampHeights(float x, float z, const float* stamp, int stampWidth, int stampHeight, float scale);
+
+    /**
+     * @brief Sets how many heightmap pixels are skipped between grid vertices. Takes effect on the next load.
+     * @param step Sample step, 1 for full resolution.
+     */
+    void setSampleStep(int step);
+
+    /**
+     * @brief Makes the next load a quick preview: the sample step becomes the smallest power
+     *        of two that keeps the grid within the given number of samples along its longer
+     *        side, overriding setSampleStep and the settings file, and the cache is neither
+     *        read nor written. 0 (default) loads normally.
+     * @param samples Largest preview grid side.
+     */
+    void setPreviewResolution(int samples);
+
+    /**
+     * @brief Selects how the heightmap is filtered when the sample step is a power of two
+     *        above 1 (box by default). Other steps always point-sample. Takes effect on the next load.
+     * @param filter Downsampling filter.
+     */
+    void setHeightFilter(HeightFilter filter);
+
+    /**
+     * @brief Sets the largest geometric error, in pixels on screen, a chunk may show before a finer level is used.
+     * @param pixels Screen-space error threshold.
+     */
+    void setPixelErrorThreshold(float pixels);
+
+    /**
+     * @brief Selects how the terrain is rendered. Takes effect on the next load.
+     * @param mode Render mode.
+     */
+    void setRenderMode(TerrainRenderMode mode);
+
+    /**
+     * @brief Selects the vertex layout used by the Geomipmap mode. Takes effect on the next load.
+     * @param format Vertex format.
+     */
+    void setVertexFormat(TerrainVertexFormat format);
+
+    /**
+     * @brief Enables reading and writing the binary cache next to the heightmap (on by default).
+     * @param enabled True to use the cache.
+     */
+    void setCacheEnabled(bool enabled);
+
+    /**
+     * @brief Draws the Geomipmap mode as triangle strips with primitive restart instead of
+     *        cache-optimized triangle lists. Takes effect on the next load.
+     * @param enabled True to use strips.
+     */
+    void setTriangleStrips(bool enabled);
+
+    /**
+     * @brief Shades every non-streaming mode from a normal texture baked from the full-resolution
+     *        grid instead of per-vertex normals (on by default). Float vertices then drop their
+     *        normal; packed vertices keep their layout. Takes effect on the next load.
+     * @param enabled True to use the normal map.
+     */
+    void setNormalMapEnabled(bool enabled);
+
+    /**
+     * @brief Bakes horizon angles at load (on by default). Every non-streaming mode is then lit
+     *        by the sun direction, with terrain self-shadowing and sky occlusion read from the
+     *        horizon map. Takes effect on the next load.
+     * @param enabled True to use the horizon map.
+     */
+    void setHorizonMapEnabled(bool enabled);
+
+    /**
+     * @brief Sets the world-space direction towards the sun used with the horizon map.
+     * @param direction Direction; does not need to be normalized.
+     */
+    void setSunDirection(const glm::vec3& direction);
+
+    /**
+     * @brief Sets the largest vertical distance between the Adaptive mesh and the height grid.
+     *        Rebuilds the triangles right away when an Adaptive terrain is loaded.
+     * @param error Maximum error in world units.
+     */
+    void setAdaptiveMaxError(float error);
+
+    /**
+     * @brief Culls chunks hidden behind nearer terrain (on by default). A coarse occluder that
+     *        never rises above the drawn surface is rasterized on the CPU every frame and each
+     *        chunk in the frustum is tested against it. Applies to the chunk-based modes:
+     *        Geomipmap, HeightTexture and Adaptive.
+     * @param enabled True to cull occluded chunks.
+     */
+    void setOcclusionCullingEnabled(bool enabled);
+
     // Getters
     int getWidth() const;
     int getHeight() const;
-    Shader& getShader();
+    Shader& getShader();                       ///< Shader of the active render mode.
+    TerrainRenderMode getRenderMode() const;
+    TerrainVertexFormat getVertexFormat() const;
     float getHeightScale() const;
     float getHorizontalScale() const;
+    const HeightField& getHeightField() const;
+    size_t getChunkCount() const;
+    size_t getVisibleChunkCount() const;
+    size_t getOccludedChunkCount() const;
+    size_t getDrawnTriangleCount() const;
+    TerrainStreamer& getStreamer();            ///< Tile pager used in Streaming mode.
+    const ClipmapTerrain& getClipmapTerrain() const; ///< Renderer used in Clipmap mode.
+    const TerrainNormalMap& getNormalMap() const;
+    const TerrainHorizonMap& getHorizonMap() const;
+    glm::vec3 getSunDirection() const;
+    float getAdaptiveMaxError() const;
+    int getSampleStep() const;
+    HeightFilter getHeightFilter() const;
+    unsigned int getHeightRevision() const;   ///< Changes whenever a finished load or an edit changes the heights.
 
     // Setters
     void setHeightScale(float scale);
@@ -60,29 +421,361 @@ public:
    
 
 private:
+    class LoadStageTimer;                      ///< Wall-clock times of the load stages (terrain.cpp).
+
+    /**
+     * @brief What prepareTerrainData leaves for finishTerrainData.
+     */
+    struct PendingLoad {
+        bool ready = false;                     ///< Prepared and not finished yet.
+        std::string texturePath;                ///< Heightmap the load came from.
+        std::vector<float> heights;             ///< Row-major grid; empty when it came from the cache.
+        std::vector<unsigned char> vertexData;  ///< Interleaved vertices staged for the cache file, if one is written.
+        std::unique_ptr<TerrainCache> cache;    ///< Mapped cache the grid came from, if any.
+        bool normalMapBaked = false;            ///< The normal map has levels to upload.
+        bool horizonMapBaked = false;           ///< The horizon map has texels to upload.
+        GLuint vertexBuffer = 0;                ///< Buffer mapped by mapVertexBuffer, if any.
+        void* mappedVertices = nullptr;         ///< Its mapping, written by fillVertexBuffer.
+        size_t vertexBytes = 0;                 ///< Its size in bytes.
+    };
+
     GLuint terrainVAO, terrainVBO, terrainEBO; ///< OpenGL objects.
     Shader terrainShader;                      ///< Shader used for terrain rendering.
+    Shader terrainPackedShader;                ///< Shader decoding PackedTerrainVertex.
+    Shader terrainHeightShader;                ///< Shader displacing the shared chunk grid from heightTexture.
+    GLuint heightTexture;                      ///< Height grid texture used in HeightTexture mode.
+    GLuint chunkInstanceVBO;                   ///< Origins of the chunks drawn this frame in HeightTexture mode.
 
     int width, height;                         ///< Dimensions of the terrain.
-    std::vector<float> heights;                ///< Heightmap data.
-    std::vector<glm::vec3> vertices;           ///< Vertex positions.
-    std::vector<glm::vec3> normals;            ///< Vertex normals.
-    std::vector<GLuint> indices;               ///< Indices for rendering.
-//    std::vector<GLushort> indices;
+    HeightField heightField;                   ///< Sampled height grid used for ground queries.
+    TerrainSlopeMap slopeMap;                  ///< Per-sample slope and aspect for ground queries.
+    unsigned int heightRevision;               ///< Bumped by every finished load and every edit.
+    std::vector<glm::vec3> normals;            ///< Vertex normals, one per grid sample.
 
 
     float heightScale;                         ///< Scaling factor for terrain height.
     float horizontalScale;                     ///< Scaling factor for terrain width and depth.
 
+    TerrainRenderMode renderMode;              ///< Active render mode.
+    bool cacheEnabled;                         ///< Use the binary heightmap cache.
+    bool triangleStrips;                       ///< Use restart-separated strips from the next load on.
+    TerrainVertexFormat vertexFormat;          ///< Active vertex layout.
+    float minHeight, maxHeight;                ///< Height range used to quantize packed vertices.
+    HeightPyramid heightPyramid;               ///< Min/max bounds over the height grid.
+    CdlodTerrain cdlodTerrain;                 ///< Renderer used in CDLOD mode.
+    TessTerrain tessTerrain;                   ///< Renderer used in Tessellation mode.
+    ClipmapTerrain clipmapTerrain;             ///< Renderer used in Clipmap mode.
+    mutable TerrainStreamer streamer;          ///< Tile pager used in Streaming mode; height queries page tiles in.
+    static const int streamingTileSize = 128;  ///< Cells per tile side when a tile file is built.
+    TerrainNormalMap normalMap;                ///< Baked normals sampled by terrainFrag.glsl.
+    bool normalMapEnabled;                     ///< Bake the normal map from the next load on.
+    bool vertexNormals;                        ///< The loaded vertex buffer carries normals.
+    TerrainHorizonMap horizonMap;              ///< Baked horizons for sun shadows and sky occlusion.
+    bool horizonMapEnabled;                    ///< Bake the horizon map from the next load on.
+    glm::vec3 sunDirection;                    ///< Normalized world-space direction towards the sun.
+    TerrainRtin rtin;                          ///< Per-chunk vertex errors used in Adaptive mode.
+    float adaptiveMaxError;                    ///< Vertical error the Adaptive triangles are built for.
+    GLuint adaptiveEBO;                        ///< Adaptive triangles of every chunk.
+    std::vector<TerrainRtinRange> adaptiveRanges; ///< Location of each chunk's triangles in adaptiveEBO.
+    size_t adaptiveTriangles;                  ///< Triangles in adaptiveEBO.
+    std::vector<GLushort> adaptiveIndices;     ///< CPU copy of adaptiveEBO; edits append replaced ranges at the end.
+    size_t adaptiveIndexCapacity;              ///< Indices adaptiveEBO has room for.
+    size_t adaptiveIndexGarbage;               ///< Indices of ranges that edits have replaced.
+
+    int sampleStep;                            ///< Heightmap pixels between grid vertices.
+    int previewResolution;                     ///< Largest grid side of a preview load, 0 for a full load.
+    PendingLoad pending;                       ///< Output of prepareTerrainData awaiting finishTerrainData.
+    HeightFilter heightFilter;                 ///< Filter used to reach the sample step.
+    float pixelErrorThreshold;                 ///< Allowed screen-space error for LOD selection.
+
+    static const int chunkSize = 32;           ///< Grid cells per chunk side (power of two).
+    int gridWidth, gridHeight;                 ///< Dimensions of the sampled vertex grid.
+    int chunksX, chunksZ;                      ///< Number of chunks along X and Z.
+    std::vector<TerrainChunk> chunks;          ///< Chunks in row-major order.
+    static const int chunkVertexCount = (chunkSize + 1) * (chunkSize + 1); ///< Vertices stored per chunk.
+    const TerrainLodIndexSet* lodIndices;      ///< Shared index lists in the element buffer.
+    bool lodIndicesAreStrips;                  ///< Layout of the lists currently in terrainEBO.
+    Frustum frustum;                           ///< Frustum used to cull chunks each frame.
+    TerrainOcclusion occlusion;                ///< Coarse occluder used to cull chunks behind ridges.
+    bool occlusionCullingEnabled;              ///< Test chunks against the occluder.
+    std::vector<GLsizei> drawCounts;           ///< Index counts of the chunks drawn this frame.
+    std::vector<const void*> drawOffsets;      ///< Index buffer offsets of the chunks drawn this frame.
+    std::vector<GLint> drawBaseVertices;       ///< Base vertices of the chunks drawn this frame.
+    std::vector<glm::vec2> chunkInstances[terrainLodLevels * 16]; ///< Visible chunk origins per index range (HeightTexture mode).
+    std::vector<glm::vec2> instanceData;       ///< chunkInstances packed for upload.
+    size_t visibleChunks;                      ///< Chunks drawn in the last frame.
+    size_t occludedChunks;                     ///< Chunks in the frustum hidden by the occluder in the last frame.
+    size_t drawnTriangles;                     ///< Triangles submitted in the last frame.
+
+    /**
+     * @brief Size of the vertex buffer in the layout selected by vertexFormat, falling back to
+     *        float vertices if the grid is too large for packed ones.
+     * @return Size in bytes.
+     */
+    size_t getVertexDataSize();
+
+    /**
+     * @brief Size of one vertex in the current vertex format.
+     */
+    size_t getVertexSize() const;
+
+    /**
+     * @brief Interleaves vertices and normals in the layout selected by vertexFormat.
+     *
+     * Chunks are written in parallel straight into the output; nothing else is allocated.
+     *
+     * @param heights Row-major height grid.
+     * @param vertexData Receives getVertexDataSize() bytes; may point into a mapped buffer.
+     */
+    void buildVertexData(const float* heights, void* vertexData) const;
+
+    /**
+     * @brief Writes whole rows of one chunk's vertices in the layout selected by vertexFormat.
+     * @param chunk Chunk index in row-major order.
+     * @param firstRow First row within the chunk, from 0 to chunkSize.
+     * @param rowCount Number of rows.
+     * @param heightAt Called as heightAt(x, z) for the height of grid sample (x, z).
+     * @param normalAt Called as normalAt(x, z) for its normal; only used with vertex normals.
+     * @param out Receives rowCount * (chunkSize + 1) vertices.
+     */
+    template <typename HeightAt, typename NormalAt>
+    void writeVertexRows(int chunk, int firstRow, int rowCount, const HeightAt& heightAt,
+                         const NormalAt& normalAt, void* out) const;
+
+    /**
+     * @brief Sets up the VAO and VBO for the terrain and binds the shared EBO, uploading it
+     *        only if it does not hold the right index lists yet.
+     * @param vertexData Vertex buffer contents in the current vertex format, or nullptr to
+     *        only allocate the buffer.
+     * @param vertexBytes Size of vertexData in bytes.
+     * @param vertexBuffer Optional; an already filled buffer to use instead of vertexData.
+     */
+    void setupTerrainVAO(const void* vertexData, size_t vertexBytes, GLuint vertexBuffer = 0);
+
+    /**
+     * @brief Binds the shared EBO to the current VAO, uploading the index lists first if it
+     *        does not hold the layout selected by triangleStrips.
+     */
+    void bindLodIndexBuffer();
+
+    /**
+     * @brief Extracts the Adaptive triangles for adaptiveMaxError, uploads them and binds
+     *        them to the current VAO.
+     */
+    void bindAdaptiveIndexBuffer();
+
+    /**
+     * @brief Re-extracts the Adaptive triangles of some chunks and appends them to adaptiveEBO,
+     *        compacting the buffer when it runs out of room or is mostly replaced ranges.
+     * @param tiles Chunk indices to refresh.
+     */
+    void updateAdaptiveTiles(const std::vector<int>& tiles);
+
     /**
-     * @brief Sets up the VAO, VBO, and EBO for the terrain.
+     * @brief Reallocates adaptiveEBO with room to grow and uploads adaptiveIndices into it.
      */
-    void setupTerrainVAO();
+    void uploadAdaptiveIndices();
+
+    /**
+     * @brief Computes the RTIN errors of every chunk for Adaptive mode and reports the
+     *        triangle count at several error bounds.
+     * @param heights Row-major height grid.
+     * @return True if successful, false otherwise.
+     */
+    bool buildAdaptiveMesh(const float* heights);
+
+    /**
+     * @brief Builds the chunks, uploads the height texture and sets up the shared chunk grid
+     *        for HeightTexture mode.
+     * @param heights Row-major height grid.
+     * @return True if successful, false otherwise.
+     */
+    bool setupHeightTexture(const float* heights);
+
+    /**
+     * @brief Uploads a rectangle of heights to heightTexture in its format.
+     * @param heights Heights of the rectangle, rowStride samples apart.
+     * @param rowStride Distance between rows of heights, in samples.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param columns Number of columns.
+     * @param rows Number of rows.
+     */
+    void uploadHeightTexture(const float* heights, size_t rowStride, int x0, int z0, int columns, int rows);
+
+    /**
+     * @brief Draws the chunks selected this frame in HeightTexture mode, one instanced call
+     *        per index range. The terrain VAO must be bound.
+     * @param primitive GL_TRIANGLES or GL_TRIANGLE_STRIP.
+     */
+    void drawHeightTextureChunks(GLenum primitive);
+
+    /**
+     * @brief Tells whether the active render mode needs the chunked vertex mesh, as opposed
+     *        to generating geometry on the GPU from a height texture.
+     */
+    bool buildsMesh() const;
+
+    /**
+     * @brief Initializes the CDLOD, tessellation, clipmap or height texture renderer from the height grid.
+     * @param heights Row-major height grid.
+     * @param spacing World distance between neighbouring samples.
+     * @return True if successful, false otherwise.
+     */
+    bool initializeHeightTextureRenderer(const float* heights, float spacing);
+
+    /**
+     * @brief Filter actually applied for the current sample step: Point unless the step is a
+     *        power of two above 1.
+     */
+    HeightFilter getEffectiveHeightFilter() const;
+
+    /**
+     * @brief Fills the gridWidth x gridHeight height grid from the decoded heightmap, through
+     *        a filtered mip chain when the step allows it.
+     * @param data 8-bit pixels, or nullptr if data16 is set.
+     * @param data16 16-bit pixels, or nullptr if data is set.
+     * @param heights Receives the row-major heights.
+     */
+    void sampleHeights(const unsigned char* data, const unsigned short* data16, std::vector<float>& heights) const;
+
+    /**
+     * @brief Builds the cache key for the current load settings.
+     */
+    TerrainCacheKey makeCacheKey() const;
+
+    /**
+     * @brief Shared CPU half of loadTerrainData and prepareTerrainData.
+     * @param texturePath Path to the heightmap image.
+     * @param onHeightGrid See prepareTerrainData.
+     * @return True if successful, false otherwise.
+     */
+    bool prepareLoad(const std::string& texturePath, const std::function<void(const float*)>& onHeightGrid);
+
+    /**
+     * @brief Builds everything else from the grid in pending.heights: pyramid, height field,
+     *        slope, normal and horizon maps, chunks and the cache file.
+     * @param timer Timer of the load, reported at the end.
+     * @param cacheKey Key the cache file is written with.
+     * @param useCache Write the cache file.
+     * @param onHeightGrid See prepareTerrainData.
+     * @return True if successful, false otherwise.
+     */
+    bool prepareHeights(LoadStageTimer& timer, TerrainCacheKey cacheKey, bool useCache,
+                        const std::function<void(const float*)>& onHeightGrid);
+
+    /**
+     * @brief Restores the CPU-side terrain from the validated cache in pending.cache.
+     * @param onHeightGrid See prepareTerrainData.
+     * @return True if successful, false otherwise.
+     */
+    bool prepareFromCache(const std::function<void(const float*)>& onHeightGrid);
+
+    /**
+     * @brief Builds the tile file next to the heightmap for Streaming mode if it is missing
+     *        or out of date; loadStreaming opens it when the load is finished.
+     * @param texturePath Path to the heightmap image.
+     * @return True if successful, false otherwise.
+     */
+    bool prepareStreaming(const std::string& texturePath);
+
+    /**
+     * @brief Opens the tile file next to the heightmap for Streaming mode, building it first
+     *        if it is missing or out of date.
+     * @param texturePath Path to the heightmap image.
+     * @return True if successful, false otherwise.
+     */
+    bool loadStreaming(const std::string& texturePath);
+
+    /**
+     * @brief Writes the loaded terrain to a cache file. Failures are reported and otherwise ignored.
+     */
+    void writeCache(const std::string& cachePath, const std::string& sourcePath,
+                    const TerrainCacheKey& key, const std::vector<float>& heights,
+                    const std::vector<unsigned char>& vertexData) const;
+
+    /**
+     * @brief Bakes the normal map on the CPU if it is enabled; finishTerrainData uploads it,
+     *        or releases the old one if nothing was baked.
+     * @param heights Row-major height grid.
+     * @param spacing World distance between neighbouring samples.
+     * @return False if the map is enabled but could not be built.
+     */
+    bool bakeNormalMap(const float* heights, float spacing);
+
+    /**
+     * @brief Bakes the horizon map on the CPU if it is enabled, like bakeNormalMap. Failures
+     *        are reported and leave the terrain without shadows.
+     * @param heights Row-major height grid.
+     * @param spacing World distance between neighbouring samples.
+     */
+    void bakeHorizonMap(const float* heights, float spacing);
 
     /**
      * @brief Calculates normals for the terrain vertices.
+     * @param heights Row-major height grid.
+     */
+    void calculateNormals(const float* heights);
+
+    /**
+     * @brief Computes per-chunk bounding boxes and the vertical error of each LOD level.
+     * @param heights Row-major height grid.
+     */
+    void buildChunks(const float* heights);
+
+    /**
+     * @brief Rebuilds the occluder from the pyramid, at the coarsest block size no drawn
+     *        triangle of the current mode crosses.
+     */
+    void buildOccluder();
+
+    /**
+     * @brief Sets the vertical bounds and per-level errors of one chunk.
+     * @param chunk Chunk to update; its X and Z bounds are left alone.
+     * @param heights Heights of the chunk's (chunkSize + 1)^2 samples, starting at its first one.
+     * @param rowStride Distance between rows of heights, in samples.
+     */
+    static void measureChunk(TerrainChunk& chunk, const float* heights, size_t rowStride);
+
+    /**
+     * @brief Replaces the samples of a rectangle (clipped to the grid) with edit(x, z, height)
+     *        and refreshes what depends on them.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param x1 One past the last column.
+     * @param z1 One past the last row.
+     * @param edit Returns the new height of sample (x, z) from its current one.
+     * @return False if no editable height grid is loaded.
+     */
+    bool editHeights(int x0, int z0, int x1, int z1, const std::function<float(int, int, float)>& edit);
+
+    /**
+     * @brief Brings everything derived from the height grid up to date after the samples in
+     *        [x0, x1) x [z0, z1) changed.
+     */
+    void refreshEditedRegion(int x0, int z0, int x1, int z1);
+
+    /**
+     * @brief Returns the index lists for every LOD level and stitched-edge combination. They
+     *        only depend on chunkSize, so each variant is built once per process.
+     * @param strips True for restart-separated strips, false for cache-optimized lists.
+     */
+    static const TerrainLodIndexSet& getLodIndexSet(bool strips);
+
+    /**
+     * @brief Appends the triangles of one chunk at the given level, stitching flagged edges to the next level.
+     * @param level LOD level of the chunk.
+     * @param edgeMask Combination of TerrainChunkEdge flags for coarser neighbours.
+     * @param triangles Triangle list the indices are appended to, in row order.
+     */
+    static void appendLodIndices(int level, int edgeMask, std::vector<GLuint>& triangles);
+
+    /**
+     * @brief Picks a level for every chunk from its distance to the camera and limits neighbours to one level apart.
+     * @param cameraPosition Camera position in terrain (model) space.
+     * @param pixelsPerUnit Screen pixels covered by one world unit at distance one.
      */
-    void calculateNormals();
+    void selectLodLevels(const glm::vec3& cameraPosition, float pixelsPerUnit);
 };
 
 #endif // TERRAIN_H
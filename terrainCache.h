@@ -0,0 +1,140 @@
+#ifndef TERRAINCACHE_H
+#define TERRAINCACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <GL/glew.h>
+
+struct TerrainChunk;
+
+/// Bump whenever the layout of the cache file or of any stored structure changes.
+const uint32_t TERRAIN_CACHE_VERSION = 6;
+
+/**
+ * @struct TerrainCacheKey
+ * @brief Load settings that must match for a cache file to be reused.
+ */
+struct TerrainCacheKey {
+    int32_t sampleStep;          ///< Heightmap pixels between grid vertices.
+    int32_t chunkSize;           ///< Grid cells per chunk side.
+    int32_t vertexFormat;        ///< TerrainVertexFormat of the stored vertex blob.
+    int32_t includesMesh;        ///< Non-zero if vertices and chunks are stored.
+    int32_t vertexNormals;       ///< Non-zero if the stored vertices carry normals.
+    int32_t heightFilter;        ///< HeightFilter the grid was reduced with.
+    float heightScale;           ///< Terrain height scale.
+    float horizontalScale;       ///< Terrain horizontal scale.
+};
+
+/**
+ * @struct TerrainCacheHeader
+ * @brief Fixed-size header at the start of a cache file. Offsets are from the start of the file.
+ */
+struct TerrainCacheHeader {
+    char magic[8];               ///< "TRNCACHE".
+    uint32_t version;            ///< TERRAIN_CACHE_VERSION.
+    uint32_t headerSize;         ///< sizeof(TerrainCacheHeader) when written.
+    uint64_t sourceSize;         ///< Size of the source heightmap in bytes.
+    int64_t sourceModified;      ///< Modification time of the source heightmap.
+    uint64_t sourceHash;         ///< FNV-1a hash of the source heightmap.
+    TerrainCacheKey key;         ///< Settings the contents were built with.
+
+    int32_t imageWidth, imageHeight;  ///< Dimensions of the source image.
+    int32_t gridWidth, gridHeight;    ///< Dimensions of the sampled grid.
+    int32_t chunksX, chunksZ;         ///< Chunk counts.
+    float minHeight, maxHeight;       ///< Height range of the grid.
+
+    uint64_t heightsOffset;      ///< gridWidth * gridHeight floats.
+    uint64_t vertexOffset;       ///< GPU-ready vertex data, chunk by chunk.
+    uint64_t vertexBytes;
+    uint64_t chunkOffset;        ///< chunksX * chunksZ TerrainChunk records.
+};
+
+/**
+ * @struct TerrainCacheContents
+ * @brief Pointers to everything that gets written into a cache file.
+ */
+struct TerrainCacheContents {
+    int imageWidth, imageHeight;
+    int gridWidth, gridHeight;
+    int chunksX, chunksZ;
+    float minHeight, maxHeight;
+    const float* heights;                ///< gridWidth * gridHeight values.
+    const void* vertexData;              ///< May be null when the key has no mesh.
+    size_t vertexBytes;
+    const TerrainChunk* chunks;          ///< chunksX * chunksZ records.
+};
+
+/**
+ * @class TerrainCache
+ * @brief Versioned binary cache of a processed heightmap, memory-mapped on load.
+ *
+ * A cache is valid while the source file keeps its size and modification time, or, if
+ * those changed, its content hash. All accessors point straight into the mapping and stay
+ * valid until close() or destruction.
+ */
+class TerrainCache {
+public:
+    /**
+     * @brief Constructor.
+     */
+    TerrainCache();
+
+    /**
+     * @brief Destructor. Unmaps the file.
+     */
+    ~TerrainCache();
+
+    TerrainCache(const TerrainCache&) = delete;
+    TerrainCache& operator=(const TerrainCache&) = delete;
+
+    /**
+     * @brief Builds the cache file name used for a heightmap.
+     * @param sourcePath Path to the heightmap image.
+     * @return Path of the cache file next to it.
+     */
+    static std::string cachePathFor(const std::string& sourcePath);
+
+    /**
+     * @brief Maps a cache file and checks it against the source file and load settings.
+     * @param cachePath Path to the cache file.
+     * @param sourcePath Path to the heightmap it was built from.
+     * @param key Current load settings.
+     * @return True if the cache is mapped and up to date, false otherwise.
+     */
+    bool open(const std::string& cachePath, const std::string& sourcePath, const TerrainCacheKey& key);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    void close();
+
+    /**
+     * @brief Writes a new cache file, replacing any existing one atomically.
+     * @param cachePath Path to the cache file.
+     * @param sourcePath Path to the heightmap the contents were built from.
+     * @param key Load settings used to build the contents.
+     * @param contents Data to store.
+     * @return True if successful, false otherwise.
+     */
+    static bool write(const std::string& cachePath, const std::string& sourcePath,
+                      const TerrainCacheKey& key, const TerrainCacheContents& contents);
+
+    // Getters (valid after a successful open)
+    const TerrainCacheHeader& getHeader() const;
+    const float* getHeights() const;
+    const void* getVertexData() const;
+    const TerrainChunk* getChunks() const;
+
+private:
+    const unsigned char* mapping;   ///< Start of the mapped file.
+    size_t mappingSize;             ///< Size of the mapping in bytes.
+    bool mappedFromDisk;            ///< True if mapping came from mmap, false if it was read into memory.
+
+    /**
+     * @brief Checks that a section lies inside the mapping.
+     */
+    bool sectionFits(uint64_t offset, uint64_t bytes) const;
+};
+
+#endif // TERRAINCACHE_H
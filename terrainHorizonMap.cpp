@@ -0,0 +1,275 @@
+#include "terrainHorizonMap.h"
+#include "heightField.h"
+#include "parallel.h"
+#include "simd.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <mutex>
+
+void checkOpenGLError(const std::string& location); // Defined in terrain.cpp
+
+namespace {
+    /// Grid steps of each stored direction, matching the azimuths in the shader.
+    const int directionSteps[horizonDirectionCount][2] = {
+        { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, -1 }, { 1, -1 }
+    };
+
+    struct HullPoint {
+        float distance;   ///< Position along the line, growing back towards the viewer.
+        float height;
+    };
+
+    // Walks one line from its far end (x, z) back towards -direction. The stack holds the
+    // upper hull of the samples walked so far, nearest on top, and the horizon tangent of a
+    // new sample is the hull point it touches tangentially.
+    template <typename HeightAt, typename Store>
+    void sweepLine(int x, int z, int dx, int dz, int gridWidth, int gridHeight, float stepLength,
+                   std::vector<HullPoint>& hull, const HeightAt& heightAt, const Store& store) {
+        hull.clear();
+        for (int step = 0; x >= 0 && x < gridWidth && z >= 0 && z < gridHeight; ++step, x -= dx, z -= dz) {
+            HullPoint point = { step * stepLength, heightAt(x, z) };
+            // Drop hull points hidden behind the one below them as seen from here
+            while (hull.size() >= 2) {
+                const HullPoint& top = hull[hull.size() - 1];
+                const HullPoint& next = hull[hull.size() - 2];
+                if ((top.height - point.height) * (point.distance - next.distance) >
+                    (next.height - point.height) * (point.distance - top.distance)) {
+                    break;
+                }
+                hull.pop_back();
+            }
+            float tangent = 0.0f;
+            if (!hull.empty()) {
+                tangent = std::max((hull.back().height - point.height) / (point.distance - hull.back().distance), 0.0f);
+            }
+            store(x, z, tangent);
+            hull.push_back(point);
+        }
+    }
+
+    // Far end of the line through (x, z): the last sample before a step along (dx, dz) leaves the grid
+    int lineStart(int x, int z, int dx, int dz, int gridWidth, int gridHeight) {
+        int steps = std::max(gridWidth, gridHeight);
+        if (dx > 0) steps = std::min(steps, gridWidth - 1 - x);
+        if (dx < 0) steps = std::min(steps, x);
+        if (dz > 0) steps = std::min(steps, gridHeight - 1 - z);
+        if (dz < 0) steps = std::min(steps, z);
+        return (z + steps * dz) * gridWidth + x + steps * dx;
+    }
+
+    // Horizon tangent of every sample towards (dx, dz), lines split across worker threads
+    void sweepDirection(const float* heights, int gridWidth, int gridHeight, float spacing,
+                        int dx, int dz, float* tangents) {
+        // A line starts at every sample whose next step along the direction leaves the grid
+        std::vector<int> starts;
+        for (int z = 0; z < gridHeight; ++z) {
+            for (int x = 0; x < gridWidth; ++x) {
+                int nx = x + dx, nz = z + dz;
+                if (nx < 0 || nx >= gridWidth || nz < 0 || nz >= gridHeight) {
+                    starts.push_back(z * gridWidth + x);
+                }
+            }
+        }
+
+        const float stepLength = spacing * std::sqrt(static_cast<float>(dx * dx + dz * dz));
+        parallelFor(0, static_cast<int>(starts.size()), [&](int begin, int end) {
+            std::vector<HullPoint> hull;
+            hull.reserve(std::max(gridWidth, gridHeight));
+            auto heightAt = [&](int x, int z) { return heights[static_cast<size_t>(z) * gridWidth + x]; };
+            auto store = [&](int x, int z, float tangent) { tangents[static_cast<size_t>(z) * gridWidth + x] = tangent; };
+            for (int line = begin; line < end; ++line) {
+                sweepLine(starts[line] % gridWidth, starts[line] / gridWidth, dx, dz, gridWidth, gridHeight,
+                          stepLength, hull, heightAt, store);
+            }
+        }, 8);
+    }
+
+    // Scalar form of the conversion in storeSines
+    unsigned char quantizeSine(float tangent) {
+        float scaled = tangent / std::sqrt(1.0f + tangent * tangent) * 255.0f;
+        return static_cast<unsigned char>(std::min(scaled + 0.5f, 255.0f));
+    }
+
+    // sin(atan(t)) = t / sqrt(1 + t^2), quantized into one channel of the interleaved texels
+    void storeSines(float* tangents, size_t count, unsigned char* texels, int channel) {
+        parallelFor(0, static_cast<int>(count), [&](int begin, int end) {
+            int i = begin;
+            const simd::float4 one = simd::splat(1.0f);
+            const simd::float4 scale = simd::splat(255.0f);
+            for (; i + 4 <= end; i += 4) {
+                simd::float4 t = simd::load(tangents + i);
+                simd::float4 sine = simd::div(t, simd::sqrt(simd::add(one, simd::mul(t, t))));
+                simd::store(tangents + i, simd::mul(sine, scale));
+            }
+            for (; i < end; ++i) {
+                tangents[i] = tangents[i] / std::sqrt(1.0f + tangents[i] * tangents[i]) * 255.0f;
+            }
+            for (int j = begin; j < end; ++j) {
+                texels[static_cast<size_t>(j) * 4 + channel] = static_cast<unsigned char>(std::min(tangents[j] + 0.5f, 255.0f));
+            }
+        }, 16384);
+    }
+}
+
+// Constructor
+TerrainHorizonMap::TerrainHorizonMap()
+    : texture(0), gridWidth(0), gridHeight(0), spacing(1.0f), maxTextureSize(0) {
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+}
+
+bool TerrainHorizonMap::build(const float* heights, int gridWidth, int gridHeight, float spacing) {
+    if (!bake(heights, gridWidth, gridHeight, spacing)) {
+        cleanup();
+        return false;
+    }
+    upload();
+    return true;
+}
+
+bool TerrainHorizonMap::bake(const float* heights, int gridWidth, int gridHeight, float spacing) {
+    texels.clear();
+    this->gridWidth = gridWidth;
+    this->gridHeight = gridHeight;
+    this->spacing = spacing;
+    if (gridWidth > maxTextureSize || gridHeight > maxTextureSize) {
+        std::cerr << "ERROR: Height grid " << gridWidth << " x " << gridHeight
+            << " exceeds the maximum texture size " << maxTextureSize << std::endl;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const size_t sampleCount = static_cast<size_t>(gridWidth) * gridHeight;
+    const int layerCount = horizonDirectionCount / 4;
+    texels.assign(sampleCount * 4 * layerCount, 0);
+    std::vector<float> tangents(sampleCount);
+    for (int direction = 0; direction < horizonDirectionCount; ++direction) {
+        sweepDirection(heights, gridWidth, gridHeight, spacing,
+                       directionSteps[direction][0], directionSteps[direction][1], tangents.data());
+        storeSines(tangents.data(), sampleCount, &texels[sampleCount * 4 * (direction / 4)], direction % 4);
+    }
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "INFO: Baked terrain horizon map " << gridWidth << " x " << gridHeight << " ("
+        << horizonDirectionCount << " directions, " << texels.size() / (1024 * 1024) << " MB) in "
+        << milliseconds << " ms" << std::endl;
+    return true;
+}
+
+void TerrainHorizonMap::upload() {
+    if (texels.empty()) {
+        return;
+    }
+    const int layerCount = horizonDirectionCount / 4;
+    if (texture) glDeleteTextures(1, &texture);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, gridWidth, gridHeight, layerCount, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    checkOpenGLError("TerrainHorizonMap::upload");
+}
+
+// Every line through the rectangle crosses its border, so the lines to re-sweep are found
+// from the border samples alone.
+void TerrainHorizonMap::update(const HeightField& heights, int x0, int z0, int x1, int z1) {
+    if (!texture) {
+        return;
+    }
+    x0 = std::max(x0, 0);
+    z0 = std::max(z0, 0);
+    x1 = std::min(x1, gridWidth);
+    z1 = std::min(z1, gridHeight);
+    if (x0 >= x1 || z0 >= z1) {
+        return;
+    }
+
+    const size_t sampleCount = static_cast<size_t>(gridWidth) * gridHeight;
+    int changedX0 = gridWidth, changedZ0 = gridHeight, changedX1 = 0, changedZ1 = 0;
+    std::mutex changedMutex;
+    std::vector<int> starts;
+    for (int direction = 0; direction < horizonDirectionCount; ++direction) {
+        const int dx = directionSteps[direction][0];
+        const int dz = directionSteps[direction][1];
+        starts.clear();
+        for (int x = x0; x < x1; ++x) {
+            starts.push_back(lineStart(x, z0, dx, dz, gridWidth, gridHeight));
+            starts.push_back(lineStart(x, z1 - 1, dx, dz, gridWidth, gridHeight));
+        }
+        for (int z = z0; z < z1; ++z) {
+            starts.push_back(lineStart(x0, z, dx, dz, gridWidth, gridHeight));
+            starts.push_back(lineStart(x1 - 1, z, dx, dz, gridWidth, gridHeight));
+        }
+        std::sort(starts.begin(), starts.end());
+        starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+        unsigned char* layer = &texels[sampleCount * 4 * (direction / 4)];
+        const int channel = direction % 4;
+        const float stepLength = spacing * std::sqrt(static_cast<float>(dx * dx + dz * dz));
+        parallelFor(0, static_cast<int>(starts.size()), [&](int begin, int end) {
+            std::vector<HullPoint> hull;
+            hull.reserve(std::max(gridWidth, gridHeight));
+            int minX = gridWidth, minZ = gridHeight, maxX = -1, maxZ = -1;
+            auto heightAt = [&](int x, int z) { return heights.getSample(x, z); };
+            auto store = [&](int x, int z, float tangent) {
+                unsigned char& texel = layer[(static_cast<size_t>(z) * gridWidth + x) * 4 + channel];
+                unsigned char value = quantizeSine(tangent);
+                if (texel != value) {
+                    texel = value;
+                    minX = std::min(minX, x);
+                    maxX = std::max(maxX, x);
+                    minZ = std::min(minZ, z);
+                    maxZ = std::max(maxZ, z);
+                }
+            };
+            for (int line = begin; line < end; ++line) {
+                sweepLine(starts[line] % gridWidth, starts[line] / gridWidth, dx, dz, gridWidth, gridHeight,
+                          stepLength, hull, heightAt, store);
+            }
+            if (maxX >= 0) {
+                std::lock_guard<std::mutex> lock(changedMutex);
+                changedX0 = std::min(changedX0, minX);
+                changedZ0 = std::min(changedZ0, minZ);
+                changedX1 = std::max(changedX1, maxX + 1);
+                changedZ1 = std::max(changedZ1, maxZ + 1);
+            }
+        }, 8);
+    }
+    if (changedX0 >= changedX1) {
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, gridWidth);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, gridHeight);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, changedX0, changedZ0, 0, changedX1 - changedX0, changedZ1 - changedZ0,
+                    horizonDirectionCount / 4, GL_RGBA, GL_UNSIGNED_BYTE,
+                    &texels[(static_cast<size_t>(changedZ0) * gridWidth + changedX0) * 4]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    checkOpenGLError("TerrainHorizonMap::update");
+}
+
+// Cleanup
+void TerrainHorizonMap::cleanup() {
+    if (texture) glDeleteTextures(1, &texture);
+    texture = 0;
+    texels.clear();
+    texels.shrink_to_fit();
+}
+
+// Getters
+GLuint TerrainHorizonMap::getTexture() const { return texture; }
+bool TerrainHorizonMap::isBuilt() const { return texture != 0; }
+bool TerrainHorizonMap::isBaked() const { return !texels.empty(); }
@@ -0,0 +1,61 @@
+#ifndef TERRAININDICES_H
+#define TERRAININDICES_H
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+/// Index that ends a triangle strip when primitive restart is enabled.
+const GLuint terrainRestartIndex = 0xFFFFFFFF;
+
+/// terrainRestartIndex narrowed to a 16-bit index buffer.
+const GLushort terrainShortRestartIndex = 0xFFFF;
+
+/// FIFO size used for ordering and statistics; typical of current desktop GPUs.
+const int terrainVertexCacheSize = 32;
+
+/**
+ * @brief Reorders a triangle list for post-transform vertex cache reuse (Forsyth's
+ *        linear-speed algorithm). Triangles keep their winding.
+ * @param indices Triangle list, modified in place.
+ * @param indexCount Number of indices (a multiple of 3).
+ * @param cacheSize Simulated LRU cache size.
+ */
+void optimizeVertexCache(GLuint* indices, size_t indexCount, int cacheSize = terrainVertexCacheSize);
+
+/**
+ * @brief Converts a triangle list into strips separated by terrainRestartIndex.
+ *
+ * Consecutive triangles that share an edge with matching winding extend the current strip;
+ * anything else starts a new one. Feed it triangles in strip-friendly (row) order.
+ *
+ * @param triangles Triangle list.
+ * @param indexCount Number of indices (a multiple of 3).
+ * @param strips Output; strips are appended.
+ */
+void buildTriangleStrips(const GLuint* triangles, size_t indexCount, std::vector<GLuint>& strips);
+
+/**
+ * @struct VertexCacheStats
+ * @brief Result of running an index list through a simulated FIFO vertex cache.
+ */
+struct VertexCacheStats {
+    size_t triangles = 0;        ///< Triangles drawn.
+    size_t transforms = 0;       ///< Vertex shader invocations (cache misses).
+
+    /** @brief Average cache miss ratio: transforms per triangle. */
+    float acmr() const { return triangles ? static_cast<float>(transforms) / triangles : 0.0f; }
+};
+
+/**
+ * @brief Simulates a FIFO vertex cache over an index list.
+ * @param indices Triangle list, or strips separated by terrainRestartIndex.
+ * @param indexCount Number of indices.
+ * @param strips True if indices are restart-separated strips.
+ * @param stats Counters are added to.
+ * @param cacheSize FIFO size.
+ */
+void measureVertexCache(const GLuint* indices, size_t indexCount, bool strips, VertexCacheStats& stats,
+                        int cacheSize = terrainVertexCacheSize);
+
+#endif // TERRAININDICES_H
@@ -0,0 +1,87 @@
+#ifndef TERRAINNORMALMAP_H
+#define TERRAINNORMALMAP_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @class TerrainNormalMap
+ * @brief Mipmapped normal texture baked from the full-resolution height grid.
+ *
+ * Texel (x, z) of level 0 holds the normal of grid sample (x, z). Only the X and Z components
+ * are stored, as 16-bit signed normalized values; terrain normals always point up, so Y is
+ * rebuilt as sqrt(1 - x^2 - z^2) when sampling. Each coarser level averages 2 x 2 normals of
+ * the level above and renormalizes them. Every level is computed across worker threads.
+ * The encoded levels stay on the CPU so an edit can refresh just the texels it touched.
+ */
+class TerrainNormalMap {
+public:
+    /**
+     * @brief Constructor.
+     */
+    TerrainNormalMap();
+
+    /**
+     * @brief Computes the normals and mip chain and uploads them, replacing any previous texture.
+     * @param heights Row-major height grid.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @return True if successful, false otherwise.
+     */
+    bool build(const float* heights, int gridWidth, int gridHeight, float spacing);
+
+    /**
+     * @brief The CPU half of build: computes and encodes every level without touching OpenGL,
+     *        so it may run on a worker thread. The previous texture stays until upload().
+     * @param heights Row-major height grid.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @return False if the grid exceeds the maximum texture size.
+     */
+    bool bake(const float* heights, int gridWidth, int gridHeight, float spacing);
+
+    /**
+     * @brief The OpenGL half of build: creates the texture from the baked levels, replacing any
+     *        previous one. Does nothing if nothing is baked.
+     */
+    void upload();
+
+    /**
+     * @brief Replaces the level 0 normals of a rectangle, recomputes the texels above it in
+     *        every coarser level and uploads only those texels.
+     * @param normals Normals of the rectangle, rowStride normals apart.
+     * @param rowStride Distance between rows of normals.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param width Number of columns.
+     * @param height Number of rows.
+     */
+    void update(const glm::vec3* normals, size_t rowStride, int x0, int z0, int width, int height);
+
+    /**
+     * @brief Cleans up OpenGL resources.
+     */
+    void cleanup();
+
+    // Getters
+    GLuint getTexture() const;
+    bool isBuilt() const;
+    bool isBaked() const;        ///< Levels are computed, whether or not they are uploaded yet.
+    int getLevelCount() const;
+
+private:
+    struct Level {
+        int width, height;
+        std::vector<GLshort> texels;   ///< Interleaved X and Z, as uploaded.
+    };
+
+    GLuint texture;              ///< RG16_SNORM texture with a full mip chain.
+    int levelCount;              ///< Number of uploaded levels.
+    std::vector<Level> levels;   ///< CPU copy of every level.
+    GLint maxTextureSize;        ///< Queried at construction so bake() needs no context.
+};
+
+#endif // TERRAINNORMALMAP_H
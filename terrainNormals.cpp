@@ -0,0 +1,72 @@
+#include "terrainNormals.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Rows per thread below which spawning is not worth it
+    const int minRowsPerThread = 16;
+
+    inline glm::vec3 normalAt(const float* heights, int gridWidth, int gridHeight, float spacing, int x, int z) {
+        const float* row = heights + z * gridWidth;
+        float left = row[std::max(x - 1, 0)];
+        float right = row[std::min(x + 1, gridWidth - 1)];
+        float back = heights[std::max(z - 1, 0) * gridWidth + x];
+        float front = heights[std::min(z + 1, gridHeight - 1) * gridWidth + x];
+        return glm::normalize(glm::vec3(left - right, 2.0f * spacing, back - front));
+    }
+
+    void computeRow(const float* heights, int gridWidth, int gridHeight, float spacing,
+                    glm::vec3* normals, int z, int x0, int x1) {
+        const float* row = heights + z * gridWidth;
+        const float* back = heights + std::max(z - 1, 0) * gridWidth;
+        const float* front = heights + std::min(z + 1, gridHeight - 1) * gridWidth;
+        glm::vec3* out = normals + z * gridWidth;
+
+        // The vector loop needs both X neighbours inside the row
+        int x = x0;
+        if (x == 0) {
+            out[0] = normalAt(heights, gridWidth, gridHeight, spacing, 0, z);
+            ++x;
+        }
+        int vectorEnd = std::min(x1, gridWidth - 1);
+
+        const simd::float4 up = simd::splat(2.0f * spacing);
+        const simd::float4 upSquared = simd::mul(up, up);
+        const simd::float4 one = simd::splat(1.0f);
+        for (; x + 4 <= vectorEnd; x += 4) {
+            simd::float4 nx = simd::sub(simd::load(row + x - 1), simd::load(row + x + 1));
+            simd::float4 nz = simd::sub(simd::load(back + x), simd::load(front + x));
+            simd::float4 lengthSquared = simd::add(simd::add(simd::mul(nx, nx), simd::mul(nz, nz)), upSquared);
+            simd::float4 inverseLength = simd::div(one, simd::sqrt(lengthSquared));
+            simd::storeInterleaved3(&out[x].x, simd::mul(nx, inverseLength),
+                                    simd::mul(up, inverseLength), simd::mul(nz, inverseLength));
+        }
+        for (; x < x1; ++x) {
+            out[x] = normalAt(heights, gridWidth, gridHeight, spacing, x, z);
+        }
+    }
+}
+
+void computeGridNormals(const float* heights, int gridWidth, int gridHeight, float spacing,
+                        glm::vec3* normals, int x0, int z0, int x1, int z1) {
+    x0 = std::max(x0, 0);
+    z0 = std::max(z0, 0);
+    x1 = std::min(x1, gridWidth);
+    z1 = std::min(z1, gridHeight);
+    if (x0 >= x1 || z0 >= z1) {
+        return;
+    }
+
+    parallelFor(z0, z1, [&](int rowBegin, int rowEnd) {
+        for (int z = rowBegin; z < rowEnd; ++z) {
+            computeRow(heights, gridWidth, gridHeight, spacing, normals, z, x0, x1);
+        }
+    }, minRowsPerThread);
+}
+
+void computeGridNormals(const float* heights, int gridWidth, int gridHeight, float spacing,
+                        glm::vec3* normals) {
+    computeGridNormals(heights, gridWidth, gridHeight, spacing, normals, 0, 0, gridWidth, gridHeight);
+}
@@ -0,0 +1,328 @@
+#include "terrainOcclusion.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    const float farDepth = 1.0f;   ///< Depth of pixels no occluder covers.
+
+    // Edge function a * x + b * y + c, positive on the inner side of a counter-clockwise edge
+    struct Edge {
+        float a, b, c;
+    };
+
+    Edge makeEdge(const glm::vec3& from, const glm::vec3& to) {
+        Edge edge;
+        edge.a = from.y - to.y;
+        edge.b = to.x - from.x;
+        edge.c = -(edge.a * from.x + edge.b * from.y);
+        return edge;
+    }
+}
+
+// Constructor
+TerrainOcclusion::TerrainOcclusion()
+    : verticesX(0), verticesZ(0),
+    viewProjection(1.0f), rasterized(false) {}
+
+// Corner vertices take the lowest height of the (up to four) blocks around them, so any point
+// of a block is interpolated from heights at or below the block's minimum
+void TerrainOcclusion::build(const HeightPyramid& pyramid, int gridWidth, int gridHeight, float spacing, int level) {
+    clear();
+    if (pyramid.getLevelCount() == 0) {
+        return;
+    }
+    level = std::min(std::max(level, 0), pyramid.getLevelCount() - 1);
+    const int blocksX = pyramid.getLevelWidth(level);
+    const int blocksZ = pyramid.getLevelHeight(level);
+    const int blockCells = 1 << level;
+    verticesX = blocksX + 1;
+    verticesZ = blocksZ + 1;
+
+    const size_t vertexCount = static_cast<size_t>(verticesX) * verticesZ;
+    occluderX.resize(vertexCount);
+    occluderY.resize(vertexCount);
+    occluderZ.resize(vertexCount);
+    for (int z = 0; z < verticesZ; ++z) {
+        for (int x = 0; x < verticesX; ++x) {
+            float lowest = std::numeric_limits<float>::max();
+            for (int bz = z - 1; bz <= z; ++bz) {
+                for (int bx = x - 1; bx <= x; ++bx) {
+                    float blockMin, blockMax;
+                    if (pyramid.getMinMax(level, bx, bz, blockMin, blockMax)) {
+                        lowest = std::min(lowest, blockMin);
+                    }
+                }
+            }
+            size_t index = static_cast<size_t>(z) * verticesX + x;
+            occluderX[index] = std::min(x * blockCells, gridWidth - 1) * spacing;
+            occluderY[index] = lowest;
+            occluderZ[index] = std::min(z * blockCells, gridHeight - 1) * spacing;
+        }
+    }
+    screenX.resize(vertexCount);
+    screenY.resize(vertexCount);
+    screenZ.resize(vertexCount);
+    screenW.resize(vertexCount);
+    depth.assign(static_cast<size_t>(bufferWidth) * bufferHeight, farDepth);
+    testDepth.assign(depth.size(), farDepth);
+}
+
+void TerrainOcclusion::clear() {
+    verticesX = verticesZ = 0;
+    occluderX.clear();
+    occluderY.clear();
+    occluderZ.clear();
+    screenX.clear();
+    screenY.clear();
+    screenZ.clear();
+    screenW.clear();
+    triangles.clear();
+    for (auto& bin : tileBins) {
+        bin.clear();
+    }
+    depth.clear();
+    testDepth.clear();
+    rasterized = false;
+}
+
+void TerrainOcclusion::rasterize(const glm::mat4& viewProjection) {
+    rasterized = false;
+    if (!isBuilt()) {
+        return;
+    }
+    this->viewProjection = viewProjection;
+    transformVertices();
+    binTriangles();
+    parallelFor(0, tilesX * tilesY, [this](int begin, int end) {
+        for (int tile = begin; tile < end; ++tile) {
+            rasterizeTile(tile);
+        }
+    });
+    erodeDepth();
+    rasterized = true;
+}
+
+void TerrainOcclusion::transformVertices() {
+    const glm::mat4& m = viewProjection;
+    const int count = static_cast<int>(occluderX.size());
+    parallelFor(0, count, [&](int begin, int end) {
+        const simd::float4 half = simd::splat(0.5f);
+        const simd::float4 one = simd::splat(1.0f);
+        const simd::float4 width = simd::splat(static_cast<float>(bufferWidth));
+        const simd::float4 height = simd::splat(static_cast<float>(bufferHeight));
+        auto row = [&](int r, simd::float4 x, simd::float4 y, simd::float4 z) {
+            return simd::add(simd::add(simd::mul(simd::splat(m[0][r]), x), simd::mul(simd::splat(m[1][r]), y)),
+                             simd::add(simd::mul(simd::splat(m[2][r]), z), simd::splat(m[3][r])));
+        };
+        int i = begin;
+        for (; i + 4 <= end; i += 4) {
+            simd::float4 x = simd::load(&occluderX[i]);
+            simd::float4 y = simd::load(&occluderY[i]);
+            simd::float4 z = simd::load(&occluderZ[i]);
+            simd::float4 clipW = row(3, x, y, z);
+            simd::float4 inverseW = simd::div(one, clipW);
+            simd::store(&screenX[i], simd::mul(simd::add(simd::mul(simd::mul(row(0, x, y, z), inverseW), half), half), width));
+            simd::store(&screenY[i], simd::mul(simd::add(simd::mul(simd::mul(row(1, x, y, z), inverseW), half), half), height));
+            simd::store(&screenZ[i], simd::mul(row(2, x, y, z), inverseW));
+            simd::store(&screenW[i], clipW);
+        }
+        for (; i < end; ++i) {
+            glm::vec4 clip = m * glm::vec4(occluderX[i], occluderY[i], occluderZ[i], 1.0f);
+            screenX[i] = (clip.x / clip.w * 0.5f + 0.5f) * bufferWidth;
+            screenY[i] = (clip.y / clip.w * 0.5f + 0.5f) * bufferHeight;
+            screenZ[i] = clip.z / clip.w;
+            screenW[i] = clip.w;
+        }
+    }, 1024);
+}
+
+// Triangles touching the near plane are dropped rather than clipped; a missing occluder only
+// costs culling, never correctness
+void TerrainOcclusion::binTriangles() {
+    triangles.clear();
+    for (auto& bin : tileBins) {
+        bin.clear();
+    }
+
+    auto inFront = [this](int v) { return screenW[v] > 0.0f && screenZ[v] >= -1.0f; };
+    auto addTriangle = [&](int v0, int v1, int v2) {
+        if (!inFront(v0) || !inFront(v1) || !inFront(v2)) {
+            return;
+        }
+        ScreenTriangle triangle;
+        triangle.vertices[0] = glm::vec3(screenX[v0], screenY[v0], screenZ[v0]);
+        triangle.vertices[1] = glm::vec3(screenX[v1], screenY[v1], screenZ[v1]);
+        triangle.vertices[2] = glm::vec3(screenX[v2], screenY[v2], screenZ[v2]);
+
+        // Both windings are kept; the tiles flip clockwise triangles themselves
+        const glm::vec3* v = triangle.vertices;
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if (area == 0.0f) {
+            return;
+        }
+        float minX = std::max(std::min(std::min(v[0].x, v[1].x), v[2].x), 0.0f);
+        float maxX = std::min(std::max(std::max(v[0].x, v[1].x), v[2].x), static_cast<float>(bufferWidth));
+        float minY = std::max(std::min(std::min(v[0].y, v[1].y), v[2].y), 0.0f);
+        float maxY = std::min(std::max(std::max(v[0].y, v[1].y), v[2].y), static_cast<float>(bufferHeight));
+        if (minX >= maxX || minY >= maxY) {
+            return;
+        }
+
+        int index = static_cast<int>(triangles.size());
+        triangles.push_back(triangle);
+        int tileX0 = static_cast<int>(minX) / tileSize;
+        int tileX1 = std::min(static_cast<int>(maxX) / tileSize, tilesX - 1);
+        int tileY0 = static_cast<int>(minY) / tileSize;
+        int tileY1 = std::min(static_cast<int>(maxY) / tileSize, tilesY - 1);
+        for (int ty = tileY0; ty <= tileY1; ++ty) {
+            for (int tx = tileX0; tx <= tileX1; ++tx) {
+                tileBins[ty * tilesX + tx].push_back(index);
+            }
+        }
+    };
+
+    for (int z = 0; z + 1 < verticesZ; ++z) {
+        for (int x = 0; x + 1 < verticesX; ++x) {
+            int topLeft = z * verticesX + x;
+            int topRight = topLeft + 1;
+            int bottomLeft = topLeft + verticesX;
+            int bottomRight = bottomLeft + 1;
+            addTriangle(topLeft, bottomLeft, topRight);
+            addTriangle(topRight, bottomLeft, bottomRight);
+        }
+    }
+}
+
+// Pixel centres are tested four at a time against the three edges; the depth plane is
+// evaluated at the same centres and kept where it is nearer
+void TerrainOcclusion::rasterizeTile(int tile) {
+    const int tileX0 = (tile % tilesX) * tileSize;
+    const int tileY0 = (tile / tilesX) * tileSize;
+    for (int y = tileY0; y < tileY0 + tileSize; ++y) {
+        std::fill_n(&depth[static_cast<size_t>(y) * bufferWidth + tileX0], tileSize, farDepth);
+    }
+
+    const simd::float4 zero = simd::splat(0.0f);
+    const float laneOffsetsArray[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+    const simd::float4 laneOffsets = simd::load(laneOffsetsArray);
+    for (int index : tileBins[tile]) {
+        glm::vec3 v[3] = { triangles[index].vertices[0], triangles[index].vertices[1], triangles[index].vertices[2] };
+        float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if (area < 0.0f) {
+            std::swap(v[1], v[2]);
+            area = -area;
+        }
+        Edge edges[3] = { makeEdge(v[1], v[2]), makeEdge(v[2], v[0]), makeEdge(v[0], v[1]) };
+
+        // Depth plane from the barycentric weights, which are the edge functions over the area
+        float depthA = (edges[0].a * v[0].z + edges[1].a * v[1].z + edges[2].a * v[2].z) / area;
+        float depthB = (edges[0].b * v[0].z + edges[1].b * v[1].z + edges[2].b * v[2].z) / area;
+        float depthC = (edges[0].c * v[0].z + edges[1].c * v[1].z + edges[2].c * v[2].z) / area;
+
+        // Bounds inside the tile, starting on a multiple of four
+        int x0 = std::max(static_cast<int>(std::floor(std::min(std::min(v[0].x, v[1].x), v[2].x))), tileX0) & ~3;
+        int x1 = std::min(static_cast<int>(std::ceil(std::max(std::max(v[0].x, v[1].x), v[2].x))), tileX0 + tileSize);
+        int y0 = std::max(static_cast<int>(std::floor(std::min(std::min(v[0].y, v[1].y), v[2].y))), tileY0);
+        int y1 = std::min(static_cast<int>(std::ceil(std::max(std::max(v[0].y, v[1].y), v[2].y))), tileY0 + tileSize);
+
+        for (int y = y0; y < y1; ++y) {
+            const float centreY = y + 0.5f;
+            simd::float4 rowEdge[3];
+            for (int e = 0; e < 3; ++e) {
+                rowEdge[e] = simd::splat(edges[e].b * centreY + edges[e].c);
+            }
+            const simd::float4 rowDepth = simd::splat(depthB * centreY + depthC);
+            float* row = &depth[static_cast<size_t>(y) * bufferWidth];
+            for (int x = x0; x < x1; x += 4) {
+                simd::float4 centreX = simd::add(simd::splat(static_cast<float>(x)), laneOffsets);
+                simd::mask4 inside = simd::both(
+                    simd::both(simd::greaterEqual(simd::add(simd::mul(simd::splat(edges[0].a), centreX), rowEdge[0]), zero),
+                               simd::greaterEqual(simd::add(simd::mul(simd::splat(edges[1].a), centreX), rowEdge[1]), zero)),
+                    simd::greaterEqual(simd::add(simd::mul(simd::splat(edges[2].a), centreX), rowEdge[2]), zero));
+                simd::float4 pixelDepth = simd::add(simd::mul(simd::splat(depthA), centreX), rowDepth);
+                simd::float4 current = simd::load(row + x);
+                simd::store(row + x, simd::select(inside, simd::min(current, pixelDepth), current));
+            }
+        }
+    }
+}
+
+// Separable 3 x 3 maximum: along rows into testDepth, then down the columns four at a time
+void TerrainOcclusion::erodeDepth() {
+    std::vector<float>& rowMax = testDepth;
+    parallelFor(0, bufferHeight, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const float* source = &depth[static_cast<size_t>(y) * bufferWidth];
+            float* target = &rowMax[static_cast<size_t>(y) * bufferWidth];
+            for (int x = 0; x < bufferWidth; ++x) {
+                float farthest = source[x];
+                if (x > 0) farthest = std::max(farthest, source[x - 1]);
+                if (x + 1 < bufferWidth) farthest = std::max(farthest, source[x + 1]);
+                target[x] = farthest;
+            }
+        }
+    }, 16);
+
+    // Rows of the column pass read their neighbours, so the row maxima move to depth first;
+    // the next rasterization clears it anyway
+    depth.swap(testDepth);
+    const std::vector<float>& columnSource = depth;
+    parallelFor(0, bufferHeight, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const float* above = &columnSource[static_cast<size_t>(std::max(y - 1, 0)) * bufferWidth];
+            const float* centre = &columnSource[static_cast<size_t>(y) * bufferWidth];
+            const float* below = &columnSource[static_cast<size_t>(std::min(y + 1, bufferHeight - 1)) * bufferWidth];
+            float* target = &testDepth[static_cast<size_t>(y) * bufferWidth];
+            for (int x = 0; x < bufferWidth; x += 4) {
+                simd::store(target + x, simd::max(simd::max(simd::load(above + x), simd::load(centre + x)), simd::load(below + x)));
+            }
+        }
+    }, 16);
+}
+
+// The box's nearest corner depth against the farthest occluder depth under its screen rectangle
+bool TerrainOcclusion::isOccluded(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    if (!rasterized) {
+        return false;
+    }
+    float minX = std::numeric_limits<float>::max(), minY = minX, nearest = minX;
+    float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 position((corner & 1) ? boxMax.x : boxMin.x, (corner & 2) ? boxMax.y : boxMin.y, (corner & 4) ? boxMax.z : boxMin.z);
+        glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+            return false;  // Reaches the near plane
+        }
+        float x = (clip.x / clip.w * 0.5f + 0.5f) * bufferWidth;
+        float y = (clip.y / clip.w * 0.5f + 0.5f) * bufferHeight;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, clip.z / clip.w);
+    }
+
+    int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(maxX)), bufferWidth);
+    int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
+    int y1 = std::min(static_cast<int>(std::ceil(maxY)), bufferHeight);
+    if (x0 >= x1 || y0 >= y1) {
+        return false;  // Off screen; left to the frustum test
+    }
+    for (int y = y0; y < y1; ++y) {
+        const float* row = &testDepth[static_cast<size_t>(y) * bufferWidth];
+        for (int x = x0; x < x1; ++x) {
+            if (row[x] >= nearest) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Getters
+bool TerrainOcclusion::isBuilt() const { return !occluderX.empty(); }
+size_t TerrainOcclusion::getRasterizedTriangleCount() const { return triangles.size(); }
@@ -0,0 +1,107 @@
+#ifndef TERRAINOCCLUSION_H
+#define TERRAINOCCLUSION_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "heightPyramid.h"
+
+/**
+ * @class TerrainOcclusion
+ * @brief Software occlusion culling of terrain chunks against a coarse version of the terrain.
+ *
+ * The occluder is a grid over the blocks of one pyramid level, each vertex at the lowest
+ * height of the blocks around it, so it lies on or under every triangle the renderer draws
+ * within a block. It is rasterized into a small depth buffer on the CPU: vertices are
+ * transformed four at a time, triangles are binned into screen tiles, and the tiles are
+ * filled in parallel, four pixels at a time. A bounding box is occluded when its nearest
+ * depth lies behind the buffer at every pixel it covers. The buffer is eroded by a pixel
+ * first, so occluder edges that only cover part of a pixel do not hide anything.
+ *
+ * The test is only valid while the camera is above the terrain.
+ */
+class TerrainOcclusion {
+public:
+    /**
+     * @brief Constructor. Nothing is occluded until build() and rasterize() are called.
+     */
+    TerrainOcclusion();
+
+    /**
+     * @brief Builds the occluder grid from one level of the min/max pyramid.
+     * @param pyramid Min/max pyramid of the height grid.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @param level Pyramid level of the occluder cells. No drawn triangle may cross a block
+     *              of this level, or the occluder may rise above it.
+     */
+    void build(const HeightPyramid& pyramid, int gridWidth, int gridHeight, float spacing, int level);
+
+    /**
+     * @brief Releases the occluder and forgets the last rasterization.
+     */
+    void clear();
+
+    /**
+     * @brief Rasterizes the occluder for a view.
+     * @param viewProjection Matrix that takes terrain-space positions to clip space.
+     */
+    void rasterize(const glm::mat4& viewProjection);
+
+    /**
+     * @brief Tests a box against the last rasterization.
+     * @param boxMin Minimum corner in terrain space.
+     * @param boxMax Maximum corner in terrain space.
+     * @return True only if the box is hidden behind the occluder at every pixel it covers.
+     */
+    bool isOccluded(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+    // Getters
+    bool isBuilt() const;
+    size_t getRasterizedTriangleCount() const;
+
+private:
+    static const int bufferWidth = 256;      ///< Depth buffer columns.
+    static const int bufferHeight = 128;     ///< Depth buffer rows.
+    static const int tileSize = 32;          ///< Pixels per tile side; a multiple of four.
+    static const int tilesX = bufferWidth / tileSize;
+    static const int tilesY = bufferHeight / tileSize;
+
+    /// Triangle in buffer pixels (x, y) and normalized device depth (z).
+    struct ScreenTriangle {
+        glm::vec3 vertices[3];
+    };
+
+    int verticesX, verticesZ;                ///< Occluder grid dimensions in vertices.
+    std::vector<float> occluderX, occluderY, occluderZ; ///< Occluder vertices in terrain space.
+    std::vector<float> screenX, screenY, screenZ, screenW; ///< Transformed occluder vertices.
+    std::vector<ScreenTriangle> triangles;   ///< Triangles that survived setup this frame.
+    std::vector<int> tileBins[tilesX * tilesY]; ///< Triangles overlapping each tile.
+    std::vector<float> depth;                ///< Nearest occluder depth per pixel.
+    std::vector<float> testDepth;            ///< Depth eroded by a pixel, used by isOccluded.
+    glm::mat4 viewProjection;                ///< Matrix of the last rasterization.
+    bool rasterized;                         ///< testDepth matches viewProjection.
+
+    /**
+     * @brief Transforms the occluder vertices to buffer space, four at a time.
+     */
+    void transformVertices();
+
+    /**
+     * @brief Sets up the occluder triangles in front of the near plane and bins them by tile.
+     */
+    void binTriangles();
+
+    /**
+     * @brief Clears a tile and rasterizes its triangles into it.
+     * @param tile Tile index, row-major.
+     */
+    void rasterizeTile(int tile);
+
+    /**
+     * @brief Replaces every pixel of testDepth by the farthest depth around it in depth.
+     */
+    void erodeDepth();
+};
+
+#endif // TERRAINOCCLUSION_H
@@ -0,0 +1,143 @@
+#include "terrainRaycast.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    struct Node {
+        int level, x, z;
+        float tEnter;
+    };
+
+    // Slab test; returns the parametric range of the ray inside the box
+    bool intersectBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& boxMin,
+                      const glm::vec3& boxMax, float tMin, float tMax, float& tEnter, float& tExit) {
+        for (int axis = 0; axis < 3; ++axis) {
+            float t0 = (boxMin[axis] - origin[axis]) * inverseDirection[axis];
+            float t1 = (boxMax[axis] - origin[axis]) * inverseDirection[axis];
+            if (std::isnan(t0) || std::isnan(t1)) {
+                // Ray parallel to the slab and exactly on its plane
+                continue;
+            }
+            if (t0 > t1) std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+            if (tMin > tMax) {
+                return false;
+            }
+        }
+        tEnter = tMin;
+        tExit = tMax;
+        return true;
+    }
+
+    // Moller-Trumbore; accepts hits from either side
+    bool intersectTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a,
+                           const glm::vec3& b, const glm::vec3& c, float& t) {
+        glm::vec3 edge1 = b - a;
+        glm::vec3 edge2 = c - a;
+        glm::vec3 p = glm::cross(direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if (std::fabs(determinant) < 1e-12f) {
+            return false;
+        }
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 s = origin - a;
+        float u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f) {
+            return false;
+        }
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) {
+            return false;
+        }
+        t = glm::dot(edge2, q) * inverseDeterminant;
+        return true;
+    }
+}
+
+bool raycastHeightField(const HeightField& field, const HeightPyramid& pyramid, const glm::vec3& origin,
+                        const glm::vec3& direction, float maxDistance, TerrainRayHit& hit) {
+    float length = glm::length(direction);
+    if (field.isEmpty() || pyramid.getLevelCount() == 0 || length <= 0.0f) {
+        return false;
+    }
+    const glm::vec3 dir = direction / length;
+    const glm::vec3 inverseDirection = 1.0f / dir;
+    const float spacing = field.getSpacing();
+    const int cellsX = field.getWidth() - 1;
+    const int cellsZ = field.getHeight() - 1;
+    const int topLevel = pyramid.getLevelCount() - 1;
+
+    // Children are pushed far to near, so the stack never holds more than 4 per level
+    Node stack[4 * 32];
+    int stackSize = 0;
+
+    auto blockRange = [&](const Node& node, float& tEnter, float& tExit) {
+        float minHeight, maxHeight;
+        if (!pyramid.getMinMax(node.level, node.x, node.z, minHeight, maxHeight)) {
+            return false;
+        }
+        int size = 1 << node.level;
+        glm::vec3 boxMin(node.x * size * spacing, minHeight, node.z * size * spacing);
+        glm::vec3 boxMax(std::min((node.x + 1) * size, cellsX) * spacing, maxHeight,
+                         std::min((node.z + 1) * size, cellsZ) * spacing);
+        return intersectBox(origin, inverseDirection, boxMin, boxMax, 0.0f, maxDistance, tEnter, tExit);
+    };
+
+    float tEnter, tExit;
+    Node root = { topLevel, 0, 0, 0.0f };
+    if (!blockRange(root, tEnter, tExit)) {
+        return false;
+    }
+    stack[stackSize++] = root;
+
+    while (stackSize > 0) {
+        Node node = stack[--stackSize];
+
+        if (node.level == 0) {
+            // Same split as the mesh: top-left/bottom-left/top-right and top-right/bottom-left/bottom-right
+            glm::vec3 topLeft(node.x * spacing, field.getSample(node.x, node.z), node.z * spacing);
+            glm::vec3 topRight((node.x + 1) * spacing, field.getSample(node.x + 1, node.z), node.z * spacing);
+            glm::vec3 bottomLeft(node.x * spacing, field.getSample(node.x, node.z + 1), (node.z + 1) * spacing);
+            glm::vec3 bottomRight((node.x + 1) * spacing, field.getSample(node.x + 1, node.z + 1), (node.z + 1) * spacing);
+
+            float best = std::numeric_limits<float>::max();
+            glm::vec3 normal(0.0f, 1.0f, 0.0f);
+            float t;
+            if (intersectTriangle(origin, dir, topLeft, bottomLeft, topRight, t) && t >= 0.0f && t < best) {
+                best = t;
+                normal = glm::cross(bottomLeft - topLeft, topRight - topLeft);
+            }
+            if (intersectTriangle(origin, dir, topRight, bottomLeft, bottomRight, t) && t >= 0.0f && t < best) {
+                best = t;
+                normal = glm::cross(bottomLeft - topRight, bottomRight - topRight);
+            }
+            if (best <= maxDistance) {
+                hit.distance = best;
+                hit.position = origin + dir * best;
+                hit.normal = glm::normalize(normal.y < 0.0f ? -normal : normal);
+                return true;
+            }
+            continue;
+        }
+
+        Node children[4];
+        int childCount = 0;
+        for (int dz = 0; dz < 2; ++dz) {
+            for (int dx = 0; dx < 2; ++dx) {
+                Node child = { node.level - 1, node.x * 2 + dx, node.z * 2 + dz, 0.0f };
+                if (blockRange(child, tEnter, tExit)) {
+                    child.tEnter = tEnter;
+                    children[childCount++] = child;
+                }
+            }
+        }
+        std::sort(children, children + childCount, [](const Node& a, const Node& b) { return a.tEnter > b.tEnter; });
+        for (int i = 0; i < childCount; ++i) {
+            stack[stackSize++] = children[i];
+        }
+    }
+    return false;
+}
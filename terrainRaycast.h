@@ -0,0 +1,36 @@
+#ifndef TERRAINRAYCAST_H
+#define TERRAINRAYCAST_H
+
+#include <glm/glm.hpp>
+#include "heightField.h"
+#include "heightPyramid.h"
+
+/**
+ * @struct TerrainRayHit
+ * @brief Where a ray meets the terrain surface.
+ */
+struct TerrainRayHit {
+    glm::vec3 position;   ///< Hit point in terrain space.
+    glm::vec3 normal;     ///< Unit normal of the hit triangle, facing up.
+    float distance;       ///< Distance from the ray origin along the normalized direction.
+};
+
+/**
+ * @brief Intersects a ray with the full-resolution terrain triangles.
+ *
+ * The min/max pyramid is walked top down: a block is only entered if the ray passes through
+ * its bounding box, and children are visited front to back so the first cell hit is the
+ * nearest. Cells are split along the same diagonal the renderer uses.
+ *
+ * @param field Height samples.
+ * @param pyramid Min/max pyramid built from the same grid.
+ * @param origin Ray origin in terrain space.
+ * @param direction Ray direction; does not need to be normalized.
+ * @param maxDistance Hits further away than this are ignored.
+ * @param hit Receives the nearest hit.
+ * @return True if the ray hits the terrain within maxDistance.
+ */
+bool raycastHeightField(const HeightField& field, const HeightPyramid& pyramid, const glm::vec3& origin,
+                        const glm::vec3& direction, float maxDistance, TerrainRayHit& hit);
+
+#endif // TERRAINRAYCAST_H
@@ -0,0 +1,85 @@
+#include "terrainSettings.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+namespace {
+    std::string trim(const std::string& text) {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+}
+
+TerrainSettings TerrainSettings::load(const std::string& heightmapPath) {
+    TerrainSettings settings;
+    const char* overridePath = std::getenv("TERRAIN_CONFIG");
+    std::string path = overridePath ? std::string(overridePath) : settingsPathFor(heightmapPath);
+    if (settings.loadFile(path)) {
+        std::cout << "INFO: Terrain settings read from: " << path << std::endl;
+    } else if (overridePath) {
+        std::cerr << "WARNING: Failed to open terrain settings: " << path << std::endl;
+    }
+    settings.applyEnvironment();
+    return settings;
+}
+
+std::string TerrainSettings::settingsPathFor(const std::string& heightmapPath) {
+    return heightmapPath + ".cfg";
+}
+
+bool TerrainSettings::loadFile(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t equals = line.find('=');
+        if (equals == std::string::npos || !set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) {
+            std::cerr << "WARNING: Ignoring terrain settings line " << lineNumber << " in " << path
+                << ": " << line << std::endl;
+        }
+    }
+    return true;
+}
+
+void TerrainSettings::applyEnvironment() {
+    if (const char* step = std::getenv("TERRAIN_SAMPLE_STEP")) {
+        if (!set("sample_step", step)) {
+            std::cerr << "WARNING: Ignoring TERRAIN_SAMPLE_STEP=" << step << std::endl;
+        }
+    }
+    if (const char* name = std::getenv("TERRAIN_FILTER")) {
+        if (!set("filter", name)) {
+            std::cerr << "WARNING: Ignoring TERRAIN_FILTER=" << name << std::endl;
+        }
+    }
+}
+
+bool TerrainSettings::set(const std::string& key, const std::string& value) {
+    if (key == "sample_step") {
+        char* end = nullptr;
+        long step = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || step < 1 || step > 4096) {
+            return false;
+        }
+        sampleStep = static_cast<int>(step);
+        return true;
+    }
+    if (key == "filter") {
+        if (!parseHeightFilter(value, filter)) {
+            return false;
+        }
+        hasFilter = true;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,245 @@
+#include "terrainSlopeMap.h"
+#include "parallel.h"
+#include "simd.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+    // Rows per thread below which spawning is not worth it
+    const int minRowsPerThread = 16;
+
+    // Arctangent on [0, 1], minimax polynomial accurate to about 1e-5 radians
+    inline simd::float4 atanUnit(simd::float4 x) {
+        using namespace simd;
+        float4 x2 = mul(x, x);
+        float4 p = splat(-0.0117212f);
+        p = add(mul(p, x2), splat(0.05265332f));
+        p = add(mul(p, x2), splat(-0.11643287f));
+        p = add(mul(p, x2), splat(0.19354346f));
+        p = add(mul(p, x2), splat(-0.33262347f));
+        p = add(mul(p, x2), splat(0.99997726f));
+        return mul(p, x);
+    }
+
+    // Slope and aspect in degrees from four height gradients
+    void slopeAspect(const float* dx, const float* dz, float* slope, float* aspect) {
+        using namespace simd;
+        const float4 zero = splat(0.0f);
+        const float4 one = splat(1.0f);
+        const float4 halfPi = splat(0.5f * glm::pi<float>());
+        const float4 pi = splat(glm::pi<float>());
+        const float4 toDegrees = splat(180.0f / glm::pi<float>());
+
+        // Slope: atan of the gradient length, reduced to [0, 1] through atan(t) = pi/2 - atan(1/t)
+        float4 gradX = load(dx);
+        float4 gradZ = load(dz);
+        float4 steepness = sqrt(add(mul(gradX, gradX), mul(gradZ, gradZ)));
+        mask4 steep = less(one, steepness);
+        float4 reduced = atanUnit(select(steep, div(one, max(steepness, one)), steepness));
+        store(slope, mul(select(steep, sub(halfPi, reduced), reduced), toDegrees));
+
+        // Aspect: angle of the downhill vector, built up from its first-quadrant reflection
+        float4 downX = sub(zero, gradX);
+        float4 downZ = sub(zero, gradZ);
+        float4 absX = max(downX, gradX);
+        float4 absZ = max(downZ, gradZ);
+        float4 ratio = div(min(absX, absZ), max(max(absX, absZ), splat(1e-30f)));
+        float4 angle = atanUnit(ratio);
+        angle = select(less(absX, absZ), sub(halfPi, angle), angle);
+        angle = select(less(downX, zero), sub(pi, angle), angle);
+        angle = select(less(downZ, zero), sub(add(pi, pi), angle), angle);
+        float4 degrees = mul(angle, toDegrees);
+        store(aspect, select(less(degrees, splat(360.0f)), degrees, zero));
+    }
+}
+
+TerrainSlopeMap::TerrainSlopeMap()
+    : gridWidth(0), gridHeight(0), spacing(1.0f) {
+}
+
+void TerrainSlopeMap::build(const float* heights, int gridWidth, int gridHeight, float spacing) {
+    auto start = std::chrono::steady_clock::now();
+    this->gridWidth = gridWidth;
+    this->gridHeight = gridHeight;
+    this->spacing = spacing;
+    const size_t sampleCount = static_cast<size_t>(gridWidth) * gridHeight;
+    slopes.assign(sampleCount, 0.0f);
+    aspects.assign(sampleCount, 0.0f);
+    computeRegion(heights, 0, 0, gridWidth, 0, 0, gridWidth, gridHeight);
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "INFO: Computed terrain slope map " << gridWidth << " x " << gridHeight << " in "
+        << milliseconds << " ms" << std::endl;
+}
+
+// A sample's gradient reads its direct neighbours, so the samples one step outside the edit
+// change as well
+void TerrainSlopeMap::update(const HeightField& heights, int x0, int z0, int x1, int z1) {
+    if (slopes.empty()) {
+        return;
+    }
+    x0 = std::max(x0 - 1, 0);
+    z0 = std::max(z0 - 1, 0);
+    x1 = std::min(x1 + 1, gridWidth);
+    z1 = std::min(z1 + 1, gridHeight);
+    if (x0 >= x1 || z0 >= z1) {
+        return;
+    }
+
+    const int windowX0 = std::max(x0 - 1, 0);
+    const int windowZ0 = std::max(z0 - 1, 0);
+    const int windowColumns = std::min(x1 + 1, gridWidth) - windowX0;
+    const int windowRows = std::min(z1 + 1, gridHeight) - windowZ0;
+    std::vector<float> window(static_cast<size_t>(windowColumns) * windowRows);
+    heights.copyToRowMajor(windowX0, windowZ0, windowColumns, windowRows, window.data());
+    computeRegion(window.data(), windowX0, windowZ0, windowColumns, x0, z0, x1, z1);
+}
+
+void TerrainSlopeMap::clear() {
+    std::vector<float>().swap(slopes);
+    std::vector<float>().swap(aspects);
+    gridWidth = gridHeight = 0;
+}
+
+// Gradients of a row go to scratch first (vectorized away from the border columns), then
+// slope and aspect are derived four at a time, the last group padded
+void TerrainSlopeMap::computeRegion(const float* window, int windowX0, int windowZ0, int windowColumns,
+                                    int x0, int z0, int x1, int z1) {
+    auto windowRow = [&](int z) {
+        return window + static_cast<size_t>(z - windowZ0) * windowColumns;
+    };
+
+    parallelFor(z0, z1, [&](int rowBegin, int rowEnd) {
+        const int columns = x1 - x0;
+        std::vector<float> dx(columns + 3, 0.0f), dz(columns + 3, 0.0f);
+        for (int z = rowBegin; z < rowEnd; ++z) {
+            const int above = std::max(z - 1, 0);
+            const int below = std::min(z + 1, gridHeight - 1);
+            const float* row = windowRow(z);
+            const float* back = windowRow(above);
+            const float* front = windowRow(below);
+            const float inverseRunZ = below > above ? 1.0f / ((below - above) * spacing) : 0.0f;
+
+            auto gradientAt = [&](int x) {
+                const int left = std::max(x - 1, 0);
+                const int right = std::min(x + 1, gridWidth - 1);
+                // Same factor as the vector loop, so results do not depend on which path a sample takes
+                const float inverseRunX = right - left == 2 ? 0.5f / spacing : right > left ? 1.0f / spacing : 0.0f;
+                dx[x - x0] = (row[right - windowX0] - row[left - windowX0]) * inverseRunX;
+                dz[x - x0] = (front[x - windowX0] - back[x - windowX0]) * inverseRunZ;
+            };
+
+            // The vector loop needs both X neighbours inside the row
+            int x = x0;
+            for (; x < std::min(x1, 1); ++x) {
+                gradientAt(x);
+            }
+            const int vectorEnd = std::min(x1, gridWidth - 1);
+            const simd::float4 inverseRunX = simd::splat(0.5f / spacing);
+            const simd::float4 runZ = simd::splat(inverseRunZ);
+            for (; x + 4 <= vectorEnd; x += 4) {
+                const int column = x - windowX0;
+                simd::store(&dx[x - x0], simd::mul(simd::sub(simd::load(row + column + 1), simd::load(row + column - 1)), inverseRunX));
+                simd::store(&dz[x - x0], simd::mul(simd::sub(simd::load(front + column), simd::load(back + column)), runZ));
+            }
+            for (; x < x1; ++x) {
+                gradientAt(x);
+            }
+
+            float* slopeRow = &slopes[static_cast<size_t>(z) * gridWidth];
+            float* aspectRow = &aspects[static_cast<size_t>(z) * gridWidth];
+            int i = 0;
+            for (; i + 4 <= columns; i += 4) {
+                slopeAspect(&dx[i], &dz[i], slopeRow + x0 + i, aspectRow + x0 + i);
+            }
+            if (i < columns) {
+                // The padding past columns stays zero
+                float slope[4], aspect[4];
+                slopeAspect(&dx[i], &dz[i], slope, aspect);
+                std::memcpy(slopeRow + x0 + i, slope, (columns - i) * sizeof(float));
+                std::memcpy(aspectRow + x0 + i, aspect, (columns - i) * sizeof(float));
+            }
+        }
+    }, minRowsPerThread);
+}
+
+float TerrainSlopeMap::sample(float x, float z, float* aspect) const {
+    x /= spacing;
+    z /= spacing;
+    if (slopes.empty() || !(x >= 0.0f && z >= 0.0f && x <= gridWidth - 1 && z <= gridHeight - 1)) {
+        if (aspect) *aspect = 0.0f;
+        return 0.0f;
+    }
+    size_t index = static_cast<size_t>(static_cast<int>(z + 0.5f)) * gridWidth + static_cast<int>(x + 0.5f);
+    if (aspect) *aspect = aspects[index];
+    return slopes[index];
+}
+
+void TerrainSlopeMap::sample(const float* xs, const float* zs, size_t count, float* outSlopes, float* outAspects) const {
+    if (slopes.empty()) {
+        std::fill(outSlopes, outSlopes + count, 0.0f);
+        if (outAspects) std::fill(outAspects, outAspects + count, 0.0f);
+        return;
+    }
+
+    auto queryFour = [&](const float* x, const float* z, float* slope, float* aspect) {
+        using namespace simd;
+        const float4 zero = splat(0.0f);
+        const float4 half = splat(0.5f);
+        const float4 limitX = splat(static_cast<float>(gridWidth - 1));
+        const float4 limitZ = splat(static_cast<float>(gridHeight - 1));
+
+        float4 gx = div(load(x), splat(spacing));
+        float4 gz = div(load(z), splat(spacing));
+        mask4 inside = both(both(greaterEqual(gx, zero), greaterEqual(gz, zero)),
+                            both(greaterEqual(limitX, gx), greaterEqual(limitZ, gz)));
+        // Outside lanes are clamped so the gather stays in bounds and masked afterwards
+        int ix[4], iz[4];
+        storeTruncated(ix, add(min(max(gx, zero), limitX), half));
+        storeTruncated(iz, add(min(max(gz, zero), limitZ), half));
+        float s[4], a[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            size_t index = static_cast<size_t>(iz[lane]) * gridWidth + ix[lane];
+            s[lane] = slopes[index];
+            a[lane] = aspects[index];
+        }
+        store(slope, select(inside, load(s), zero));
+        if (aspect) {
+            store(aspect, select(inside, load(a), zero));
+        }
+    };
+
+    parallelFor(0, static_cast<int>((count + 3) / 4), [&](int groupBegin, int groupEnd) {
+        for (int group = groupBegin; group < groupEnd; ++group) {
+            size_t i = static_cast<size_t>(group) * 4;
+            if (i + 4 <= count) {
+                queryFour(xs + i, zs + i, outSlopes + i, outAspects ? outAspects + i : nullptr);
+                continue;
+            }
+            // Tail: pad to a full group with positions outside the grid
+            float x[4] = { -1.0f, -1.0f, -1.0f, -1.0f }, z[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+            float slope[4], aspect[4];
+            const size_t remaining = count - i;
+            std::copy(xs + i, xs + count, x);
+            std::copy(zs + i, zs + count, z);
+            queryFour(x, z, slope, aspect);
+            std::copy(slope, slope + remaining, outSlopes + i);
+            if (outAspects) std::copy(aspect, aspect + remaining, outAspects + i);
+        }
+    }, 1024);
+}
+
+bool TerrainSlopeMap::isBuilt() const {
+    return !slopes.empty();
+}
+
+int TerrainSlopeMap::getWidth() const {
+    return gridWidth;
+}
+
+int TerrainSlopeMap::getHeight() const {
+    return gridHeight;
+}
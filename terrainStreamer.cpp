@@ -0,0 +1,408 @@
+#include "terrainStreamer.h"
+#include "terrainIndices.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void checkOpenGLError(const std::string& location);
+
+namespace {
+    const int workerThreads = 2;
+    const int spareArenaSlots = 16;   ///< Slots for tiles in flight or waiting on a fence.
+}
+
+// Constructor
+TerrainStreamer::TerrainStreamer()
+    : spacing(1.0f), streamingRadius(3000.0f), maxResidentTiles(96), uploadsPerFrame(4), frameIndex(0),
+    indexBuffer(0), indexCount(0), vao(0), tileVertexCount(0), stopping(false), visibleTiles(0), drawnTriangles(0) {}
+
+// Destructor
+TerrainStreamer::~TerrainStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool TerrainStreamer::open(const std::string& tilePath, const std::string& sourcePath, float heightScale, float sampleSpacing) {
+    close();
+    if (!tileFile.open(tilePath, sourcePath, heightScale)) {
+        return false;
+    }
+    spacing = sampleSpacing;
+
+    // Every tile has the same grid, so one cache-optimized index list serves them all
+    const int tileSize = tileFile.getTileSize();
+    const int rowLength = tileSize + 1;
+    if (rowLength * rowLength > 0xFFFF) {
+        std::cerr << "ERROR: Terrain tiles of " << tileSize << " cells do not fit 16-bit indices" << std::endl;
+        return false;
+    }
+    std::vector<GLuint> triangles;
+    triangles.reserve(static_cast<size_t>(tileSize) * tileSize * 6);
+    for (int z = 0; z < tileSize; ++z) {
+        for (int x = 0; x < tileSize; ++x) {
+            GLuint topLeft = z * rowLength + x;
+            GLuint topRight = topLeft + 1;
+            GLuint bottomLeft = topLeft + rowLength;
+            GLuint bottomRight = bottomLeft + 1;
+            triangles.insert(triangles.end(), { topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight });
+        }
+    }
+    optimizeVertexCache(triangles.data(), triangles.size());
+    std::vector<GLushort> indices(triangles.begin(), triangles.end());
+    indexCount = static_cast<GLsizei>(indices.size());
+
+    tileVertexCount = rowLength * rowLength;
+    if (!arena.create(static_cast<size_t>(tileVertexCount) * 6 * sizeof(float), static_cast<int>(maxResidentTiles) + spareArenaSlots)) {
+        std::cerr << "ERROR: Failed to allocate terrain tile vertex arena" << std::endl;
+        return false;
+    }
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.getBuffer());
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    checkOpenGLError("TerrainStreamer::open after buffer setup");
+
+    stopping = false;
+    for (int i = 0; i < workerThreads; ++i) {
+        workers.emplace_back(&TerrainStreamer::workerLoop, this);
+    }
+
+    std::cout << "INFO: Streaming terrain from " << tilePath << " (" << tileFile.getTilesX() << " x "
+        << tileFile.getTilesZ() << " tiles of " << tileSize << " cells, "
+        << (arena.isPersistent() ? "persistently mapped" : "buffer updates") << ")" << std::endl;
+    return true;
+}
+
+void TerrainStreamer::close() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+        requests.clear();
+    }
+    queueCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    inFlight.clear();
+    completed.clear();
+
+    for (auto& entry : tiles) {
+        releaseTile(entry.second);
+    }
+    tiles.clear();
+    arena.destroy();
+    if (vao) {
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+    }
+    if (indexBuffer) {
+        glDeleteBuffers(1, &indexBuffer);
+        indexBuffer = 0;
+    }
+    indexCount = 0;
+    visibleTiles = 0;
+    drawnTriangles = 0;
+}
+
+void TerrainStreamer::workerLoop() {
+    for (;;) {
+        LoadedTile loaded;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping) {
+                return;
+            }
+            loaded.key = requests.front().key;
+            loaded.slot = requests.front().slot;
+            requests.pop_front();
+        }
+
+        buildTile(loaded);
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        completed.push_back(std::move(loaded));
+    }
+}
+
+void TerrainStreamer::buildTile(LoadedTile& loaded) const {
+    const int tileX = static_cast<int>(loaded.key & 0xFFFFFFFF);
+    const int tileZ = static_cast<int>(loaded.key >> 32);
+    const int tileSize = tileFile.getTileSize();
+    const int rowLength = tileSize + 1;
+    const int apronLength = tileSize + 3;
+
+    std::vector<float> apron;
+    loaded.valid = tileFile.readTile(tileX, tileZ, apron);
+    if (!loaded.valid) {
+        return;
+    }
+
+    loaded.heights.resize(static_cast<size_t>(rowLength) * rowLength);
+    // Vertices go straight into the mapped arena slot when there is one
+    float* out = nullptr;
+    if (loaded.slot >= 0) {
+        out = static_cast<float*>(arena.getSlotPointer(loaded.slot));
+        if (!out) {
+            loaded.vertexData.resize(loaded.heights.size() * 6);
+            out = loaded.vertexData.data();
+        }
+    }
+    loaded.boundsMin = glm::vec3(tileX * tileSize * spacing, std::numeric_limits<float>::max(), tileZ * tileSize * spacing);
+    loaded.boundsMax = glm::vec3((tileX + 1) * tileSize * spacing, std::numeric_limits<float>::lowest(), (tileZ + 1) * tileSize * spacing);
+
+    for (int z = 0; z < rowLength; ++z) {
+        const float* row = &apron[static_cast<size_t>(z + 1) * apronLength + 1];
+        for (int x = 0; x < rowLength; ++x) {
+            float h = row[x];
+            loaded.heights[z * rowLength + x] = h;
+            loaded.boundsMin.y = std::min(loaded.boundsMin.y, h);
+            loaded.boundsMax.y = std::max(loaded.boundsMax.y, h);
+            if (!out) {
+                continue;
+            }
+
+            // Central differences reach into the apron at the tile border
+            glm::vec3 normal = glm::normalize(glm::vec3(row[x - 1] - row[x + 1], 2.0f * spacing,
+                                                        row[x - apronLength] - row[x + apronLength]));
+            *out++ = (tileX * tileSize + x) * spacing;
+            *out++ = h;
+            *out++ = (tileZ * tileSize + z) * spacing;
+            *out++ = normal.x;
+            *out++ = normal.y;
+            *out++ = normal.z;
+        }
+    }
+}
+
+void TerrainStreamer::uploadTile(LoadedTile& loaded) {
+    if (!loaded.valid) {
+        arena.cancelSlot(loaded.slot);
+        return;
+    }
+    Tile& tile = tiles[loaded.key];
+    if (tile.heights.empty()) {
+        tile.heights.swap(loaded.heights);
+    }
+    tile.boundsMin = loaded.boundsMin;
+    tile.boundsMax = loaded.boundsMax;
+    tile.slot = loaded.slot;
+    tile.lastUsed = frameIndex;
+    if (!arena.isPersistent()) {
+        arena.writeSlot(loaded.slot, loaded.vertexData.data(), loaded.vertexData.size() * sizeof(float));
+        checkOpenGLError("TerrainStreamer::uploadTile");
+    }
+}
+
+void TerrainStreamer::releaseTile(Tile& tile) {
+    if (tile.slot >= 0) {
+        arena.releaseSlot(tile.slot);
+    }
+    tile.slot = -1;
+}
+
+void TerrainStreamer::update(const glm::vec3& localCamera) {
+    if (!tileFile.isOpen()) {
+        return;
+    }
+    ++frameIndex;
+
+    // Tiles whose footprint lies within the radius, nearest first, capped at the cache size
+    const float tileExtent = tileFile.getTileSize() * spacing;
+    const int tileX0 = std::max(0, static_cast<int>(std::floor((localCamera.x - streamingRadius) / tileExtent)));
+    const int tileZ0 = std::max(0, static_cast<int>(std::floor((localCamera.z - streamingRadius) / tileExtent)));
+    const int tileX1 = std::min(tileFile.getTilesX() - 1, static_cast<int>(std::floor((localCamera.x + streamingRadius) / tileExtent)));
+    const int tileZ1 = std::min(tileFile.getTilesZ() - 1, static_cast<int>(std::floor((localCamera.z + streamingRadius) / tileExtent)));
+    std::vector<std::pair<float, int64_t>> wanted;
+    for (int tz = tileZ0; tz <= tileZ1; ++tz) {
+        for (int tx = tileX0; tx <= tileX1; ++tx) {
+            float dx = std::max({ tx * tileExtent - localCamera.x, 0.0f, localCamera.x - (tx + 1) * tileExtent });
+            float dz = std::max({ tz * tileExtent - localCamera.z, 0.0f, localCamera.z - (tz + 1) * tileExtent });
+            float distance = std::sqrt(dx * dx + dz * dz);
+            if (distance <= streamingRadius) {
+                wanted.emplace_back(distance, makeKey(tx, tz));
+            }
+        }
+    }
+    std::sort(wanted.begin(), wanted.end());
+    if (wanted.size() > maxResidentTiles) {
+        wanted.resize(maxResidentTiles);
+    }
+
+    std::vector<int64_t> missing;
+    for (const auto& entry : wanted) {
+        auto found = tiles.find(entry.second);
+        if (found != tiles.end()) {
+            found->second.lastUsed = frameIndex;
+            if (found->second.slot >= 0) {
+                continue;
+            }
+        }
+        missing.push_back(entry.second);
+    }
+
+    std::vector<LoadedTile> finished;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        // Requests nobody has started on are replaced by the current wish list
+        for (const TileRequest& request : requests) {
+            inFlight.erase(request.key);
+            arena.cancelSlot(request.slot);
+        }
+        requests.clear();
+        for (int64_t key : missing) {
+            if (inFlight.count(key)) {
+                continue;
+            }
+            int slot = arena.acquireSlot();
+            if (slot < 0) {
+                break;  // Waiting for evicted slots to come back from the GPU
+            }
+            inFlight.insert(key);
+            requests.push_back({ key, slot });
+        }
+
+        // Mapped tiles are already in place; copies are spread over frames
+        size_t take = arena.isPersistent() ? completed.size()
+            : std::min(completed.size(), static_cast<size_t>(uploadsPerFrame));
+        for (size_t i = 0; i < take; ++i) {
+            inFlight.erase(completed[i].key);
+            finished.push_back(std::move(completed[i]));
+        }
+        completed.erase(completed.begin(), completed.begin() + take);
+    }
+    queueCondition.notify_all();
+
+    for (auto& loaded : finished) {
+        uploadTile(loaded);
+    }
+    evictTiles();
+}
+
+void TerrainStreamer::evictTiles() {
+    while (tiles.size() > maxResidentTiles) {
+        auto oldest = tiles.end();
+        for (auto it = tiles.begin(); it != tiles.end(); ++it) {
+            if (it->second.lastUsed < frameIndex && (oldest == tiles.end() || it->second.lastUsed < oldest->second.lastUsed)) {
+                oldest = it;
+            }
+        }
+        if (oldest == tiles.end()) {
+            return;  // Everything left is in use this frame
+        }
+        releaseTile(oldest->second);
+        tiles.erase(oldest);
+    }
+}
+
+void TerrainStreamer::render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
+    visibleTiles = 0;
+    drawnTriangles = 0;
+    frustum.extractPlanes(projection * view * model);
+    glBindVertexArray(vao);
+    for (const auto& entry : tiles) {
+        const Tile& tile = entry.second;
+        if (tile.slot < 0 || !frustum.intersectsAABB(tile.boundsMin, tile.boundsMax)) {
+            continue;
+        }
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0, tile.slot * tileVertexCount);
+        ++visibleTiles;
+        drawnTriangles += indexCount / 3;
+    }
+    glBindVertexArray(0);
+    arena.endFrame();
+    checkOpenGLError("TerrainStreamer::render");
+}
+
+float TerrainStreamer::sampleHeight(float x, float z, glm::vec2* gradient) {
+    if (gradient) {
+        *gradient = glm::vec2(0.0f);
+    }
+    if (!tileFile.isOpen()) {
+        return 0.0f;
+    }
+    const int tileSize = tileFile.getTileSize();
+    float gx = x / spacing;
+    float gz = z / spacing;
+    if (gx < 0 || gz < 0 || gx >= tileFile.getTilesX() * tileSize || gz >= tileFile.getTilesZ() * tileSize) {
+        return 0.0f;
+    }
+
+    int tileX = static_cast<int>(gx) / tileSize;
+    int tileZ = static_cast<int>(gz) / tileSize;
+    int64_t key = makeKey(tileX, tileZ);
+    auto found = tiles.find(key);
+    if (found == tiles.end()) {
+        // Page the heights in now; the GPU copy follows when the tile is wanted for drawing
+        LoadedTile loaded;
+        loaded.key = key;
+        loaded.slot = -1;
+        buildTile(loaded);
+        if (!loaded.valid) {
+            return 0.0f;
+        }
+        Tile& tile = tiles[key];
+        tile.heights.swap(loaded.heights);
+        tile.boundsMin = loaded.boundsMin;
+        tile.boundsMax = loaded.boundsMax;
+        tile.slot = -1;
+        tile.lastUsed = frameIndex;
+        found = tiles.find(key);
+        evictTiles();
+    }
+    found->second.lastUsed = frameIndex;
+
+    const std::vector<float>& heights = found->second.heights;
+    const int rowLength = tileSize + 1;
+    float lx = gx - tileX * tileSize;
+    float lz = gz - tileZ * tileSize;
+    int ix = std::min(static_cast<int>(lx), tileSize - 1);
+    int iz = std::min(static_cast<int>(lz), tileSize - 1);
+    float fx = lx - ix;
+    float fz = lz - iz;
+
+    float h00 = heights[iz * rowLength + ix];
+    float h01 = heights[iz * rowLength + ix + 1];
+    float h10 = heights[(iz + 1) * rowLength + ix];
+    float h11 = heights[(iz + 1) * rowLength + ix + 1];
+    if (gradient) {
+        *gradient = glm::vec2((h01 - h00) * (1.0f - fz) + (h11 - h10) * fz,
+                              (h10 - h00) * (1.0f - fx) + (h11 - h01) * fx) / spacing;
+    }
+    float h0 = h00 * (1.0f - fx) + h01 * fx;
+    float h1 = h10 * (1.0f - fx) + h11 * fx;
+    return h0 * (1.0f - fz) + h1 * fz;
+}
+
+// Setters
+void TerrainStreamer::setStreamingRadius(float radius) { streamingRadius = std::max(radius, 0.0f); }
+void TerrainStreamer::setMaxResidentTiles(size_t count) { maxResidentTiles = std::max<size_t>(count, 1); }
+void TerrainStreamer::setUploadsPerFrame(int count) { uploadsPerFrame = std::max(count, 1); }
+
+// Getters
+bool TerrainStreamer::isOpen() const { return tileFile.isOpen(); }
+const TerrainTileFile& TerrainStreamer::getTileFile() const { return tileFile; }
+size_t TerrainStreamer::getResidentTileCount() const { return tiles.size(); }
+size_t TerrainStreamer::getPendingTileCount() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return inFlight.size();
+}
+size_t TerrainStreamer::getVisibleTileCount() const { return visibleTiles; }
+size_t TerrainStreamer::getDrawnTriangleCount() const { return drawnTriangles; }
@@ -0,0 +1,103 @@
+#ifndef TERRAINTILES_H
+#define TERRAINTILES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Bump whenever the layout of the tile file changes.
+const uint32_t TERRAIN_TILES_VERSION = 1;
+
+/**
+ * @struct TerrainTileHeader
+ * @brief Fixed-size header at the start of a tile file. Offsets are from the start of the file.
+ *
+ * The height grid is cut into tilesX * tilesZ square tiles of tileSize cells. Every tile is
+ * stored as (tileSize + 3)^2 16-bit samples: its own (tileSize + 1)^2 vertices plus a
+ * one-sample apron, so normals can be computed per tile without seams. Samples map linearly
+ * onto [minHeight, maxHeight].
+ */
+struct TerrainTileHeader {
+    char magic[8];               ///< "TRNTILES".
+    uint32_t version;            ///< TERRAIN_TILES_VERSION.
+    uint32_t headerSize;         ///< sizeof(TerrainTileHeader) when written.
+    uint64_t sourceSize;         ///< Size of the source heightmap in bytes.
+    int64_t sourceModified;      ///< Modification time of the source heightmap.
+    float heightScale;           ///< Terrain height scale the samples were built with.
+    int32_t tileSize;            ///< Cells per tile side.
+    int32_t tilesX, tilesZ;      ///< Tile counts.
+    int32_t imageWidth, imageHeight;  ///< Dimensions of the source image.
+    float minHeight, maxHeight;  ///< Height range of the whole grid.
+    uint64_t boundsOffset;       ///< tilesX * tilesZ pairs of (min, max) floats.
+    uint64_t tileOffset;         ///< First tile; tiles follow in row-major order.
+};
+
+/**
+ * @class TerrainTileFile
+ * @brief Read access to a heightmap that has been pre-split into tiles on disk.
+ *
+ * Tiles are read with independent file handles, so several threads can read at once.
+ */
+class TerrainTileFile {
+public:
+    /**
+     * @brief Constructor.
+     */
+    TerrainTileFile();
+
+    /**
+     * @brief Builds the tile file name used for a heightmap.
+     * @param sourcePath Path to the heightmap image.
+     * @return Path of the tile file next to it.
+     */
+    static std::string tilePathFor(const std::string& sourcePath);
+
+    /**
+     * @brief Splits a heightmap image into a tile file. Larger DEMs can be split offline by
+     *        any tool that writes the same layout.
+     * @param sourcePath Path to the heightmap image.
+     * @param tilePath Path of the tile file to write.
+     * @param tileSize Cells per tile side; (tileSize + 1)^2 must fit 16-bit indices.
+     * @param heightScale Terrain height scale.
+     * @return True if successful, false otherwise.
+     */
+    static bool build(const std::string& sourcePath, const std::string& tilePath, int tileSize, float heightScale);
+
+    /**
+     * @brief Opens a tile file and reads its header and bounds table.
+     * @param tilePath Path to the tile file.
+     * @param sourcePath If not empty, the file must have been built from this heightmap as it is now.
+     * @param heightScale Height scale the file must have been built with.
+     * @return True if the file is usable, false otherwise.
+     */
+    bool open(const std::string& tilePath, const std::string& sourcePath, float heightScale);
+
+    /**
+     * @brief Reads one tile including its apron, converted to heights.
+     * @param tileX Tile column.
+     * @param tileZ Tile row.
+     * @param heights Receives (tileSize + 3)^2 heights in row-major order.
+     * @return True if successful, false otherwise.
+     */
+    bool readTile(int tileX, int tileZ, std::vector<float>& heights) const;
+
+    /**
+     * @brief Height range of one tile from the bounds table.
+     */
+    void getTileBounds(int tileX, int tileZ, float& minHeight, float& maxHeight) const;
+
+    // Getters
+    bool isOpen() const;
+    const TerrainTileHeader& getHeader() const;
+    int getTileSize() const;
+    int getTilesX() const;
+    int getTilesZ() const;
+
+private:
+    std::string path;                ///< Path of the open tile file.
+    TerrainTileHeader header;        ///< Header of the open file.
+    std::vector<float> tileBounds;   ///< Min and max height per tile.
+    bool opened;                     ///< True after a successful open.
+};
+
+#endif // TERRAINTILES_H
@@ -0,0 +1,159 @@
+#include "tessTerrain.h"
+#include <iostream>
+#include <algorithm>
+
+void checkOpenGLError(const std::string& location); // Defined in terrain.cpp
+
+// Constructor
+TessTerrain::TessTerrain()
+    : tessShader("/Users/sumaia/Desktop/triangle/triangle/shaders/terrainTessVert.glsl",
+                 "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainTessCtrl.glsl",
+                 "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainTessEval.glsl",
+                 "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainFrag.glsl"),
+    patchVAO(0), patchVBO(0), heightTexture(0),
+    pyramid(nullptr),
+    gridWidth(0), gridHeight(0), spacing(1.0f),
+    patchLevel(0), patchesX(0), patchesZ(0),
+    edgePixels(8.0f), maxTessLevel(static_cast<float>(patchCells)) {}
+
+bool TessTerrain::isSupported() {
+    // The shaders declare #version 410, which neither 4.0 nor ARB_tessellation_shader can compile
+    return GLEW_VERSION_4_1;
+}
+
+// Upload heights and create the patch buffer
+bool TessTerrain::initialize(const float* heights, int gridWidth, int gridHeight,
+                             float spacing, const HeightPyramid& pyramid) {
+    cleanup();
+    if (!isSupported() || !tessShader.isLoaded()) {
+        std::cerr << "ERROR: Tessellation terrain needs OpenGL 4.1: " << tessShader.getErrorLog() << std::endl;
+        return false;
+    }
+
+    this->gridWidth = gridWidth;
+    this->gridHeight = gridHeight;
+    this->spacing = spacing;
+    this->pyramid = &pyramid;
+
+    // Patch bounds come from the pyramid level whose blocks are patchCells wide
+    patchLevel = 0;
+    while ((1 << patchLevel) < patchCells) {
+        ++patchLevel;
+    }
+    if (pyramid.getLevelCount() <= patchLevel) {
+        std::cerr << "ERROR: Height grid too small for tessellation patches of " << patchCells << " cells" << std::endl;
+        return false;
+    }
+    patchesX = pyramid.getLevelWidth(patchLevel);
+    patchesZ = pyramid.getLevelHeight(patchLevel);
+
+    GLint maxLevel = 0;
+    glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+    maxTessLevel = static_cast<float>(std::min(maxLevel, patchCells));
+
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, gridWidth, gridHeight, 0, GL_RED, GL_FLOAT, heights);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenVertexArrays(1, &patchVAO);
+    glGenBuffers(1, &patchVBO);
+    glBindVertexArray(patchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glBindVertexArray(0);
+    checkOpenGLError("TessTerrain::initialize");
+
+    visiblePatches.reserve(static_cast<size_t>(patchesX) * patchesZ);
+    std::cout << "INFO: Tessellation terrain ready (" << patchesX << " x " << patchesZ << " patches of "
+        << patchCells << " cells, max level " << maxTessLevel << ")" << std::endl;
+    return true;
+}
+
+void TessTerrain::render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                         const glm::vec3& localCamera) {
+    if (!pyramid || !patchVAO) {
+        return;
+    }
+
+    // Frustum-cull patches against their min/max boxes
+    frustum.extractPlanes(projection * view * model);
+    visiblePatches.clear();
+    const float patchSize = patchCells * spacing;
+    for (int z = 0; z < patchesZ; ++z) {
+        for (int x = 0; x < patchesX; ++x) {
+            float minHeight, maxHeight;
+            if (!pyramid->getMinMax(patchLevel, x, z, minHeight, maxHeight)) {
+                continue;
+            }
+            glm::vec3 boxMin(x * patchSize, minHeight, z * patchSize);
+            glm::vec3 boxMax(boxMin.x + patchSize, maxHeight, boxMin.z + patchSize);
+            if (frustum.intersectsAABB(boxMin, boxMax)) {
+                visiblePatches.emplace_back(static_cast<float>(x), static_cast<float>(z));
+            }
+        }
+    }
+    if (visiblePatches.empty()) {
+        return;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    tessShader.setInt("heightMap", 0);
+    tessShader.setVec2("terrainSize", glm::vec2((gridWidth - 1) * spacing, (gridHeight - 1) * spacing));
+    tessShader.setVec2("heightMapSize", glm::vec2(static_cast<float>(gridWidth), static_cast<float>(gridHeight)));
+    tessShader.setFloat("patchSize", patchSize);
+    tessShader.setVec3("cameraPos", localCamera);
+    tessShader.setFloat("pixelsPerUnit", 0.5f * viewport[3] * projection[1][1]);
+    tessShader.setFloat("edgePixels", edgePixels);
+    tessShader.setFloat("maxTessLevel", maxTessLevel);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glBindVertexArray(patchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
+    glBufferData(GL_ARRAY_BUFFER, visiblePatches.size() * sizeof(glm::vec2), visiblePatches.data(), GL_STREAM_DRAW);
+
+    glPatchParameteri(GL_PATCH_VERTICES, 1);
+    glDrawArrays(GL_PATCHES, 0, static_cast<GLsizei>(visiblePatches.size()));
+    checkOpenGLError("TessTerrain::render after glDrawArrays");
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TessTerrain::updateHeights(const float* heights, int x0, int z0, int width, int height) {
+    if (!heightTexture) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x0, z0, width, height, GL_RED, GL_FLOAT, heights);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkOpenGLError("TessTerrain::updateHeights");
+}
+
+// Cleanup
+void TessTerrain::cleanup() {
+    if (patchVAO) glDeleteVertexArrays(1, &patchVAO);
+    if (patchVBO) glDeleteBuffers(1, &patchVBO);
+    if (heightTexture) glDeleteTextures(1, &heightTexture);
+    patchVAO = 0;
+    patchVBO = 0;
+    heightTexture = 0;
+    pyramid = nullptr;
+    visiblePatches.clear();
+}
+
+// Setters
+void TessTerrain::setEdgePixels(float pixels) { edgePixels = std::max(pixels, 1.0f); }
+
+// Getters
+Shader& TessTerrain::getShader() { return tessShader; }
+bool TessTerrain::isInitialized() const { return patchVAO != 0; }
+size_t TessTerrain::getVisiblePatchCount() const { return visiblePatches.size(); }
@@ -0,0 +1,341 @@
+#include "clipmapTerrain.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+void checkOpenGLError(const std::string& location); // Defined in terrain.cpp
+
+namespace {
+    // Non-negative remainder, so windows left of or above the terrain wrap the same way
+    int wrapIndex(int value, int size) {
+        int remainder = value % size;
+        return remainder < 0 ? remainder + size : remainder;
+    }
+}
+
+// Constructor
+ClipmapTerrain::ClipmapTerrain()
+    : clipmapShader("/Users/sumaia/Desktop/triangle/triangle/shaders/clipmapVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainFrag.glsl"),
+    ringVAO(0), ringVBO(0), ringEBO(0), heightTexture(0),
+    ringIndexCounts(), ringIndexOffsets(),
+    filter(HeightFilter::Box),
+    gridWidth(0), gridHeight(0), spacing(1.0f),
+    drawnTriangles(0), uploadedSamples(0) {}
+
+// Build the source levels and GPU resources; the windows are filled by the first render
+bool ClipmapTerrain::initialize(const float* heights, int gridWidth, int gridHeight, float spacing, HeightFilter filter) {
+    cleanup();
+
+    this->gridWidth = gridWidth;
+    this->gridHeight = gridHeight;
+    this->spacing = spacing;
+    this->filter = filter;
+
+    // Add levels until the coarsest window spans the terrain from any camera position on it
+    const int extent = std::max(gridWidth, gridHeight) - 1;
+    sourceLevels.push_back({ gridWidth, gridHeight, std::vector<float>(heights, heights + static_cast<size_t>(gridWidth) * gridHeight) });
+    while (static_cast<int>(sourceLevels.size()) < maxLevels &&
+           (static_cast<long long>(clipCells) << (sourceLevels.size() - 1)) < 2LL * extent &&
+           sourceLevels.back().width > 2 && sourceLevels.back().height > 2) {
+        const SourceLevel& source = sourceLevels.back();
+        SourceLevel next = { (source.width - 1) / 2 + 1, (source.height - 1) / 2 + 1, std::vector<float>() };
+        HeightMipChain::downsample(source.heights.data(), source.width, source.height, filter, next.heights);
+        sourceLevels.push_back(std::move(next));
+    }
+    const int levelCount = static_cast<int>(sourceLevels.size());
+    windows.assign(levelCount, LevelWindow{ glm::ivec2(0), false });
+
+    glGenTextures(1, &heightTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, heightTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, clipSize, clipSize, levelCount, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    checkOpenGLError("ClipmapTerrain::initialize after level texture allocation");
+
+    setupRingMesh();
+
+    std::cout << "INFO: Clipmap terrain ready (" << levelCount << " levels of " << clipCells
+        << " cells, " << static_cast<size_t>(clipSize) * clipSize * levelCount * sizeof(float) / 1024 << " KB of level texture)" << std::endl;
+    return true;
+}
+
+// One clipSize^2 grid shared by every level. The finest level draws all of it; the others
+// leave out the half-size square covered by the next finer window, which sits one of four
+// ways depending on which side of a coarse sample the camera is on.
+void ClipmapTerrain::setupRingMesh() {
+    std::vector<glm::vec2> gridPositions;
+    gridPositions.reserve(clipSize * clipSize);
+    for (int z = 0; z < clipSize; ++z) {
+        for (int x = 0; x < clipSize; ++x) {
+            gridPositions.emplace_back(static_cast<float>(x), static_cast<float>(z));
+        }
+    }
+
+    std::vector<GLushort> ringIndices;
+    const int holeCells = clipCells / 2;
+    for (int list = 0; list < 5; ++list) {
+        int holeX0 = clipCells / 4 + (list - 1) % 2;
+        int holeZ0 = clipCells / 4 + (list - 1) / 2;
+        ringIndexOffsets[list] = ringIndices.size();
+        for (int z = 0; z < clipCells; ++z) {
+            for (int x = 0; x < clipCells; ++x) {
+                if (list > 0 && x >= holeX0 && x < holeX0 + holeCells && z >= holeZ0 && z < holeZ0 + holeCells) {
+                    continue;
+                }
+                GLushort topLeft = static_cast<GLushort>(z * clipSize + x);
+                GLushort topRight = topLeft + 1;
+                GLushort bottomLeft = static_cast<GLushort>((z + 1) * clipSize + x);
+                GLushort bottomRight = bottomLeft + 1;
+
+                ringIndices.push_back(topLeft);
+                ringIndices.push_back(bottomLeft);
+                ringIndices.push_back(topRight);
+                ringIndices.push_back(topRight);
+                ringIndices.push_back(bottomLeft);
+                ringIndices.push_back(bottomRight);
+            }
+        }
+        ringIndexCounts[list] = static_cast<GLsizei>(ringIndices.size() - ringIndexOffsets[list]);
+    }
+
+    glGenVertexArrays(1, &ringVAO);
+    glGenBuffers(1, &ringVBO);
+    glGenBuffers(1, &ringEBO);
+
+    glBindVertexArray(ringVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
+    glBufferData(GL_ARRAY_BUFFER, gridPositions.size() * sizeof(glm::vec2), gridPositions.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ringEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, ringIndices.size() * sizeof(GLushort), ringIndices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    checkOpenGLError("ClipmapTerrain::setupRingMesh");
+}
+
+// Even origins keep every window corner on a sample of the next coarser level, and put the
+// finer window half a window in from the coarser one's corner, give or take one sample
+glm::ivec2 ClipmapTerrain::windowOrigin(int level, const glm::vec3& localCamera) const {
+    float pairSpacing = spacing * static_cast<float>(2 << level);
+    return glm::ivec2(static_cast<int>(std::floor(localCamera.x / pairSpacing)) * 2 - clipCells / 2,
+                      static_cast<int>(std::floor(localCamera.z / pairSpacing)) * 2 - clipCells / 2);
+}
+
+void ClipmapTerrain::moveWindow(int level, const glm::ivec2& origin) {
+    LevelWindow& window = windows[level];
+    glm::ivec2 delta = origin - window.origin;
+    if (!window.valid || std::abs(delta.x) >= clipSize || std::abs(delta.y) >= clipSize) {
+        window.origin = origin;
+        window.valid = true;
+        uploadRegion(level, origin.x, origin.y, clipSize, clipSize);
+        return;
+    }
+    if (delta.x == 0 && delta.y == 0) {
+        return;
+    }
+    window.origin = origin;
+
+    // Columns that entered the window over its full height, then the rows that entered it
+    // over the remaining columns
+    if (delta.x != 0) {
+        int x0 = delta.x > 0 ? origin.x + clipSize - delta.x : origin.x;
+        uploadRegion(level, x0, origin.y, std::abs(delta.x), clipSize);
+    }
+    if (delta.y != 0) {
+        int x0 = delta.x > 0 ? origin.x : origin.x - delta.x;
+        int z0 = delta.y > 0 ? origin.y + clipSize - delta.y : origin.y;
+        uploadRegion(level, x0, z0, clipSize - std::abs(delta.x), std::abs(delta.y));
+    }
+}
+
+void ClipmapTerrain::uploadRegion(int level, int x0, int z0, int columns, int rows) {
+    if (columns <= 0 || rows <= 0) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, heightTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // At most two pieces per axis: up to the texture edge, then from texel 0
+    const int texelX = wrapIndex(x0, clipSize);
+    const int texelZ = wrapIndex(z0, clipSize);
+    const int firstColumns = std::min(columns, clipSize - texelX);
+    const int firstRows = std::min(rows, clipSize - texelZ);
+    const int pieceX[2] = { 0, firstColumns };
+    const int pieceWidth[2] = { firstColumns, columns - firstColumns };
+    const int pieceZ[2] = { 0, firstRows };
+    const int pieceHeight[2] = { firstRows, rows - firstRows };
+    for (int pz = 0; pz < 2; ++pz) {
+        for (int px = 0; px < 2; ++px) {
+            if (pieceWidth[px] == 0 || pieceHeight[pz] == 0) {
+                continue;
+            }
+            uploadBuffer.resize(static_cast<size_t>(pieceWidth[px]) * pieceHeight[pz]);
+            for (int z = 0; z < pieceHeight[pz]; ++z) {
+                for (int x = 0; x < pieceWidth[px]; ++x) {
+                    uploadBuffer[static_cast<size_t>(z) * pieceWidth[px] + x] =
+                        getSourceHeight(level, x0 + pieceX[px] + x, z0 + pieceZ[pz] + z);
+                }
+            }
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, px == 0 ? texelX : 0, pz == 0 ? texelZ : 0, level,
+                            pieceWidth[px], pieceHeight[pz], 1, GL_RED, GL_FLOAT, uploadBuffer.data());
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    uploadedSamples += static_cast<size_t>(columns) * rows;
+}
+
+float ClipmapTerrain::getSourceHeight(int level, int x, int z) const {
+    const SourceLevel& source = sourceLevels[level];
+    x = std::min(std::max(x, 0), source.width - 1);
+    z = std::min(std::max(z, 0), source.height - 1);
+    return source.heights[static_cast<size_t>(z) * source.width + x];
+}
+
+// Follow the camera with every active level and draw them finest first
+void ClipmapTerrain::render(const glm::vec3& localCamera) {
+    if (!ringVAO) {
+        return;
+    }
+
+    // Levels much finer than the camera's height above the ground are left out (Losasso and
+    // Hoppe use 0.4 window extents); their windows stay where they were
+    const int levelCount = static_cast<int>(windows.size());
+    int cameraX = static_cast<int>(std::floor(localCamera.x / spacing + 0.5f));
+    int cameraZ = static_cast<int>(std::floor(localCamera.z / spacing + 0.5f));
+    float heightAboveGround = std::abs(localCamera.y - getSourceHeight(0, cameraX, cameraZ));
+    int finest = 0;
+    while (finest < levelCount - 1 && heightAboveGround > 0.4f * clipCells * spacing * static_cast<float>(1 << finest)) {
+        ++finest;
+    }
+
+    glm::ivec2 origins[maxLevels];
+    uploadedSamples = 0;
+    for (int level = finest; level < levelCount; ++level) {
+        origins[level] = windowOrigin(level, localCamera);
+        moveWindow(level, origins[level]);
+    }
+    checkOpenGLError("ClipmapTerrain::render after window updates");
+
+    clipmapShader.setInt("clipHeights", 0);
+    clipmapShader.setInt("clipSize", clipSize);
+    clipmapShader.setVec2("terrainSize", glm::vec2((gridWidth - 1) * spacing, (gridHeight - 1) * spacing));
+    clipmapShader.setVec3("cameraPos", localCamera);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, heightTexture);
+    glBindVertexArray(ringVAO);
+
+    drawnTriangles = 0;
+    for (int level = finest; level < levelCount; ++level) {
+        const bool hasCoarser = level + 1 < levelCount;
+        clipmapShader.setInt("level", level);
+        clipmapShader.setFloat("levelSpacing", spacing * static_cast<float>(1 << level));
+        clipmapShader.setVec2("levelOrigin", glm::vec2(origins[level]));
+        clipmapShader.setVec2("texOffset", glm::vec2(wrapIndex(origins[level].x, clipSize), wrapIndex(origins[level].y, clipSize)));
+        clipmapShader.setInt("hasCoarser", hasCoarser ? 1 : 0);
+        if (hasCoarser) {
+            const glm::ivec2& coarseOrigin = origins[level + 1];
+            clipmapShader.setVec2("coarseOffset", glm::vec2(origins[level] - coarseOrigin * 2));
+            clipmapShader.setVec2("coarseTexOffset", glm::vec2(wrapIndex(coarseOrigin.x, clipSize), wrapIndex(coarseOrigin.y, clipSize)));
+        }
+
+        // The finest level is solid; the others skip the square the finer level draws
+        int list = 0;
+        if (level > finest) {
+            glm::ivec2 hole = origins[level - 1] / 2 - origins[level] - glm::ivec2(clipCells / 4);
+            list = 1 + std::min(std::max(hole.x, 0), 1) + 2 * std::min(std::max(hole.y, 0), 1);
+        }
+        glDrawElements(GL_TRIANGLES, ringIndexCounts[list], GL_UNSIGNED_SHORT,
+                       (void*)(ringIndexOffsets[list] * sizeof(GLushort)));
+        drawnTriangles += ringIndexCounts[list] / 3;
+    }
+    checkOpenGLError("ClipmapTerrain::render after glDrawElements");
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+// Refilter each coarser level over the samples whose kernel reaches the edited ones. The
+// blocks carry a margin wider than any kernel, so the kept samples match a full rebuild.
+void ClipmapTerrain::updateHeights(const float* heights, int x0, int z0, int width, int height) {
+    if (sourceLevels.empty()) {
+        return;
+    }
+    SourceLevel& base = sourceLevels[0];
+    for (int z = 0; z < height; ++z) {
+        std::copy(heights + static_cast<size_t>(z) * width, heights + static_cast<size_t>(z + 1) * width,
+                  base.heights.begin() + static_cast<size_t>(z0 + z) * base.width + x0);
+    }
+
+    int x1 = x0 + width;
+    int z1 = z0 + height;
+    std::vector<float> block, reduced;
+    for (int level = 0; level < static_cast<int>(sourceLevels.size()); ++level) {
+        if (level > 0) {
+            const SourceLevel& fine = sourceLevels[level - 1];
+            SourceLevel& coarse = sourceLevels[level];
+            x0 = std::max((x0 - 3) / 2, 0);
+            z0 = std::max((z0 - 3) / 2, 0);
+            x1 = std::min((x1 + 3) / 2 + 1, coarse.width);
+            z1 = std::min((z1 + 3) / 2 + 1, coarse.height);
+
+            const int blockX0 = std::max(x0 * 2 - 8, 0);
+            const int blockZ0 = std::max(z0 * 2 - 8, 0);
+            const int blockColumns = std::min((x1 - 1) * 2 + 9, fine.width) - blockX0;
+            const int blockRows = std::min((z1 - 1) * 2 + 9, fine.height) - blockZ0;
+            block.resize(static_cast<size_t>(blockColumns) * blockRows);
+            for (int z = 0; z < blockRows; ++z) {
+                const float* row = &fine.heights[static_cast<size_t>(blockZ0 + z) * fine.width + blockX0];
+                std::copy(row, row + blockColumns, block.begin() + static_cast<size_t>(z) * blockColumns);
+            }
+            HeightMipChain::downsample(block.data(), blockColumns, blockRows, filter, reduced);
+            const int reducedColumns = (blockColumns - 1) / 2 + 1;
+            for (int z = z0; z < z1; ++z) {
+                for (int x = x0; x < x1; ++x) {
+                    coarse.heights[static_cast<size_t>(z) * coarse.width + x] =
+                        reduced[static_cast<size_t>(z - blockZ0 / 2) * reducedColumns + (x - blockX0 / 2)];
+                }
+            }
+        }
+
+        const LevelWindow& window = windows[level];
+        if (!window.valid) {
+            continue;
+        }
+        int uploadX0 = std::max(x0, window.origin.x);
+        int uploadZ0 = std::max(z0, window.origin.y);
+        int uploadX1 = std::min(x1, window.origin.x + clipSize);
+        int uploadZ1 = std::min(z1, window.origin.y + clipSize);
+        uploadRegion(level, uploadX0, uploadZ0, uploadX1 - uploadX0, uploadZ1 - uploadZ0);
+    }
+    checkOpenGLError("ClipmapTerrain::updateHeights");
+}
+
+// Cleanup clipmap resources
+void ClipmapTerrain::cleanup() {
+    if (ringVAO) glDeleteVertexArrays(1, &ringVAO);
+    if (ringVBO) glDeleteBuffers(1, &ringVBO);
+    if (ringEBO) glDeleteBuffers(1, &ringEBO);
+    if (heightTexture) glDeleteTextures(1, &heightTexture);
+
+    ringVAO = 0;
+    ringVBO = 0;
+    ringEBO = 0;
+    heightTexture = 0;
+    sourceLevels.clear();
+    windows.clear();
+    drawnTriangles = 0;
+}
+
+// Getters
+Shader& ClipmapTerrain::getShader() { return clipmapShader; }
+bool ClipmapTerrain::isInitialized() const { return ringVAO != 0; }
+int ClipmapTerrain::getLevelCount() const { return static_cast<int>(windows.size()); }
+size_t ClipmapTerrain::getDrawnTriangleCount() const { return drawnTriangles; }
+size_t ClipmapTerrain::getUploadedSampleCount() const { return uploadedSamples; }
@@ -0,0 +1,46 @@
+#include "frustum.h"
+
+// Constructor
+Frustum::Frustum() {
+    for (auto& plane : planes) {
+        plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+// Extract planes from the rows of the clip matrix (Gribb/Hartmann).
+// glm is column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+void Frustum::extractPlanes(const glm::mat4& m) {
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    planes[0] = row3 + row0; // Left
+    planes[1] = row3 - row0; // Right
+    planes[2] = row3 + row1; // Bottom
+    planes[3] = row3 - row1; // Top
+    planes[4] = row3 + row2; // Near
+    planes[5] = row3 - row2; // Far
+
+    for (auto& plane : planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+}
+
+// Test the box corner furthest along each plane normal; if even that one is behind, the box is outside.
+bool Frustum::intersectsAABB(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    for (const auto& plane : planes) {
+        glm::vec3 positive(
+            plane.x >= 0.0f ? boxMax.x : boxMin.x,
+            plane.y >= 0.0f ? boxMax.y : boxMin.y,
+            plane.z >= 0.0f ? boxMax.z : boxMin.z
+        );
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,224 @@
+#include "heightField.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+
+// Constructor
+HeightField::HeightField()
+    : width(0), height(0), tilesX(0), tilesZ(0), spacing(1.0f) {}
+
+void HeightField::assign(const float* rowMajor, int gridWidth, int gridHeight, float gridSpacing) {
+    width = gridWidth;
+    height = gridHeight;
+    spacing = gridSpacing;
+    tilesX = (width + tileMask) >> tileShift;
+    tilesZ = (height + tileMask) >> tileShift;
+    samples.assign(static_cast<size_t>(tilesX) * tilesZ << (2 * tileShift), 0.0f);
+
+    // Padding in the last tile row and column repeats the edge samples
+    for (int z = 0; z < tilesZ * tileSize; ++z) {
+        const float* row = rowMajor + static_cast<size_t>(std::min(z, height - 1)) * width;
+        for (int x = 0; x < tilesX * tileSize; ++x) {
+            samples[offsetOf(x, z)] = row[std::min(x, width - 1)];
+        }
+    }
+}
+
+void HeightField::clear() {
+    samples.clear();
+    samples.shrink_to_fit();
+    width = height = tilesX = tilesZ = 0;
+}
+
+void HeightField::copyToRowMajor(int x0, int z0, int columns, int rows, float* out) const {
+    for (int z = 0; z < rows; ++z) {
+        for (int x = 0; x < columns; ++x) {
+            *out++ = getSample(x0 + x, z0 + z);
+        }
+    }
+}
+
+float HeightField::getSample(int x, int z) const {
+    x = std::clamp(x, 0, width - 1);
+    z = std::clamp(z, 0, height - 1);
+    return samples[offsetOf(x, z)];
+}
+
+void HeightField::setSample(int x, int z, float value) {
+    if (x < 0 || z < 0 || x >= width || z >= height) {
+        return;
+    }
+    samples[offsetOf(x, z)] = value;
+    // Keep the padding in sync with the edge it repeats
+    if (x == width - 1 || z == height - 1) {
+        int xEnd = x == width - 1 ? tilesX * tileSize : x + 1;
+        int zEnd = z == height - 1 ? tilesZ * tileSize : z + 1;
+        for (int pz = z; pz < zEnd; ++pz) {
+            for (int px = x; px < xEnd; ++px) {
+                samples[offsetOf(px, pz)] = value;
+            }
+        }
+    }
+}
+
+bool HeightField::contains(float x, float z) const {
+    return !samples.empty() && x >= 0 && z >= 0 && x < (width - 1) * spacing && z < (height - 1) * spacing;
+}
+
+float HeightField::sampleNearest(float x, float z) const {
+    if (!contains(x, z)) {
+        return 0.0f;
+    }
+    return samples[offsetOf(static_cast<int>(x / spacing + 0.5f), static_cast<int>(z / spacing + 0.5f))];
+}
+
+float HeightField::sampleBilinear(float x, float z) const {
+    if (!contains(x, z)) {
+        return 0.0f;
+    }
+
+    x /= spacing;
+    z /= spacing;
+
+    int ix = static_cast<int>(x);
+    int iz = static_cast<int>(z);
+
+    float fx = x - ix;
+    float fz = z - iz;
+
+    float h00 = samples[offsetOf(ix, iz)];
+    float h01 = samples[offsetOf(ix + 1, iz)];
+    float h10 = samples[offsetOf(ix, iz + 1)];
+    float h11 = samples[offsetOf(ix + 1, iz + 1)];
+
+    float h0 = h00 * (1.0f - fx) + h01 * fx;
+    float h1 = h10 * (1.0f - fx) + h11 * fx;
+
+    return h0 * (1.0f - fz) + h1 * fz;
+}
+
+glm::vec2 HeightField::sampleGradient(float x, float z) const {
+    if (!contains(x, z)) {
+        return glm::vec2(0.0f);
+    }
+
+    x /= spacing;
+    z /= spacing;
+    int ix = static_cast<int>(x);
+    int iz = static_cast<int>(z);
+    float fx = x - ix;
+    float fz = z - iz;
+
+    float h00 = samples[offsetOf(ix, iz)];
+    float h01 = samples[offsetOf(ix + 1, iz)];
+    float h10 = samples[offsetOf(ix, iz + 1)];
+    float h11 = samples[offsetOf(ix + 1, iz + 1)];
+
+    float dx = (h01 - h00) * (1.0f - fz) + (h11 - h10) * fz;
+    float dz = (h10 - h00) * (1.0f - fx) + (h11 - h01) * fx;
+    return glm::vec2(dx, dz) / spacing;
+}
+
+// Four positions are interpolated at a time. SSE2 and NEON have no gather, so the corner
+// heights are fetched per lane; the rest of the bilinear and gradient math stays vectorized.
+void HeightField::sampleBilinear(const float* xs, const float* zs, size_t count, float* outHeights,
+                                 glm::vec3* outNormals, float* outSlopes) const {
+    const bool wantGradient = outNormals || outSlopes;
+    if (samples.empty() || width < 2 || height < 2) {
+        std::fill(outHeights, outHeights + count, 0.0f);
+        if (outNormals) std::fill(outNormals, outNormals + count, glm::vec3(0.0f, 1.0f, 0.0f));
+        if (outSlopes) std::fill(outSlopes, outSlopes + count, 0.0f);
+        return;
+    }
+
+    auto queryFour = [&](const float* x, const float* z, float* h, glm::vec3* n, float* slope) {
+        using namespace simd;
+        const float4 zero = splat(0.0f);
+        const float4 one = splat(1.0f);
+        const float4 limitX = splat(static_cast<float>(width - 1));
+        const float4 limitZ = splat(static_cast<float>(height - 1));
+
+        float4 gx = div(load(x), splat(spacing));
+        float4 gz = div(load(z), splat(spacing));
+        mask4 inside = both(both(greaterEqual(gx, zero), greaterEqual(gz, zero)),
+                            both(less(gx, limitX), less(gz, limitZ)));
+        // Outside lanes are clamped so the gather stays in bounds and masked afterwards
+        gx = min(max(gx, zero), limitX);
+        gz = min(max(gz, zero), limitZ);
+
+        int ix[4], iz[4];
+        storeTruncated(ix, gx);
+        storeTruncated(iz, gz);
+        float c00[4], c01[4], c10[4], c11[4];
+        for (int lane = 0; lane < 4; ++lane) {
+            int cellX = std::min(ix[lane], width - 2);
+            int cellZ = std::min(iz[lane], height - 2);
+            c00[lane] = samples[offsetOf(cellX, cellZ)];
+            c01[lane] = samples[offsetOf(cellX + 1, cellZ)];
+            c10[lane] = samples[offsetOf(cellX, cellZ + 1)];
+            c11[lane] = samples[offsetOf(cellX + 1, cellZ + 1)];
+        }
+        float4 h00 = load(c00), h01 = load(c01), h10 = load(c10), h11 = load(c11);
+        float4 fx = sub(gx, truncate(gx));
+        float4 fz = sub(gz, truncate(gz));
+        float4 gx1 = sub(one, fx);
+        float4 gz1 = sub(one, fz);
+
+        float4 h0 = add(mul(h00, gx1), mul(h01, fx));
+        float4 h1 = add(mul(h10, gx1), mul(h11, fx));
+        store(h, select(inside, add(mul(h0, gz1), mul(h1, fz)), zero));
+        if (!wantGradient) {
+            return;
+        }
+
+        // Gradient of the bilinear patch in world units
+        float4 inverseSpacing = splat(1.0f / spacing);
+        float4 dx = mul(add(mul(sub(h01, h00), gz1), mul(sub(h11, h10), fz)), inverseSpacing);
+        float4 dz = mul(add(mul(sub(h10, h00), gx1), mul(sub(h11, h01), fx)), inverseSpacing);
+        dx = select(inside, dx, zero);
+        dz = select(inside, dz, zero);
+        float4 steepnessSquared = add(mul(dx, dx), mul(dz, dz));
+        if (n) {
+            float4 inverseLength = div(one, sqrt(add(steepnessSquared, one)));
+            storeInterleaved3(&n[0].x, mul(sub(zero, dx), inverseLength), inverseLength,
+                              mul(sub(zero, dz), inverseLength));
+        }
+        if (slope) {
+            float steepness[4];
+            store(steepness, sqrt(steepnessSquared));
+            for (int lane = 0; lane < 4; ++lane) {
+                slope[lane] = glm::degrees(std::atan(steepness[lane]));
+            }
+        }
+    };
+
+    parallelFor(0, static_cast<int>((count + 3) / 4), [&](int groupBegin, int groupEnd) {
+        for (int group = groupBegin; group < groupEnd; ++group) {
+            size_t i = static_cast<size_t>(group) * 4;
+            if (i + 4 <= count) {
+                queryFour(xs + i, zs + i, outHeights + i, outNormals ? outNormals + i : nullptr,
+                          outSlopes ? outSlopes + i : nullptr);
+                continue;
+            }
+
+            // Pad the last group with positions outside the grid
+            size_t remaining = count - i;
+            float x[4] = { -1.0f, -1.0f, -1.0f, -1.0f }, z[4] = { -1.0f, -1.0f, -1.0f, -1.0f };
+            float h[4], slope[4];
+            glm::vec3 n[4];
+            std::copy(xs + i, xs + count, x);
+            std::copy(zs + i, zs + count, z);
+            queryFour(x, z, h, outNormals ? n : nullptr, outSlopes ? slope : nullptr);
+            std::copy(h, h + remaining, outHeights + i);
+            if (outNormals) std::copy(n, n + remaining, outNormals + i);
+            if (outSlopes) std::copy(slope, slope + remaining, outSlopes + i);
+        }
+    }, 1024);
+}
+
+// Getters
+bool HeightField::isEmpty() const { return samples.empty(); }
+int HeightField::getWidth() const { return width; }
+int HeightField::getHeight() const { return height; }
+float HeightField::getSpacing() const { return spacing; }
@@ -0,0 +1,124 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @class HeightField
+ * @brief Regular grid of heights with ground queries in world units.
+ *
+ * Samples are stored in 8 x 8 tiles (256 bytes, four cache lines) instead of rows, so the
+ * 2 x 2 footprint of a bilinear lookup and queries along a path mostly stay in cache. Sample
+ * (x, z) sits at world position (x * spacing, z * spacing). Queries outside the grid return
+ * a height of 0, matching the terrain's long-standing behaviour.
+ */
+class HeightField {
+public:
+    /**
+     * @brief Constructor. Creates an empty field.
+     */
+    HeightField();
+
+    /**
+     * @brief Replaces the contents with a row-major grid.
+     * @param rowMajor width * height samples, row by row.
+     * @param width Number of samples along X.
+     * @param height Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     */
+    void assign(const float* rowMajor, int width, int height, float spacing);
+
+    /**
+     * @brief Releases the samples.
+     */
+    void clear();
+
+    /**
+     * @brief Copies a rectangle of samples out in row-major order.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param columns Number of columns.
+     * @param rows Number of rows.
+     * @param out Receives columns * rows samples.
+     */
+    void copyToRowMajor(int x0, int z0, int columns, int rows, float* out) const;
+
+    /**
+     * @brief Returns the sample at a grid position, clamped to the grid.
+     */
+    float getSample(int x, int z) const;
+
+    /**
+     * @brief Overwrites the sample at a grid position. Positions outside the grid are ignored.
+     */
+    void setSample(int x, int z, float value);
+
+    /**
+     * @brief Height of the nearest sample.
+     * @param x World X-coordinate.
+     * @param z World Z-coordinate.
+     * @return Height, or 0 outside the grid.
+     */
+    float sampleNearest(float x, float z) const;
+
+    /**
+     * @brief Bilinearly interpolated height.
+     * @param x World X-coordinate.
+     * @param z World Z-coordinate.
+     * @return Height, or 0 outside the grid.
+     */
+    float sampleBilinear(float x, float z) const;
+
+    /**
+     * @brief Gradient of the bilinear surface.
+     * @param x World X-coordinate.
+     * @param z World Z-coordinate.
+     * @return (dh/dx, dh/dz), or zero outside the grid.
+     */
+    glm::vec2 sampleGradient(float x, float z) const;
+
+    /**
+     * @brief Batched sampleBilinear, vectorized and split across threads for large batches.
+     * @param xs World X-coordinates.
+     * @param zs World Z-coordinates.
+     * @param count Number of positions.
+     * @param outHeights Receives count heights.
+     * @param outNormals Optional; receives count unit surface normals (up outside the grid).
+     * @param outSlopes Optional; receives count slope angles in degrees.
+     */
+    void sampleBilinear(const float* xs, const float* zs, size_t count, float* outHeights,
+                        glm::vec3* outNormals = nullptr, float* outSlopes = nullptr) const;
+
+    /**
+     * @brief Checks whether a world position lies on the interpolated grid.
+     */
+    bool contains(float x, float z) const;
+
+    // Getters
+    bool isEmpty() const;
+    int getWidth() const;
+    int getHeight() const;
+    float getSpacing() const;
+
+private:
+    static const int tileShift = 3;               ///< log2 of the tile side.
+    static const int tileSize = 1 << tileShift;   ///< Samples per tile side.
+    static const int tileMask = tileSize - 1;
+
+    std::vector<float> samples;   ///< Tiles in row-major order, samples row-major within a tile.
+    int width, height;            ///< Grid dimensions in samples.
+    int tilesX, tilesZ;           ///< Tile counts along X and Z.
+    float spacing;                ///< World distance between samples.
+
+    /**
+     * @brief Index of sample (x, z) in the tiled storage. The position must be inside the grid.
+     */
+    size_t offsetOf(int x, int z) const {
+        return ((static_cast<size_t>(z >> tileShift) * tilesX + (x >> tileShift)) << (2 * tileShift)) +
+            ((z & tileMask) << tileShift) + (x & tileMask);
+    }
+};
+
+#endif // HEIGHTFIELD_H
@@ -0,0 +1,138 @@
+#include "heightMips.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace {
+    /// Taps of a half-resolution kernel around the source sample under the output sample.
+    struct HeightKernel {
+        int radius;
+        float weights[7];   ///< Offsets -radius..radius.
+    };
+
+    float sinc(float x) {
+        if (x == 0.0f) {
+            return 1.0f;
+        }
+        const float pi = 3.14159265358979f;
+        return std::sin(pi * x) / (pi * x);
+    }
+
+    HeightKernel makeKernel(HeightFilter filter) {
+        HeightKernel kernel = {};
+        if (filter == HeightFilter::Point) {
+            kernel.radius = 0;
+            kernel.weights[0] = 1.0f;
+        } else if (filter == HeightFilter::Box) {
+            kernel.radius = 1;
+            kernel.weights[0] = 0.25f;
+            kernel.weights[1] = 0.5f;
+            kernel.weights[2] = 0.25f;
+        } else {
+            // Lanczos-2 stretched by the factor of two, normalized so flat ground stays flat
+            kernel.radius = 3;
+            float sum = 0.0f;
+            for (int d = -3; d <= 3; ++d) {
+                float x = d * 0.5f;
+                kernel.weights[d + 3] = sinc(x) * sinc(x * 0.5f);
+                sum += kernel.weights[d + 3];
+            }
+            for (float& weight : kernel.weights) {
+                weight /= sum;
+            }
+        }
+        return kernel;
+    }
+}
+
+void HeightMipChain::build(const float* heights, int width, int height, HeightFilter filter, int levelLimit) {
+    levels.clear();
+    levels.push_back({ width, height, std::vector<float>(heights, heights + static_cast<size_t>(width) * height) });
+    while ((levelLimit <= 0 || static_cast<int>(levels.size()) < levelLimit) &&
+           levels.back().width > 2 && levels.back().height > 2) {
+        const Level& source = levels.back();
+        Level next = { (source.width - 1) / 2 + 1, (source.height - 1) / 2 + 1, std::vector<float>() };
+        downsample(source.heights.data(), source.width, source.height, filter, next.heights);
+        levels.push_back(std::move(next));
+    }
+}
+
+// Separable: each output row is first filtered vertically at full width, then along X
+void HeightMipChain::downsample(const float* heights, int width, int height, HeightFilter filter, std::vector<float>& out) {
+    const HeightKernel kernel = makeKernel(filter);
+    const int outWidth = (width - 1) / 2 + 1;
+    const int outHeight = (height - 1) / 2 + 1;
+    out.resize(static_cast<size_t>(outWidth) * outHeight);
+
+    parallelFor(0, outHeight, [&](int begin, int end) {
+        const float* taps[7];
+        std::vector<float> rowBuffer(width);
+        float* row = rowBuffer.data();
+        for (int y = begin; y < end; ++y) {
+            for (int k = -kernel.radius; k <= kernel.radius; ++k) {
+                int sourceRow = std::min(std::max(y * 2 + k, 0), height - 1);
+                taps[k + kernel.radius] = heights + static_cast<size_t>(sourceRow) * width;
+            }
+            const int tapCount = kernel.radius * 2 + 1;
+            int x = 0;
+            for (; x + 4 <= width; x += 4) {
+                simd::float4 sum = simd::mul(simd::load(taps[0] + x), simd::splat(kernel.weights[0]));
+                for (int k = 1; k < tapCount; ++k) {
+                    sum = simd::add(sum, simd::mul(simd::load(taps[k] + x), simd::splat(kernel.weights[k])));
+                }
+                simd::store(row + x, sum);
+            }
+            for (; x < width; ++x) {
+                float sum = 0.0f;
+                for (int k = 0; k < tapCount; ++k) {
+                    sum += taps[k][x] * kernel.weights[k];
+                }
+                row[x] = sum;
+            }
+
+            float* target = &out[static_cast<size_t>(y) * outWidth];
+            for (int i = 0; i < outWidth; ++i) {
+                float sum = 0.0f;
+                for (int k = -kernel.radius; k <= kernel.radius; ++k) {
+                    sum += row[std::min(std::max(i * 2 + k, 0), width - 1)] * kernel.weights[k + kernel.radius];
+                }
+                target[i] = sum;
+            }
+        }
+    }, 16);
+}
+
+void HeightMipChain::clear() {
+    levels.clear();
+}
+
+// Getters
+int HeightMipChain::getLevelCount() const { return static_cast<int>(levels.size()); }
+int HeightMipChain::getWidth(int level) const { return levels[level].width; }
+int HeightMipChain::getHeight(int level) const { return levels[level].height; }
+const float* HeightMipChain::getLevel(int level) const { return levels[level].heights.data(); }
+
+bool parseHeightFilter(const std::string& name, HeightFilter& filter) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (lower == "point") {
+        filter = HeightFilter::Point;
+    } else if (lower == "box") {
+        filter = HeightFilter::Box;
+    } else if (lower == "lanczos") {
+        filter = HeightFilter::Lanczos;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* heightFilterName(HeightFilter filter) {
+    switch (filter) {
+    case HeightFilter::Point: return "point";
+    case HeightFilter::Box: return "box";
+    default: return "lanczos";
+    }
+}
@@ -8,20 +8,39 @@
 #include "seasonEffect.h"
 #include "Skybox.h"
 #include "shader.h"
+#include <atomic>
+#include <memory>
+#include <thread>
 
 class HikingSimulator {
 public:
     HikingSimulator();
+    // Starts loading the terrain in the background and returns; render draws the sky, then a
+    // coarse preview, then the full terrain as they become ready
     bool initialize();
     void processCameraInput(GLFWwindow* window, float deltaTime);
     void render(float deltaTime);
     void cleanup();
+    bool isTerrainLoading() const;     ///< The full terrain is not displayed yet.
+    bool hasTerrainLoadFailed() const; ///< The full terrain could not be loaded.
     const glm::mat4& getViewMatrix() const;
     const glm::mat4& getProjectionMatrix() const;
     void setWindowDimensions(int windowWidth, int windowHeight);
 
 private:
+    /// Progress of one background prepare, written by the loader thread.
+    enum class PrepareState { Pending, Prepared, Failed };
+
     Terrain terrain;
+    std::unique_ptr<Terrain> previewTerrain;     ///< Coarse grid shown while terrain loads.
+    std::thread terrainLoader;                   ///< Prepares terrain, and previewTerrain from its grid.
+    std::atomic<PrepareState> previewState;
+    std::atomic<PrepareState> terrainState;
+    bool terrainMapped;                          ///< terrain's vertex buffer is mapped and terrainLoader fills it.
+    bool previewShown;                           ///< previewTerrain is finished and drawn.
+    bool terrainShown;                           ///< terrain is finished and drawn.
+    bool terrainFailed;
+    bool skyboxLoaded;
     Hiker hiker;
 //    seasonEffect seasonEffect;
     glm::mat4 viewMatrix;
@@ -31,8 +50,11 @@ private:
     int windowWidth;
     int windowHeight;
     std::unique_ptr<Shader> pathShader;
-    void setupMatrices();
+    void setupProjection();
+    void setupMatrices(const Terrain& shown);
     void renderSkybox();
+    void updateTerrainLoad();
+    Terrain* getShownTerrain();
 };
 
 #endif // HIKINGSIMULATOR_H
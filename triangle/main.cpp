@@ -36,13 +36,20 @@ int main() {
         return -1;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Ask for 4.1 so tessellation is available, then settle for 3.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     // For macOS
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Hiking Simulator", nullptr, nullptr);
+    if (!window) {
+        std::cout << "INFO: OpenGL 4.1 not available, using 3.3" << std::endl;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Hiking Simulator", nullptr, nullptr);
+    }
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -73,6 +80,10 @@ int main() {
         return -1;
     }
 
+    // The terrain loads in the background; the loop keeps drawing the sky and the preview meanwhile
+    bool loading = true;
+    glfwSetWindowTitle(window, "Hiking Simulator (loading terrain...)");
+
     // Main render loop
     while (!glfwWindowShouldClose(window)) {
         // Frame timing
@@ -90,6 +101,16 @@ int main() {
 
         // Render the scene
         simulator.render(deltaTime);
+        if (simulator.hasTerrainLoadFailed()) {
+            std::cerr << "Failed to initialize Hiking Simulator" << std::endl;
+            simulator.cleanup();
+            glfwTerminate();
+            return -1;
+        }
+        if (loading && !simulator.isTerrainLoading()) {
+            loading = false;
+            glfwSetWindowTitle(window, "Hiking Simulator");
+        }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
@@ -8,36 +8,61 @@
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
     : programID(0), loaded(false)
 {
-    // Load shader source code from files
-    std::string vertexCode, fragmentCode;
-    std::ifstream vShaderFile(vertexPath), fShaderFile(fragmentPath);
-    if (!vShaderFile.is_open() || !fShaderFile.is_open()) {
-        errorLog = "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ";
+    const char* paths[] = { vertexPath, fragmentPath };
+    const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    buildProgram(paths, types, 2);
+}
+
+Shader::Shader(const char* vertexPath, const char* tessControlPath, const char* tessEvaluationPath, const char* fragmentPath)
+    : programID(0), loaded(false)
+{
+    // Tessellation shaders here are #version 410; on older contexts the shader simply stays unloaded
+    if (!GLEW_VERSION_4_1) {
+        errorLog = "ERROR::SHADER::TESSELLATION_NOT_SUPPORTED";
         return;
     }
-    std::stringstream vShaderStream, fShaderStream;
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
-    vertexCode = vShaderStream.str();
-    fragmentCode = fShaderStream.str();
-    vShaderFile.close();
-    fShaderFile.close();
+    const char* paths[] = { vertexPath, tessControlPath, tessEvaluationPath, fragmentPath };
+    const GLenum types[] = { GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_FRAGMENT_SHADER };
+    buildProgram(paths, types, 4);
+}
+
+void Shader::buildProgram(const char* const* paths, const GLenum* types, int stageCount) {
+    // Load shader source code from files
+    std::vector<std::string> sources(stageCount);
+    for (int i = 0; i < stageCount; ++i) {
+        std::ifstream shaderFile(paths[i]);
+        if (!shaderFile.is_open()) {
+            errorLog = "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ";
+            return;
+        }
+        std::stringstream shaderStream;
+        shaderStream << shaderFile.rdbuf();
+        sources[i] = shaderStream.str();
+    }
 
     // Compile shaders
-    unsigned int vertexShader = compileShader(vertexCode, GL_VERTEX_SHADER);
-    unsigned int fragmentShader = compileShader(fragmentCode, GL_FRAGMENT_SHADER);
-    if (!vertexShader || !fragmentShader) {
-        errorLog += "ERROR::SHADER::COMPILATION_FAILED\n";
-        glDeleteProgram(programID);
-        programID = 0;
-        return;
+    std::vector<unsigned int> shaders;
+    for (int i = 0; i < stageCount; ++i) {
+        unsigned int shader = compileShader(sources[i], types[i]);
+        if (!shader) {
+            errorLog += "ERROR::SHADER::COMPILATION_FAILED\n";
+            for (unsigned int compiled : shaders) {
+                glDeleteShader(compiled);
+            }
+            return;
+        }
+        shaders.push_back(shader);
     }
 
     // Link program
     programID = glCreateProgram();
-    glAttachShader(programID, vertexShader);
-    glAttachShader(programID, fragmentShader);
+    for (unsigned int shader : shaders) {
+        glAttachShader(programID, shader);
+    }
     glLinkProgram(programID);
+    for (unsigned int shader : shaders) {
+        glDeleteShader(shader);
+    }
 
     // Check for linking errors
     int success;
@@ -46,16 +71,11 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     if (!success) {
         glGetProgramInfoLog(programID, 1024, NULL, infoLog);
         errorLog = "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" + std::string(infoLog);
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
         glDeleteProgram(programID);
         programID = 0;
         return;
     }
     loaded = true;
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
 }
 
 void Shader::use() const {
@@ -83,6 +103,20 @@ void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
     }
 }
 
+void Shader::setMat3(const std::string& name, const glm::mat3& mat) const {
+    GLint location = getUniformLocation(name);
+    if (location != -1) {
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+    }
+}
+
+void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
+    GLint location = getUniformLocation(name);
+    if (location != -1) {
+        glUniform2fv(location, 1, &value[0]);
+    }
+}
+
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
     GLint location = getUniformLocation(name);
     if (location != -1) {
@@ -90,6 +124,13 @@ void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
     }
 }
 
+void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
+    GLint location = getUniformLocation(name);
+    if (location != -1) {
+        glUniform4fv(location, 1, &value[0]);
+    }
+}
+
 void Shader::setFloat(const std::string& name, float value) const {
     GLint location = getUniformLocation(name);
     if (location != -1) {
@@ -128,7 +169,9 @@ unsigned int Shader::compileShader(const std::string& source, GLenum shaderType)
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success) {
         glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-        std::string type = shaderType == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT";
+        std::string type = shaderType == GL_VERTEX_SHADER ? "VERTEX"
+            : shaderType == GL_TESS_CONTROL_SHADER ? "TESS_CONTROL"
+            : shaderType == GL_TESS_EVALUATION_SHADER ? "TESS_EVALUATION" : "FRAGMENT";
         errorLog = "ERROR::SHADER::" + type + "::COMPILATION_FAILED\n" + std::string(infoLog);
         glDeleteShader(shader);
         return 0;
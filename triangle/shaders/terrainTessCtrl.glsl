@@ -0,0 +1,51 @@
+#version 410 core
+
+// One control point per patch; the corners are rebuilt from the patch index so neighbouring
+// patches compute bit-identical shared edges and pick identical edge factors.
+layout(vertices = 1) out;
+
+in vec2 vPatch[];
+patch out vec2 tcPatch;
+
+uniform sampler2D heightMap;
+uniform vec2 terrainSize;      // World extent of the height grid along X and Z
+uniform vec2 heightMapSize;    // Height grid dimensions in samples
+uniform float patchSize;       // World size of one patch
+uniform vec3 cameraPos;        // Camera position in terrain space
+uniform float pixelsPerUnit;   // Screen pixels per world unit at distance 1
+uniform float edgePixels;      // Target triangle edge length on screen
+uniform float maxTessLevel;
+
+float sampleHeight(vec2 worldXZ) {
+    vec2 uv = (worldXZ / terrainSize * (heightMapSize - 1.0) + 0.5) / heightMapSize;
+    return textureLod(heightMap, uv, 0.0).r;
+}
+
+vec3 corner(vec2 offset) {
+    vec2 worldXZ = clamp((vPatch[0] + offset) * patchSize, vec2(0.0), terrainSize);
+    return vec3(worldXZ.x, sampleHeight(worldXZ), worldXZ.y);
+}
+
+// Projected size of a sphere around the edge, so the factor does not depend on which patch asks
+float edgeLevel(vec3 a, vec3 b) {
+    float diameter = distance(a, b);
+    float dist = max(distance(cameraPos, 0.5 * (a + b)), 1e-3);
+    return clamp(diameter * pixelsPerUnit / dist / edgePixels, 1.0, maxTessLevel);
+}
+
+void main() {
+    tcPatch = vPatch[0];
+
+    vec3 p00 = corner(vec2(0.0, 0.0));
+    vec3 p10 = corner(vec2(1.0, 0.0));
+    vec3 p01 = corner(vec2(0.0, 1.0));
+    vec3 p11 = corner(vec2(1.0, 1.0));
+
+    // Quad domain edges: 0 is u = 0, 1 is v = 0, 2 is u = 1, 3 is v = 1
+    gl_TessLevelOuter[0] = edgeLevel(p00, p01);
+    gl_TessLevelOuter[1] = edgeLevel(p00, p10);
+    gl_TessLevelOuter[2] = edgeLevel(p10, p11);
+    gl_TessLevelOuter[3] = edgeLevel(p01, p11);
+    gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);
+    gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);
+}
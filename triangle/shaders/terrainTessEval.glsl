@@ -0,0 +1,39 @@
+#version 410 core
+
+layout(quads, fractional_even_spacing, ccw) in;
+
+patch in vec2 tcPatch;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform sampler2D heightMap;
+uniform vec2 terrainSize;      // World extent of the height grid along X and Z
+uniform vec2 heightMapSize;    // Height grid dimensions in samples
+uniform float patchSize;       // World size of one patch
+
+out vec3 fragNormal;
+out vec3 fragPosition;
+
+float sampleHeight(vec2 worldXZ) {
+    vec2 uv = (worldXZ / terrainSize * (heightMapSize - 1.0) + 0.5) / heightMapSize;
+    return textureLod(heightMap, uv, 0.0).r;
+}
+
+void main() {
+    vec2 worldXZ = clamp((tcPatch + gl_TessCoord.xy) * patchSize, vec2(0.0), terrainSize);
+    float height = sampleHeight(worldXZ);
+
+    // Normal from central differences of the height texture
+    vec2 texel = terrainSize / (heightMapSize - 1.0);
+    float hLeft = sampleHeight(worldXZ - vec2(texel.x, 0.0));
+    float hRight = sampleHeight(worldXZ + vec2(texel.x, 0.0));
+    float hBack = sampleHeight(worldXZ - vec2(0.0, texel.y));
+    float hFront = sampleHeight(worldXZ + vec2(0.0, texel.y));
+    vec3 normal = normalize(vec3((hLeft - hRight) * texel.y, 2.0 * texel.x * texel.y, (hBack - hFront) * texel.x));
+
+    fragPosition = vec3(model * vec4(worldXZ.x, height, worldXZ.y, 1.0));
+    fragNormal = mat3(transpose(inverse(model))) * normal;
+    gl_Position = projection * view * vec4(fragPosition, 1.0);
+}
@@ -0,0 +1,9 @@
+#version 410 core
+
+layout(location = 0) in vec2 aPatch;   // Patch column and row
+
+out vec2 vPatch;
+
+void main() {
+    vPatch = aPatch;
+}
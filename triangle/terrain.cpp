@@ -1,28 +1,197 @@
 #include "terrain.h"
 //#include "midpointterrain.h"
 #include "stb_image.h"
+#include "terrainCache.h"
+#include "terrainNormals.h"
+#include "terrainIndices.h"
+#include "parallel.h"
 //#include "terrainConfig.h"  //texture config
+#include "terrainSettings.h"
 #include <iostream>
 #include <GL/glew.h>
 #include <glm/vec3.hpp> // Ensure glm::vec3 is included
+#include <glm/gtc/constants.hpp>
 
 #include <cstdlib> // For rand()
 #include <ctime>   // For time()
 #include <cmath>   // For sqrt()
+#include <algorithm>
+#include <limits>
+#include <cstddef> // For offsetof
+#include <atomic>
+#include <chrono>
+#include <cstring>
 
 // Constructor
 Terrain::Terrain()
-    : terrainShader("/Users/sumaia/Desktop/triangle/triangle/shaders/terrainVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainFrag.glsl"),
-    terrainVAO(0), terrainVBO(0), terrainEBO(0),
+    : terrainVAO(0), terrainVBO(0), terrainEBO(0),
+    terrainShader("/Users/sumaia/Desktop/triangle/triangle/shaders/terrainVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainFrag.glsl"),
+    terrainPackedShader("/Users/sumaia/Desktop/triangle/triangle/shaders/terrainPackedVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainFrag.glsl"),
+    terrainHeightShader("/Users/sumaia/Desktop/triangle/triangle/shaders/terrainHeightVert.glsl", "/Users/sumaia/Desktop/triangle/triangle/shaders/terrainFrag.glsl"),
+    heightTexture(0), chunkInstanceVBO(0),
     width(0), height(0),
+    heightRevision(0),
     heightScale(200.0f), // Increased heightScale for pronounced terrain features
-    horizontalScale(5.0f) {}
+    horizontalScale(5.0f),
+    renderMode(TerrainRenderMode::Geomipmap),
+    cacheEnabled(true),
+    triangleStrips(false),
+    vertexFormat(TerrainVertexFormat::Float),
+    minHeight(0.0f), maxHeight(0.0f),
+    normalMapEnabled(true),
+    vertexNormals(true),
+    horizonMapEnabled(true),
+    sunDirection(glm::normalize(glm::vec3(0.6f, 0.5f, 0.3f))),
+    adaptiveMaxError(2.0f),
+    adaptiveEBO(0),
+    adaptiveTriangles(0),
+    adaptiveIndexCapacity(0), adaptiveIndexGarbage(0),
+    sampleStep(1),
+    previewResolution(0),
+    heightFilter(HeightFilter::Box),
+    pixelErrorThreshold(2.0f),
+    gridWidth(0), gridHeight(0),
+    chunksX(0), chunksZ(0),
+    lodIndices(nullptr),
+    lodIndicesAreStrips(false),
+    occlusionCullingEnabled(true),
+    visibleChunks(0),
+    occludedChunks(0),
+    drawnTriangles(0) {}
+
+// Defined here, where TerrainCache is complete
+Terrain::~Terrain() = default;
+
+// Wall-clock time of consecutive load stages, printed on one line when the load is done
+class Terrain::LoadStageTimer {
+public:
+    LoadStageTimer() : start(std::chrono::steady_clock::now()), last(start) {}
+
+    void lap(const char* stage) {
+        auto now = std::chrono::steady_clock::now();
+        stages.emplace_back(stage, std::chrono::duration<float, std::milli>(now - last).count());
+        last = now;
+    }
+
+    void report(const char* phase) const {
+        std::cout << "INFO: Terrain " << phase << " stages (ms):";
+        for (const auto& stage : stages) {
+            std::cout << " " << stage.first << " " << stage.second << ",";
+        }
+        std::cout << " total " << std::chrono::duration<float, std::milli>(last - start).count() << std::endl;
+    }
+
+private:
+    std::chrono::steady_clock::time_point start, last;
+    std::vector<std::pair<const char*, float>> stages;
+};
 
 // Load terrain data from heightmap
 bool Terrain::loadTerrainData(const std::string& texturePath) {
+    return prepareLoad(texturePath, nullptr) && finishTerrainData();
+}
+
+bool Terrain::prepareTerrainData(const std::string& texturePath, const std::function<void(const float*)>& onHeightGrid) {
+    return prepareLoad(texturePath, onHeightGrid);
+}
+
+// Halves the source grid until it fits the preview resolution, so the preview shares the
+// source's decode (or cache mapping) instead of reading the image again
+bool Terrain::preparePreviewData(const Terrain& source, const float* heights) {
+    pending = PendingLoad();
+    pending.texturePath = source.pending.texturePath;
+    if (renderMode == TerrainRenderMode::Streaming) {
+        std::cerr << "ERROR: A terrain preview cannot be streamed" << std::endl;
+        return false;
+    }
+    if (renderMode == TerrainRenderMode::Tessellation && !TessTerrain::isSupported()) {
+        std::cerr << "WARNING: Tessellation needs OpenGL 4.1, falling back to Geomipmap" << std::endl;
+        renderMode = TerrainRenderMode::Geomipmap;
+    }
+
+    LoadStageTimer timer;
+    width = source.width;
+    height = source.height;
+    int level = 0;
+    while (previewResolution > 0 && ((std::max(source.gridWidth, source.gridHeight) - 1) >> level) + 1 > previewResolution) {
+        ++level;
+    }
+    HeightMipChain mips;
+    mips.build(heights, source.gridWidth, source.gridHeight, heightFilter, level + 1);
+    // Long, narrow grids run out of levels before the longer side fits
+    level = std::min(level, mips.getLevelCount() - 1);
+    setSampleStep(source.sampleStep << level);
+    const float* levelHeights = mips.getLevel(level);
+    const int levelWidth = mips.getWidth(level);
+
+    // The source grid is whole chunks, but its halved levels need not be
+    gridWidth = ((levelWidth - 1) / chunkSize) * chunkSize + 1;
+    gridHeight = ((mips.getHeight(level) - 1) / chunkSize) * chunkSize + 1;
+    if (gridWidth < 2 || gridHeight < 2) {
+        std::cerr << "ERROR: Terrain too small for a " << chunkSize << " cell preview chunk (step "
+            << sampleStep << ")" << std::endl;
+        return false;
+    }
+    chunksX = (gridWidth - 1) / chunkSize;
+    chunksZ = (gridHeight - 1) / chunkSize;
+    pending.heights.resize(static_cast<size_t>(gridWidth) * gridHeight);
+    for (int z = 0; z < gridHeight; ++z) {
+        std::copy(levelHeights + static_cast<size_t>(z) * levelWidth, levelHeights + static_cast<size_t>(z) * levelWidth + gridWidth,
+                  pending.heights.begin() + static_cast<size_t>(z) * gridWidth);
+    }
+    std::cout << "INFO: Terrain preview " << gridWidth << " x " << gridHeight << " (step " << sampleStep
+        << ") taken from the loaded height grid" << std::endl;
+    timer.lap("sample");
+    return prepareHeights(timer, makeCacheKey(), false, nullptr);
+}
+
+// Everything up to the first OpenGL call. Only this object's CPU-side state is written, so it
+// can run on a worker thread while the GL thread draws something else.
+bool Terrain::prepareLoad(const std::string& texturePath, const std::function<void(const float*)>& onHeightGrid) {
+    pending = PendingLoad();
+    pending.texturePath = texturePath;
+    if (renderMode == TerrainRenderMode::Streaming) {
+        return prepareStreaming(texturePath);
+    }
+    if (renderMode == TerrainRenderMode::Tessellation && !TessTerrain::isSupported()) {
+        std::cerr << "WARNING: Tessellation needs OpenGL 4.1, falling back to Geomipmap" << std::endl;
+        renderMode = TerrainRenderMode::Geomipmap;
+    }
+
+    TerrainSettings settings = TerrainSettings::load(texturePath);
+    if (settings.sampleStep > 0 && previewResolution == 0) {
+        setSampleStep(settings.sampleStep);
+    }
+    if (settings.hasFilter) {
+        heightFilter = settings.filter;
+    }
+
+    // A processed copy of the heightmap next to the image skips decoding and mesh building
+    std::string cachePath = TerrainCache::cachePathFor(texturePath);
+    TerrainCacheKey cacheKey = makeCacheKey();
+    const bool useCache = cacheEnabled && previewResolution == 0;
+    if (useCache) {
+        std::unique_ptr<TerrainCache> cache(new TerrainCache());
+        if (cache->open(cachePath, texturePath, cacheKey)) {
+            std::cout << "INFO: Loading terrain from cache: " << cachePath << std::endl;
+            pending.cache = std::move(cache);
+            return prepareFromCache(onHeightGrid);
+        }
+    }
+
+    LoadStageTimer timer;
     int channels;
-    unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &channels, STBI_grey);
-    if (!data) {
+    // 16-bit DEMs keep their full precision; everything else is read as 8-bit grey
+    bool is16Bit = stbi_is_16_bit(texturePath.c_str()) != 0;
+    unsigned char* data = nullptr;
+    stbi_us* data16 = nullptr;
+    if (is16Bit) {
+        data16 = stbi_load_16(texturePath.c_str(), &width, &height, &channels, STBI_grey);
+    } else {
+        data = stbi_load(texturePath.c_str(), &width, &height, &channels, STBI_grey);
+    }
+    void* pixels = is16Bit ? static_cast<void*>(data16) : static_cast<void*>(data);
+    if (!pixels) {
         std::cerr << "ERROR: Failed to load heightmap from: " << texturePath << std::endl;
         return false;
     }
@@ -30,92 +199,717 @@ bool Terrain::loadTerrainData(const std::string& texturePath) {
     if (width <= 0 || height <= 0) {
         std::cerr << "ERROR: Invalid heightmap dimensions (width: " << width
             << ", height: " << height << ")" << std::endl;
-        stbi_image_free(data);
+        stbi_image_free(pixels);
         return false;
     }
 
     std::cout << "INFO: Loaded heightmap with dimensions (" << width << " x " << height << ")" << std::endl;
-    // Log a sample of height values
-    int step = 4; // Adjust step size to reduce resolution
-    int newWidth = width / step;
-    int newHeight = height / step;
-//    for (int z = 0; z < height; z += step) {
-//        for (int x = 0; x < width; x += step) {
-//            std::cout << "Height at (" << x << ", " << z << "): " << static_cast<int>(data[z * width + x]) << std::endl;
-//        }
-//    }
-    vertices.clear();
-    indices.clear();
-    heights.resize(width * height);
-
-    /// Generate vertex and heightmap data
-    for (int z = 0; z < newHeight; ++z) {
-        for (int x = 0; x < newWidth; ++x) {
-            int dataIndex = (z * step) * width + (x * step);
-            float y = (data[dataIndex] / 255.0f) * heightScale * 3.0f;  // Amplify height further
-            heights.push_back(y);
-            vertices.emplace_back(glm::vec3(x * horizontalScale * step, y, z * horizontalScale * step));
-        }
-    }
-
-    std::cout << "INFO: Number of terrain vertices: " << vertices.size() << std::endl;
-    // Update width and height
-//    width = newWidth;
-//    height = newHeight;
-    // Generate indices for rendering
-    for (int z = 0; z < newHeight - 1; ++z) {
-        for (int x = 0; x < newWidth - 1; ++x) {
-            GLuint topLeft = z * newWidth + x;
-            GLuint topRight = topLeft + 1;
-            GLuint bottomLeft = (z + 1) * newWidth + x;
-            GLuint bottomRight = bottomLeft + 1;
-
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
-        }
-    }
-
-    std::cout << "INFO: Number of terrain indices: " << indices.size() << std::endl;
-
-    stbi_image_free(data);
-
-    // Calculate normals
-    calculateNormals();
-
-    setupTerrainVAO();
+    timer.lap("decode");
+
+    if (previewResolution > 0) {
+        // Power-of-two steps go through the filtered mip chain
+        int step = 1;
+        while ((std::max(width, height) - 1) / step + 1 > previewResolution) {
+            step *= 2;
+        }
+        setSampleStep(step);
+    }
+
+    // Sample every sampleStep-th pixel, then crop to a whole number of chunks so every
+    // chunk has the same (power of two) cell count and can share the LOD index lists.
+    int sampledWidth = (width - 1) / sampleStep + 1;
+    int sampledHeight = (height - 1) / sampleStep + 1;
+    gridWidth = ((sampledWidth - 1) / chunkSize) * chunkSize + 1;
+    gridHeight = ((sampledHeight - 1) / chunkSize) * chunkSize + 1;
+    if (gridWidth < 2 || gridHeight < 2) {
+        std::cerr << "ERROR: Heightmap too small for a " << chunkSize << " cell terrain chunk (step "
+            << sampleStep << ")" << std::endl;
+        stbi_image_free(pixels);
+        return false;
+    }
+    chunksX = (gridWidth - 1) / chunkSize;
+    chunksZ = (gridHeight - 1) / chunkSize;
+
+    // Row-major copy used while building; queries go through heightField afterwards.
+    // It doubles as the vertex heights, so the mesh needs no grid of positions of its own.
+    std::vector<float>& heights = pending.heights;
+    heights.resize(static_cast<size_t>(gridWidth) * gridHeight);
+
+    /// Generate heightmap data
+    sampleHeights(data, data16, heights);
+    stbi_image_free(pixels);
+    timer.lap("sample");
+    return prepareHeights(timer, cacheKey, useCache, onHeightGrid);
+}
+
+// Everything derived from pending.heights, shared by image and preview loads
+bool Terrain::prepareHeights(LoadStageTimer& timer, TerrainCacheKey cacheKey, bool useCache,
+                             const std::function<void(const float*)>& onHeightGrid) {
+    const std::string& texturePath = pending.texturePath;
+    const std::string cachePath = TerrainCache::cachePathFor(texturePath);
+    std::vector<float>& heights = pending.heights;
+    heightPyramid.build(heights.data(), gridWidth, gridHeight);
+    heightPyramid.getMinMax(heightPyramid.getLevelCount() - 1, 0, 0, minHeight, maxHeight);
+
+    float spacing = horizontalScale * sampleStep;
+    heightField.assign(heights.data(), gridWidth, gridHeight, spacing);
+    timer.lap("pyramid");
+    if (onHeightGrid) {
+        onHeightGrid(heights.data());
+        timer.lap("preview");
+    }
+    slopeMap.build(heights.data(), gridWidth, gridHeight, spacing);
+    timer.lap("slope map");
+    if (!bakeNormalMap(heights.data(), spacing)) {
+        std::cerr << "WARNING: Failed to bake the terrain normal map, using vertex normals" << std::endl;
+        cacheKey.vertexNormals = buildsMesh() ? 1 : 0;
+    }
+    timer.lap("normal map");
+    bakeHorizonMap(heights.data(), spacing);
+    timer.lap("horizon map");
+    if (!buildsMesh()) {
+        // Geometry is generated on the GPU from a height texture; no per-vertex data is kept on the CPU
+        std::cout << "INFO: Height grid " << gridWidth << " x " << gridHeight << " (step " << sampleStep
+            << ") rendered with " << (renderMode == TerrainRenderMode::CDLOD ? "CDLOD"
+                : renderMode == TerrainRenderMode::Tessellation ? "tessellation"
+                : renderMode == TerrainRenderMode::Clipmap ? "a geometry clipmap" : "a height texture") << std::endl;
+        if (useCache) {
+            writeCache(cachePath, texturePath, cacheKey, heights, std::vector<unsigned char>());
+            timer.lap("cache");
+        }
+        timer.report("load");
+        pending.ready = true;
+        return true;
+    }
+
+    std::cout << "INFO: Number of terrain vertices: " << static_cast<size_t>(gridWidth) * gridHeight
+        << " (" << gridWidth << " x " << gridHeight << ", step " << sampleStep << ")" << std::endl;
+
+    // Chunk bounds and per-level errors
+    buildChunks(heights.data());
+    buildOccluder();
+    timer.lap("chunks");
+    if (renderMode == TerrainRenderMode::Adaptive) {
+        if (!buildAdaptiveMesh(heights.data())) {
+            return false;
+        }
+        timer.lap("adaptive");
+    }
+
+    // Calculate normals unless the normal map provides them
+    vertexNormals = !pending.normalMapBaked;
+    if (vertexNormals) {
+        calculateNormals(heights.data());
+        timer.lap("normals");
+    } else {
+        normals.clear();
+    }
+
+    // Only the cache file needs a CPU copy; otherwise the vertices are built straight into
+    // the vertex buffer, by fillVertexBuffer or finishTerrainData
+    if (useCache) {
+        pending.vertexData.resize(getVertexDataSize());
+        buildVertexData(heights.data(), pending.vertexData.data());
+        timer.lap("vertices");
+        cacheKey.vertexFormat = static_cast<int32_t>(vertexFormat);
+        writeCache(cachePath, texturePath, cacheKey, heights, pending.vertexData);
+        timer.lap("cache");
+    }
+    timer.report("load");
+    pending.ready = true;
     return true;
 }
 
-// Calculate normals for terrain vertices for realistic lighting on the terrain.
+// Where ARB_buffer_storage exists the buffer is immutable and persistently mapped, as in
+// VertexArena; dynamic storage keeps glBufferSubData available for edits
+bool Terrain::mapVertexBuffer() {
+    if (!pending.ready || pending.vertexBuffer || renderMode == TerrainRenderMode::Streaming || !buildsMesh()) {
+        return false;
+    }
+    size_t vertexBytes = pending.cache ? pending.cache->getHeader().vertexBytes : getVertexDataSize();
+    glGenBuffers(1, &pending.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, pending.vertexBuffer);
+    if (GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, vertexBytes, nullptr, flags | GL_DYNAMIC_STORAGE_BIT);
+        pending.mappedVertices = glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes, flags);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+        pending.mappedVertices = glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (!pending.mappedVertices) {
+        // finishTerrainData uploads the vertices itself
+        glDeleteBuffers(1, &pending.vertexBuffer);
+        pending.vertexBuffer = 0;
+        return false;
+    }
+    pending.vertexBytes = vertexBytes;
+    return true;
+}
+
+// The one copy of the vertices: from the cache mapping, from the copy staged for a new cache
+// file, or built in place
+void Terrain::fillVertexBuffer() {
+    if (!pending.mappedVertices) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (pending.cache) {
+        std::memcpy(pending.mappedVertices, pending.cache->getVertexData(), pending.vertexBytes);
+    } else if (!pending.vertexData.empty()) {
+        std::memcpy(pending.mappedVertices, pending.vertexData.data(), pending.vertexBytes);
+        std::vector<unsigned char>().swap(pending.vertexData);
+    } else {
+        buildVertexData(pending.heights.data(), pending.mappedVertices);
+    }
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "INFO: Terrain vertices written to the mapped buffer in " << milliseconds << " ms" << std::endl;
+}
+
+// The OpenGL half of a load: textures, buffers and the mode's renderer
+bool Terrain::finishTerrainData() {
+    if (!pending.ready) {
+        std::cerr << "ERROR: No prepared terrain to finish" << std::endl;
+        return false;
+    }
+    PendingLoad load = std::move(pending);
+    pending = PendingLoad();
+    ++heightRevision;
+    if (renderMode == TerrainRenderMode::Streaming) {
+        return loadStreaming(load.texturePath);
+    }
+
+    LoadStageTimer timer;
+    // A map that is disabled or failed to bake loses its previous texture
+    if (load.normalMapBaked) {
+        normalMap.upload();
+    } else {
+        normalMap.cleanup();
+    }
+    if (load.horizonMapBaked) {
+        horizonMap.upload();
+    } else {
+        horizonMap.cleanup();
+    }
+    timer.lap("maps");
+
+    const float* heights = load.cache ? load.cache->getHeights() : load.heights.data();
+    float spacing = horizontalScale * sampleStep;
+    if (!buildsMesh()) {
+        if (!initializeHeightTextureRenderer(heights, spacing)) {
+            return false;
+        }
+        timer.lap("height texture");
+        timer.report("upload");
+        return true;
+    }
+
+    if (load.vertexBuffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, load.vertexBuffer);
+        bool intact = glUnmapBuffer(GL_ARRAY_BUFFER) != GL_FALSE;
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (intact) {
+            setupTerrainVAO(nullptr, load.vertexBytes, load.vertexBuffer);
+            timer.lap("buffers");
+            timer.report("upload");
+            return true;
+        }
+        // Contents were lost; upload them below instead
+        glDeleteBuffers(1, &load.vertexBuffer);
+    }
+    if (load.cache) {
+        // Vertex and index data go to the GPU straight from the mapping
+        setupTerrainVAO(load.cache->getVertexData(), load.cache->getHeader().vertexBytes);
+        timer.lap("buffers");
+        timer.report("upload");
+        std::cout << "INFO: Terrain grid " << gridWidth << " x " << gridHeight << " restored from cache ("
+            << chunks.size() << " chunks)" << std::endl;
+        return true;
+    }
+    if (!load.vertexData.empty()) {
+        setupTerrainVAO(load.vertexData.data(), load.vertexData.size());
+        timer.lap("buffers");
+        timer.report("upload");
+        return true;
+    }
+
+    // Otherwise build straight into the mapped vertex buffer
+    size_t vertexBytes = getVertexDataSize();
+    setupTerrainVAO(nullptr, vertexBytes);
+    timer.lap("buffers");
+    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+    void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, vertexBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        buildVertexData(heights, mapped);
+        if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+            mapped = nullptr;  // Contents were lost; upload them instead
+        }
+    }
+    if (!mapped) {
+        std::vector<unsigned char> vertexData(vertexBytes);
+        buildVertexData(heights, vertexData.data());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, vertexData.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    timer.lap("vertices");
+    timer.report("upload");
+    return true;
+}
+
+// The tile file is built from the whole image here, only when it is missing or out of date
+bool Terrain::prepareStreaming(const std::string& texturePath) {
+    std::string tilePath = TerrainTileFile::tilePathFor(texturePath);
+    TerrainTileFile tiles;
+    if (!tiles.open(tilePath, texturePath, heightScale)) {
+        std::cout << "INFO: Building terrain tile file: " << tilePath << std::endl;
+        if (!TerrainTileFile::build(texturePath, tilePath, streamingTileSize, heightScale)) {
+            std::cerr << "ERROR: Failed to build terrain tiles for: " << texturePath << std::endl;
+            return false;
+        }
+    }
+    pending.ready = true;
+    return true;
+}
+
+// Streaming never decodes the whole image at runtime; tiles are read on demand from the tile file
+bool Terrain::loadStreaming(const std::string& texturePath) {
+    std::string tilePath = TerrainTileFile::tilePathFor(texturePath);
+    if (!streamer.open(tilePath, texturePath, heightScale, horizontalScale)) {
+        std::cout << "INFO: Building terrain tile file: " << tilePath << std::endl;
+        if (!TerrainTileFile::build(texturePath, tilePath, streamingTileSize, heightScale) ||
+            !streamer.open(tilePath, texturePath, heightScale, horizontalScale)) {
+            std::cerr << "ERROR: Failed to open terrain tiles for: " << texturePath << std::endl;
+            return false;
+        }
+    }
+
+    const TerrainTileHeader& header = streamer.getTileFile().getHeader();
+    width = header.imageWidth;
+    height = header.imageHeight;
+    gridWidth = header.tilesX * header.tileSize + 1;
+    gridHeight = header.tilesZ * header.tileSize + 1;
+    minHeight = header.minHeight;
+    maxHeight = header.maxHeight;
+    normalMap.cleanup();
+    horizonMap.cleanup();
+    heightField.clear();
+    slopeMap.clear();
+    heightPyramid.clear();
+    normals.clear();
+    chunks.clear();
+    occlusion.clear();
+    return true;
+}
+
+HeightFilter Terrain::getEffectiveHeightFilter() const {
+    bool powerOfTwo = (sampleStep & (sampleStep - 1)) == 0;
+    return sampleStep > 1 && powerOfTwo ? heightFilter : HeightFilter::Point;
+}
+
+void Terrain::sampleHeights(const unsigned char* data, const unsigned short* data16, std::vector<float>& heights) const {
+    const float scale = heightScale * 3.0f / (data16 ? 65535.0f : 255.0f);  // Amplify height further
+    HeightFilter filter = getEffectiveHeightFilter();
+    if (filter == HeightFilter::Point) {
+        if (heightFilter != HeightFilter::Point && sampleStep > 1) {
+            std::cerr << "WARNING: Sample step " << sampleStep << " is not a power of two, point-sampling the heightmap" << std::endl;
+        }
+        parallelFor(0, gridHeight, [&](int begin, int end) {
+            for (int z = begin; z < end; ++z) {
+                for (int x = 0; x < gridWidth; ++x) {
+                    size_t dataIndex = static_cast<size_t>(z * sampleStep) * width + x * sampleStep;
+                    heights[z * gridWidth + x] = (data16 ? data16[dataIndex] : data[dataIndex]) * scale;
+                }
+            }
+        }, 64);
+        return;
+    }
+
+    // Each level halves the resolution, so the step is reached after log2(step) levels
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> fullHeights(static_cast<size_t>(width) * height);
+    parallelFor(0, height, [&](int begin, int end) {
+        for (size_t i = static_cast<size_t>(begin) * width; i < static_cast<size_t>(end) * width; ++i) {
+            fullHeights[i] = (data16 ? data16[i] : data[i]) * scale;
+        }
+    }, 64);
+    int level = 0;
+    while ((1 << level) < sampleStep) {
+        ++level;
+    }
+    HeightMipChain mips;
+    mips.build(fullHeights.data(), width, height, filter, level + 1);
+    const float* levelHeights = mips.getLevel(level);
+    int levelWidth = mips.getWidth(level);
+    // The level may have a few more samples than the grid, which is cropped to whole chunks
+    for (int z = 0; z < gridHeight; ++z) {
+        std::copy(levelHeights + static_cast<size_t>(z) * levelWidth, levelHeights + static_cast<size_t>(z) * levelWidth + gridWidth,
+                  heights.begin() + static_cast<size_t>(z) * gridWidth);
+    }
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "INFO: Heightmap reduced to step " << sampleStep << " with the " << heightFilterName(filter)
+        << " filter in " << milliseconds << " ms" << std::endl;
+}
+
+bool Terrain::buildsMesh() const {
+    return renderMode != TerrainRenderMode::CDLOD && renderMode != TerrainRenderMode::Tessellation &&
+        renderMode != TerrainRenderMode::HeightTexture && renderMode != TerrainRenderMode::Clipmap;
+}
+
+bool Terrain::initializeHeightTextureRenderer(const float* heights, float spacing) {
+    if (renderMode == TerrainRenderMode::Tessellation) {
+        return tessTerrain.initialize(heights, gridWidth, gridHeight, spacing, heightPyramid);
+    }
+    if (renderMode == TerrainRenderMode::HeightTexture) {
+        return setupHeightTexture(heights);
+    }
+    if (renderMode == TerrainRenderMode::Clipmap) {
+        return clipmapTerrain.initialize(heights, gridWidth, gridHeight, spacing, heightFilter);
+    }
+    return cdlodTerrain.initialize(heights, gridWidth, gridHeight, spacing, heightPyramid);
+}
+
+TerrainCacheKey Terrain::makeCacheKey() const {
+    TerrainCacheKey key;
+    key.sampleStep = sampleStep;
+    key.chunkSize = chunkSize;
+    key.vertexFormat = static_cast<int32_t>(vertexFormat);
+    key.includesMesh = buildsMesh() ? 1 : 0;
+    key.vertexNormals = buildsMesh() && !normalMapEnabled ? 1 : 0;
+    key.heightFilter = static_cast<int32_t>(getEffectiveHeightFilter());
+    key.heightScale = heightScale;
+    key.horizontalScale = horizontalScale;
+    return key;
+}
+
+// Restore the grid from the mapped cache in pending.cache. Heights are copied because queries
+// need them; the vertex data goes to the GPU straight from the mapping in finishTerrainData.
+bool Terrain::prepareFromCache(const std::function<void(const float*)>& onHeightGrid) {
+    const TerrainCache& cache = *pending.cache;
+    const TerrainCacheHeader& header = cache.getHeader();
+    width = header.imageWidth;
+    height = header.imageHeight;
+    gridWidth = header.gridWidth;
+    gridHeight = header.gridHeight;
+    chunksX = header.chunksX;
+    chunksZ = header.chunksZ;
+    minHeight = header.minHeight;
+    maxHeight = header.maxHeight;
+
+    float spacing = horizontalScale * sampleStep;
+    const float* cachedHeights = cache.getHeights();
+    heightField.assign(cachedHeights, gridWidth, gridHeight, spacing);
+    heightPyramid.build(cachedHeights, gridWidth, gridHeight);
+    if (onHeightGrid) {
+        onHeightGrid(cachedHeights);
+    }
+    slopeMap.build(cachedHeights, gridWidth, gridHeight, spacing);
+    normals.clear();
+
+    bool baked = bakeNormalMap(cachedHeights, spacing);
+    bakeHorizonMap(cachedHeights, spacing);
+    if (!buildsMesh()) {
+        if (!baked) {
+            std::cerr << "WARNING: Failed to bake the terrain normal map, using vertex normals" << std::endl;
+        }
+        pending.ready = true;
+        return true;
+    }
+    vertexNormals = header.key.vertexNormals != 0;
+    if (!vertexNormals && !baked) {
+        std::cerr << "ERROR: Cached terrain vertices need the normal map, which failed to build" << std::endl;
+        return false;
+    }
+
+    chunks.assign(cache.getChunks(), cache.getChunks() + static_cast<size_t>(chunksX) * chunksZ);
+    buildOccluder();
+    drawCounts.reserve(chunks.size());
+    drawOffsets.reserve(chunks.size());
+    drawBaseVertices.reserve(chunks.size());
+    if (renderMode == TerrainRenderMode::Adaptive && !buildAdaptiveMesh(cachedHeights)) {
+        return false;
+    }
+    pending.ready = true;
+    return true;
+}
+
+void Terrain::writeCache(const std::string& cachePath, const std::string& sourcePath,
+                         const TerrainCacheKey& key, const std::vector<float>& heights,
+                         const std::vector<unsigned char>& vertexData) const {
+    TerrainCacheContents contents;
+    contents.imageWidth = width;
+    contents.imageHeight = height;
+    contents.gridWidth = gridWidth;
+    contents.gridHeight = gridHeight;
+    contents.chunksX = chunksX;
+    contents.chunksZ = chunksZ;
+    contents.minHeight = minHeight;
+    contents.maxHeight = maxHeight;
+    contents.heights = heights.data();
+    contents.vertexData = vertexData.data();
+    contents.vertexBytes = vertexData.size();
+    contents.chunks = chunks.data();
+
+    if (TerrainCache::write(cachePath, sourcePath, key, contents)) {
+        std::cout << "INFO: Terrain cache written: " << cachePath << std::endl;
+    }
+}
+
+bool Terrain::bakeNormalMap(const float* heights, float spacing) {
+    if (!normalMapEnabled) {
+        return true;
+    }
+    pending.normalMapBaked = normalMap.bake(heights, gridWidth, gridHeight, spacing);
+    return pending.normalMapBaked;
+}
+
+void Terrain::bakeHorizonMap(const float* heights, float spacing) {
+    if (!horizonMapEnabled) {
+        return;
+    }
+    pending.horizonMapBaked = horizonMap.bake(heights, gridWidth, gridHeight, spacing);
+    if (!pending.horizonMapBaked) {
+        std::cerr << "WARNING: Failed to bake the terrain horizon map, rendering without terrain shadows" << std::endl;
+    }
+}
+
+// Compute bounds for every chunk and, for each coarser level, the largest vertical distance
+// between a full-resolution vertex and the surface that level would draw over it.
+void Terrain::buildChunks(const float* heights) {
+    const float spacing = horizontalScale * sampleStep;
+    chunks.clear();
+    chunks.reserve(chunksX * chunksZ);
+
+    for (int cz = 0; cz < chunksZ; ++cz) {
+        for (int cx = 0; cx < chunksX; ++cx) {
+            int x0 = cx * chunkSize;
+            int z0 = cz * chunkSize;
+
+            TerrainChunk chunk;
+            chunk.baseVertex = static_cast<GLint>(chunks.size()) * chunkVertexCount;
+            chunk.boundsMin = glm::vec3(x0 * spacing, std::numeric_limits<float>::max(), z0 * spacing);
+            chunk.boundsMax = glm::vec3((x0 + chunkSize) * spacing, std::numeric_limits<float>::lowest(), (z0 + chunkSize) * spacing);
+            chunk.lodLevel = 0;
+            measureChunk(chunk, heights + static_cast<size_t>(z0) * gridWidth + x0, gridWidth);
+            chunks.push_back(chunk);
+        }
+    }
+
+    drawCounts.reserve(chunks.size());
+    drawOffsets.reserve(chunks.size());
+    drawBaseVertices.reserve(chunks.size());
+
+    std::cout << "INFO: Terrain split into " << chunks.size() << " chunks ("
+        << chunksX << " x " << chunksZ << ")" << std::endl;
+}
+
+void Terrain::measureChunk(TerrainChunk& chunk, const float* heights, size_t rowStride) {
+    chunk.boundsMin.y = std::numeric_limits<float>::max();
+    chunk.boundsMax.y = std::numeric_limits<float>::lowest();
+    for (int z = 0; z <= chunkSize; ++z) {
+        for (int x = 0; x <= chunkSize; ++x) {
+            float h = heights[z * rowStride + x];
+            chunk.boundsMin.y = std::min(chunk.boundsMin.y, h);
+            chunk.boundsMax.y = std::max(chunk.boundsMax.y, h);
+        }
+    }
+
+    chunk.lodError[0] = 0.0f;
+    for (int level = 1; level < terrainLodLevels; ++level) {
+        int s = 1 << level;
+        int cells = chunkSize / s;
+        float maxError = 0.0f;
+        for (int z = 0; z <= chunkSize; ++z) {
+            for (int x = 0; x <= chunkSize; ++x) {
+                int cellX = std::min(x / s, cells - 1);
+                int cellZ = std::min(z / s, cells - 1);
+                float u = static_cast<float>(x - cellX * s) / s;
+                float v = static_cast<float>(z - cellZ * s) / s;
+
+                const float* row0 = &heights[cellZ * s * rowStride + cellX * s];
+                const float* row1 = row0 + s * rowStride;
+                float hTL = row0[0], hTR = row0[s], hBL = row1[0], hBR = row1[s];
+
+                // Cells are split along the top-right / bottom-left diagonal
+                float coarse = (u + v <= 1.0f)
+                    ? hTL + u * (hTR - hTL) + v * (hBL - hTL)
+                    : hBR + (1.0f - u) * (hBL - hBR) + (1.0f - v) * (hTR - hBR);
+                float actual = heights[z * rowStride + x];
+                maxError = std::max(maxError, std::fabs(actual - coarse));
+            }
+        }
+        // Keep errors monotonic so a coarser level never looks cheaper than a finer one
+        chunk.lodError[level] = std::max(maxError, chunk.lodError[level - 1]);
+    }
+}
 
-void Terrain::calculateNormals() {
-    normals.resize(vertices.size(), glm::vec3(0.0f));
+// Every chunk has the same cell count and stores its own vertices, so one index list per
+// (level, edge mask) serves every chunk of every map. Indices are relative to the chunk's first
+// vertex and drawn with its base vertex.
+const TerrainLodIndexSet& Terrain::getLodIndexSet(bool strips) {
+    static_assert(chunkVertexCount < 0xFFFF, "chunk vertices must be addressable with 16-bit indices");
+    static TerrainLodIndexSet sets[2];
+    static bool built[2] = { false, false };
 
-    for (size_t i = 0; i < indices.size(); i += 3) {
-        GLuint idx0 = indices[i];
-        GLuint idx1 = indices[i + 1];
-        GLuint idx2 = indices[i + 2];
+    TerrainLodIndexSet& set = sets[strips ? 1 : 0];
+    if (built[strips ? 1 : 0]) {
+        return set;
+    }
 
-        glm::vec3& v0 = vertices[idx0];
-        glm::vec3& v1 = vertices[idx1];
-        glm::vec3& v2 = vertices[idx2];
+    VertexCacheStats rowOrder, optimized;
+    std::vector<GLuint> triangles;
+    std::vector<GLuint> ordered;
+    for (int level = 0; level < terrainLodLevels; ++level) {
+        for (int edgeMask = 0; edgeMask < 16; ++edgeMask) {
+            triangles.clear();
+            appendLodIndices(level, edgeMask, triangles);
+            measureVertexCache(triangles.data(), triangles.size(), false, rowOrder);
+            GLsizei triangleCount = static_cast<GLsizei>(triangles.size() / 3);
 
-        glm::vec3 edge1 = v1 - v0;
-        glm::vec3 edge2 = v2 - v0;
-        glm::vec3 faceNormal = glm::normalize(glm::cross(edge1, edge2));
+            ordered.clear();
+            if (strips) {
+                buildTriangleStrips(triangles.data(), triangles.size(), ordered);
+            } else {
+                optimizeVertexCache(triangles.data(), triangles.size());
+                ordered.swap(triangles);
+            }
+            measureVertexCache(ordered.data(), ordered.size(), strips, optimized);
 
-        normals[idx0] += faceNormal;
-        normals[idx1] += faceNormal;
-        normals[idx2] += faceNormal;
+            // The 32-bit restart index narrows to the 16-bit one
+            TerrainIndexRange& range = set.ranges[level][edgeMask];
+            range.indexOffset = set.indices.size();
+            range.indexCount = static_cast<GLsizei>(ordered.size());
+            range.triangleCount = triangleCount;
+            for (GLuint index : ordered) {
+                set.indices.push_back(static_cast<GLushort>(index));
+            }
+        }
     }
+    built[strips ? 1 : 0] = true;
+
+    std::cout << "INFO: Number of shared terrain indices: " << set.indices.size() << " (16-bit)" << std::endl;
+    std::cout << "INFO: Terrain index ACMR " << rowOrder.acmr() << " in row order, " << optimized.acmr()
+        << (strips ? " as strips" : " cache-optimized") << " (" << terrainVertexCacheSize
+        << "-entry FIFO)" << std::endl;
+    return set;
+}
+
+void Terrain::appendLodIndices(int level, int edgeMask, std::vector<GLuint>& triangles) {
+    const int s = 1 << level;
+    const int cells = chunkSize / s;
+
+    // Level coordinates (i, j) in [0, cells] map to grid vertices (i * s, j * s) of the chunk
+    auto vertexIndex = [&](int i, int j) {
+        return static_cast<GLuint>(j * s * (chunkSize + 1) + i * s);
+    };
+    // Emit with the same winding as the regular grid (normal pointing up)
+    auto addTriangle = [&](glm::ivec2 a, glm::ivec2 b, glm::ivec2 c) {
+        int turn = (b.y - a.y) * (c.x - a.x) - (b.x - a.x) * (c.y - a.y);
+        if (turn < 0) {
+            std::swap(b, c);
+        }
+        triangles.push_back(vertexIndex(a.x, a.y));
+        triangles.push_back(vertexIndex(b.x, b.y));
+        triangles.push_back(vertexIndex(c.x, c.y));
+    };
 
-    for (auto& normal : normals) {
-        normal = glm::normalize(normal);
+    // Interior cells are regular quads
+    for (int j = 1; j < cells - 1; ++j) {
+        for (int i = 1; i < cells - 1; ++i) {
+            glm::ivec2 topLeft(i, j), topRight(i + 1, j), bottomLeft(i, j + 1), bottomRight(i + 1, j + 1);
+            addTriangle(topLeft, bottomLeft, topRight);
+            addTriangle(topRight, bottomLeft, bottomRight);
+        }
     }
+
+    // The border ring is four trapezoids, each zipping the outer edge (every other vertex when
+    // the neighbour is coarser) to the row of vertices one cell inside it.
+    const int edges[4] = { EDGE_TOP, EDGE_RIGHT, EDGE_BOTTOM, EDGE_LEFT };
+    for (int edge : edges) {
+        bool stitched = (edgeMask & edge) != 0;
+        auto outerVertex = [&](int t) {
+            switch (edge) {
+            case EDGE_TOP: return glm::ivec2(t, 0);
+            case EDGE_BOTTOM: return glm::ivec2(t, cells);
+            case EDGE_LEFT: return glm::ivec2(0, t);
+            default: return glm::ivec2(cells, t);
+            }
+        };
+        auto innerVertex = [&](int t) {
+            switch (edge) {
+            case EDGE_TOP: return glm::ivec2(t, 1);
+            case EDGE_BOTTOM: return glm::ivec2(t, cells - 1);
+            case EDGE_LEFT: return glm::ivec2(1, t);
+            default: return glm::ivec2(cells - 1, t);
+            }
+        };
+
+        int outerStep = stitched ? 2 : 1;
+        int outer = 0;   // Position along the outer edge, 0..cells
+        int inner = 1;   // Position along the inner row, 1..cells-1
+        while (outer < cells || inner < cells - 1) {
+            bool advanceOuter;
+            if (inner >= cells - 1) {
+                advanceOuter = true;
+            } else if (outer >= cells) {
+                advanceOuter = false;
+            } else {
+                // Advance whichever side's next segment is centred further back
+                advanceOuter = 2 * outer + outerStep <= 2 * inner + 1;
+            }
+
+            if (advanceOuter) {
+                addTriangle(outerVertex(outer), outerVertex(outer + outerStep), innerVertex(inner));
+                outer += outerStep;
+            } else {
+                addTriangle(outerVertex(outer), innerVertex(inner + 1), innerVertex(inner));
+                ++inner;
+            }
+        }
+    }
+}
+
+// Choose the coarsest level whose projected error stays under the threshold, then refine chunks
+// until no two neighbours differ by more than one level so the stitched lists always match.
+void Terrain::selectLodLevels(const glm::vec3& cameraPosition, float pixelsPerUnit) {
+    for (auto& chunk : chunks) {
+        glm::vec3 closest = glm::clamp(cameraPosition, chunk.boundsMin, chunk.boundsMax);
+        float distance = std::max(glm::length(cameraPosition - closest), 1e-3f);
+
+        chunk.lodLevel = 0;
+        for (int level = terrainLodLevels - 1; level > 0; --level) {
+            if (chunk.lodError[level] * pixelsPerUnit / distance <= pixelErrorThreshold) {
+                chunk.lodLevel = level;
+                break;
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int cz = 0; cz < chunksZ; ++cz) {
+            for (int cx = 0; cx < chunksX; ++cx) {
+                TerrainChunk& chunk = chunks[cz * chunksX + cx];
+                int limit = chunk.lodLevel;
+                if (cx > 0) limit = std::min(limit, chunks[cz * chunksX + cx - 1].lodLevel + 1);
+                if (cx < chunksX - 1) limit = std::min(limit, chunks[cz * chunksX + cx + 1].lodLevel + 1);
+                if (cz > 0) limit = std::min(limit, chunks[(cz - 1) * chunksX + cx].lodLevel + 1);
+                if (cz < chunksZ - 1) limit = std::min(limit, chunks[(cz + 1) * chunksX + cx].lodLevel + 1);
+                if (limit < chunk.lodLevel) {
+                    chunk.lodLevel = limit;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+// Calculate normals for terrain vertices for realistic lighting on the terrain.
+// Central differences on the height grid; see computeGridNormals.
+void Terrain::calculateNormals(const float* heights) {
+    normals.resize(static_cast<size_t>(gridWidth) * gridHeight);
+    computeGridNormals(heights, gridWidth, gridHeight, horizontalScale * sampleStep, normals.data());
 }
 void checkOpenGLError(const std::string& location) {
     GLenum err;
@@ -123,107 +917,843 @@ void checkOpenGLError(const std::string& location) {
         std::cerr << "OpenGL error at " << location << ": " << err << std::endl;
     }
 }
-// Setup VAO, VBO, EBO
-void Terrain::setupTerrainVAO() {
-    std::vector<float> vertexData;
-    for (size_t i = 0; i < vertices.size(); ++i) {
-        vertexData.push_back(vertices[i].x);
-        vertexData.push_back(vertices[i].y);
-        vertexData.push_back(vertices[i].z);
+namespace {
+    // Octahedral encoding around +Y: the upper hemisphere fills the inner diamond,
+    // the lower one is folded over the corners.
+    void encodeOctahedral(const glm::vec3& n, GLbyte out[2]) {
+        float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+        glm::vec2 p(n.x / l1, n.z / l1);
+        if (n.y < 0.0f) {
+            glm::vec2 folded((1.0f - std::fabs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                             (1.0f - std::fabs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+            p = folded;
+        }
+        out[0] = static_cast<GLbyte>(std::round(glm::clamp(p.x, -1.0f, 1.0f) * 127.0f));
+        out[1] = static_cast<GLbyte>(std::round(glm::clamp(p.y, -1.0f, 1.0f) * 127.0f));
+    }
+}
 
-        vertexData.push_back(normals[i].x);
-        vertexData.push_back(normals[i].y);
-        vertexData.push_back(normals[i].z);
+// Interleave vertex data in the layout selected by vertexFormat
+size_t Terrain::getVertexDataSize() {
+    // Grid indices have to fit in 16 bits for the packed layout
+    if (vertexFormat == TerrainVertexFormat::Packed && (gridWidth > 65536 || gridHeight > 65536)) {
+        std::cerr << "WARNING: Terrain grid too large for packed vertices, using float vertices" << std::endl;
+        vertexFormat = TerrainVertexFormat::Float;
     }
+    return chunks.size() * chunkVertexCount * getVertexSize();
+}
 
+size_t Terrain::getVertexSize() const {
+    return vertexFormat == TerrainVertexFormat::Packed ? sizeof(PackedTerrainVertex)
+        : (vertexNormals ? 6 : 3) * sizeof(float);
+}
+
+template <typename HeightAt, typename NormalAt>
+void Terrain::writeVertexRows(int chunk, int firstRow, int rowCount, const HeightAt& heightAt,
+                              const NormalAt& normalAt, void* out) const {
+    const float spacing = horizontalScale * sampleStep;
+    const int x0 = (chunk % chunksX) * chunkSize;
+    const int z0 = (chunk / chunksX) * chunkSize + firstRow;
+
+    if (vertexFormat == TerrainVertexFormat::Packed) {
+        PackedTerrainVertex* packed = static_cast<PackedTerrainVertex*>(out);
+        float heightRange = std::max(maxHeight - minHeight, 1e-6f);
+        for (int z = z0; z < z0 + rowCount; ++z) {
+            for (int x = x0; x <= x0 + chunkSize; ++x, ++packed) {
+                packed->gridX = static_cast<GLushort>(x);
+                packed->gridZ = static_cast<GLushort>(z);
+                float normalizedHeight = (heightAt(x, z) - minHeight) / heightRange;
+                packed->height = static_cast<GLushort>(std::round(glm::clamp(normalizedHeight, 0.0f, 1.0f) * 65535.0f));
+                if (vertexNormals) {
+                    encodeOctahedral(normalAt(x, z), packed->normal);
+                } else {
+                    packed->normal[0] = packed->normal[1] = 0;
+                }
+            }
+        }
+    } else {
+        float* floats = static_cast<float*>(out);
+        for (int z = z0; z < z0 + rowCount; ++z) {
+            for (int x = x0; x <= x0 + chunkSize; ++x) {
+                *floats++ = x * spacing;
+                *floats++ = heightAt(x, z);
+                *floats++ = z * spacing;
+
+                if (vertexNormals) {
+                    glm::vec3 normal = normalAt(x, z);
+                    *floats++ = normal.x;
+                    *floats++ = normal.y;
+                    *floats++ = normal.z;
+                }
+            }
+        }
+    }
+}
+
+void Terrain::buildVertexData(const float* heights, void* vertexData) const {
+    // Chunks are stored one after another, each with its own (chunkSize + 1)^2 vertices, so
+    // the shared 16-bit index lists can address them through the chunk's base vertex. Every
+    // chunk owns a disjoint slice of the output, so they are written in parallel.
+    const size_t chunkBytes = chunkVertexCount * getVertexSize();
+    auto heightAt = [&](int x, int z) { return heights[static_cast<size_t>(z) * gridWidth + x]; };
+    auto normalAt = [&](int x, int z) { return normals[static_cast<size_t>(z) * gridWidth + x]; };
+    parallelFor(0, static_cast<int>(chunks.size()), [&](int begin, int end) {
+        for (int chunk = begin; chunk < end; ++chunk) {
+            writeVertexRows(chunk, 0, chunkSize + 1, heightAt, normalAt,
+                            static_cast<unsigned char*>(vertexData) + chunk * chunkBytes);
+        }
+    });
+}
+
+// Setup VAO, VBO, EBO
+void Terrain::setupTerrainVAO(const void* vertexData, size_t vertexBytes, GLuint vertexBuffer) {
+    // Reloading replaces the vertices; the index buffer is kept unless the list layout changed
+    if (terrainVAO) glDeleteVertexArrays(1, &terrainVAO);
+    if (terrainVBO) glDeleteBuffers(1, &terrainVBO);
     glGenVertexArrays(1, &terrainVAO);
-    glGenBuffers(1, &terrainVBO);
-    glGenBuffers(1, &terrainEBO);
+    terrainVBO = vertexBuffer;
 
     glBindVertexArray(terrainVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
-    
+    if (!terrainVBO) {
+        glGenBuffers(1, &terrainVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+        checkOpenGLError("After glBufferData for VBO");
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+    }
+
+    if (renderMode == TerrainRenderMode::Adaptive) {
+        bindAdaptiveIndexBuffer();
+    } else {
+        bindLodIndexBuffer();
+    }
+
+    if (vertexFormat == TerrainVertexFormat::Packed) {
+        // Grid indices and normal bytes are converted as plain integers and scaled in the shader;
+        // the height is an unsigned normalized value.
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedTerrainVertex), (void*)offsetof(PackedTerrainVertex, gridX));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedTerrainVertex), (void*)offsetof(PackedTerrainVertex, height));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_BYTE, GL_FALSE, sizeof(PackedTerrainVertex), (void*)offsetof(PackedTerrainVertex, normal));
+    } else if (vertexNormals) {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    } else {
+        // Positions only; the fragment shader reads normals from the normal map
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    }
+    checkOpenGLError("After setting up vertex attributes");
+    glBindVertexArray(0);
+
+    std::cout << "INFO: Terrain VAO, VBO, and EBO setup complete (" << vertexBytes / (1024 * 1024)
+        << " MB of vertices)." << std::endl;
+}
+
+void Terrain::bindLodIndexBuffer() {
+    if (!terrainEBO || !lodIndices || lodIndicesAreStrips != triangleStrips) {
+        lodIndices = &getLodIndexSet(triangleStrips);
+        lodIndicesAreStrips = triangleStrips;
+        if (!terrainEBO) {
+            glGenBuffers(1, &terrainEBO);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, lodIndices->indices.size() * sizeof(GLushort), lodIndices->indices.data(), GL_STATIC_DRAW);
+        checkOpenGLError("After glBufferData for EBO");
+    } else {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainEBO);
+    }
+}
+
+// Chunks are RTIN tiles, so the triangles index the same per-chunk vertices as the LOD lists
+bool Terrain::buildAdaptiveMesh(const float* heights) {
+    auto start = std::chrono::steady_clock::now();
+    if (!rtin.build(heights, chunksX, chunksZ, chunkSize)) {
+        return false;
+    }
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    size_t gridTriangles = chunks.size() * chunkSize * chunkSize * 2;
+    std::cout << "INFO: Adaptive mesh errors computed in " << milliseconds << " ms; triangles by maximum error:" << std::endl;
+    for (float scale : { 0.25f, 0.5f, 1.0f, 2.0f, 4.0f }) {
+        float error = adaptiveMaxError * scale;
+        size_t triangles = rtin.countTriangles(error);
+        std::cout << "INFO:   " << error << ": " << triangles << " ("
+            << 100.0 * triangles / gridTriangles << "% of " << gridTriangles << ")" << std::endl;
+    }
+    return true;
+}
+
+void Terrain::bindAdaptiveIndexBuffer() {
+    adaptiveTriangles = rtin.extract(adaptiveMaxError, adaptiveIndices, adaptiveRanges);
+    if (!adaptiveEBO) {
+        glGenBuffers(1, &adaptiveEBO);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, adaptiveEBO);
+    uploadAdaptiveIndices();
+    checkOpenGLError("After glBufferData for the adaptive EBO");
+    std::cout << "INFO: Adaptive mesh with " << adaptiveTriangles << " triangles at maximum error "
+        << adaptiveMaxError << std::endl;
+}
+
+// A quarter more room than the triangles need lets edits append the chunks they change
+// without reallocating. The copy target leaves the VAO's element buffer binding alone.
+void Terrain::uploadAdaptiveIndices() {
+    adaptiveIndexCapacity = adaptiveIndices.size() + adaptiveIndices.size() / 4 + chunkVertexCount * 6;
+    adaptiveIndexGarbage = 0;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, adaptiveEBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, adaptiveIndexCapacity * sizeof(GLushort), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, adaptiveIndices.size() * sizeof(GLushort), adaptiveIndices.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// Replaced ranges are left in place as garbage until they outweigh the live indices or the
+// new ones do not fit; the live ranges are then packed back together in chunk order.
+void Terrain::updateAdaptiveTiles(const std::vector<int>& tiles) {
+    const size_t firstAppended = adaptiveIndices.size();
+    std::vector<GLushort> tileIndices;
+    for (int tile : tiles) {
+        rtin.extractTile(tile, adaptiveMaxError, tileIndices);
+        TerrainRtinRange& range = adaptiveRanges[tile];
+        adaptiveIndexGarbage += range.indexCount;
+        adaptiveTriangles = adaptiveTriangles - range.indexCount / 3 + tileIndices.size() / 3;
+        range.indexOffset = adaptiveIndices.size();
+        range.indexCount = static_cast<GLsizei>(tileIndices.size());
+        adaptiveIndices.insert(adaptiveIndices.end(), tileIndices.begin(), tileIndices.end());
+    }
 
-    checkOpenGLError("After glBufferData for VBO");
+    if (adaptiveIndices.size() > adaptiveIndexCapacity || adaptiveIndexGarbage > adaptiveIndices.size() / 2) {
+        std::vector<GLushort> packed;
+        packed.reserve(adaptiveIndices.size() - adaptiveIndexGarbage);
+        for (TerrainRtinRange& range : adaptiveRanges) {
+            size_t offset = packed.size();
+            packed.insert(packed.end(), adaptiveIndices.begin() + range.indexOffset,
+                          adaptiveIndices.begin() + range.indexOffset + range.indexCount);
+            range.indexOffset = offset;
+        }
+        adaptiveIndices.swap(packed);
+        uploadAdaptiveIndices();
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, adaptiveEBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, firstAppended * sizeof(GLushort),
+                        (adaptiveIndices.size() - firstAppended) * sizeof(GLushort), &adaptiveIndices[firstAppended]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    checkOpenGLError("Terrain::updateAdaptiveTiles");
+}
+
+// One flat (chunkSize + 1)^2 grid is drawn once per visible chunk and displaced in the vertex
+// shader, so the GPU holds a texel per sample instead of a vertex per sample.
+bool Terrain::setupHeightTexture(const float* heights) {
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    if (gridWidth > maxTextureSize || gridHeight > maxTextureSize) {
+        std::cerr << "ERROR: Height grid " << gridWidth << " x " << gridHeight
+            << " exceeds the maximum texture size " << maxTextureSize << std::endl;
+        return false;
+    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainEBO);
-//    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-    checkOpenGLError("After glBufferData for EBO");
+    buildChunks(heights);
+    buildOccluder();
+
+    if (!heightTexture) {
+        glGenTextures(1, &heightTexture);
+    }
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    if (vertexFormat == TerrainVertexFormat::Packed) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, gridWidth, gridHeight, 0, GL_RED, GL_UNSIGNED_SHORT, nullptr);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, gridWidth, gridHeight, 0, GL_RED, GL_FLOAT, nullptr);
+    }
+    uploadHeightTexture(heights, gridWidth, 0, 0, gridWidth, gridHeight);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkOpenGLError("Terrain::setupHeightTexture after texture upload");
+
+    std::vector<glm::vec2> grid;
+    grid.reserve(chunkVertexCount);
+    for (int z = 0; z <= chunkSize; ++z) {
+        for (int x = 0; x <= chunkSize; ++x) {
+            grid.emplace_back(static_cast<float>(x), static_cast<float>(z));
+        }
+    }
+
+    if (terrainVAO) glDeleteVertexArrays(1, &terrainVAO);
+    if (terrainVBO) glDeleteBuffers(1, &terrainVBO);
+    glGenVertexArrays(1, &terrainVAO);
+    glGenBuffers(1, &terrainVBO);
+    if (!chunkInstanceVBO) {
+        glGenBuffers(1, &chunkInstanceVBO);
+    }
 
+    glBindVertexArray(terrainVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+    glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(glm::vec2), grid.data(), GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    bindLodIndexBuffer();
 
+    // Chunk origins advance once per instance
+    glBindBuffer(GL_ARRAY_BUFFER, chunkInstanceVBO);
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    checkOpenGLError("After setting up vertex attributes");
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    glVertexAttribDivisor(1, 1);
     glBindVertexArray(0);
+    checkOpenGLError("Terrain::setupHeightTexture after grid setup");
+
+    size_t textureBytes = static_cast<size_t>(gridWidth) * gridHeight * (vertexFormat == TerrainVertexFormat::Packed ? 2 : 4);
+    std::cout << "INFO: Height texture " << gridWidth << " x " << gridHeight << " ("
+        << textureBytes / (1024 * 1024) << " MB) with a shared " << chunkSize << " cell chunk grid" << std::endl;
+    return true;
+}
+
+void Terrain::uploadHeightTexture(const float* heights, size_t rowStride, int x0, int z0, int columns, int rows) {
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    if (vertexFormat == TerrainVertexFormat::Packed) {
+        // 16-bit unorm over the terrain's height range, like the packed vertices
+        std::vector<GLushort> quantized(static_cast<size_t>(columns) * rows);
+        float heightRange = std::max(maxHeight - minHeight, 1e-6f);
+        for (int z = 0; z < rows; ++z) {
+            for (int x = 0; x < columns; ++x) {
+                float normalizedHeight = (heights[z * rowStride + x] - minHeight) / heightRange;
+                quantized[static_cast<size_t>(z) * columns + x] = static_cast<GLushort>(std::round(glm::clamp(normalizedHeight, 0.0f, 1.0f) * 65535.0f));
+            }
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x0, z0, columns, rows, GL_RED, GL_UNSIGNED_SHORT, quantized.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    } else {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(rowStride));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x0, z0, columns, rows, GL_RED, GL_FLOAT, heights);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    std::cout << "INFO: Terrain VAO, VBO, and EBO setup complete." << std::endl;
+// Geomipmap and HeightTexture triangles span at most one step of the coarsest LOD level, and
+// Adaptive triangles stay inside their chunk
+void Terrain::buildOccluder() {
+    int cells = renderMode == TerrainRenderMode::Adaptive ? chunkSize : 1 << (terrainLodLevels - 1);
+    int level = 0;
+    while ((2 << level) <= cells) {
+        ++level;
+    }
+    occlusion.build(heightPyramid, gridWidth, gridHeight, horizontalScale * sampleStep, level);
 }
 
 // Render terrain
 void Terrain::render(const glm::mat4& model, const glm::mat4& view,
     const glm::mat4& projection, const glm::vec3& cameraPosition) {
-    if (!terrainShader.isLoaded()) {
+    Shader& shader = getShader();
+    if (!shader.isLoaded()) {
         std::cerr << "ERROR: Failed to compile and link terrain shader!" << std::endl;
-        std::cerr << terrainShader.getErrorLog() << std::endl;
+        std::cerr << shader.getErrorLog() << std::endl;
         return;  // Stop rendering if shader is not loaded
     }
 
 
-    terrainShader.use();
+    shader.use();
 
-    terrainShader.setMat4("model", model);
-    terrainShader.setMat4("view", view);
-    terrainShader.setMat4("projection", projection);
+    shader.setMat4("model", model);
+    shader.setMat4("view", view);
+    shader.setMat4("projection", projection);
     
-    terrainShader.setVec3("viewPos", cameraPosition);
-    terrainShader.setVec3("lightPos", glm::vec3(0.0f, 100.0f, 0.0f));
+    shader.setVec3("viewPos", cameraPosition);
+    shader.setVec3("lightPos", glm::vec3(0.0f, 100.0f, 0.0f));
+
+    // Every mode but Streaming shares terrainFrag.glsl; texture unit 0 is left to height textures
+    shader.setInt("useNormalMap", normalMap.isBuilt() ? 1 : 0);
+    shader.setInt("useHorizonMap", horizonMap.isBuilt() ? 1 : 0);
+    // Samplers of different types may not share a unit, even when unused
+    shader.setInt("normalMap", 1);
+    shader.setInt("horizonMap", 2);
+    if (normalMap.isBuilt() || horizonMap.isBuilt()) {
+        float spacing = horizontalScale * sampleStep;
+        shader.setMat4("worldToTerrain", glm::inverse(model));
+        shader.setVec4("terrainMapTransform", glm::vec4(1.0f / (spacing * gridWidth), 1.0f / (spacing * gridHeight),
+                                                        0.5f / gridWidth, 0.5f / gridHeight));
+    }
+    if (normalMap.isBuilt()) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, normalMap.getTexture());
+        shader.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+    }
+    if (horizonMap.isBuilt()) {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, horizonMap.getTexture());
+        // The stored azimuths and elevations are in terrain space
+        glm::vec3 localSun = glm::normalize(glm::mat3(glm::inverse(model)) * sunDirection);
+        float azimuth = std::atan2(localSun.z, localSun.x);
+        if (azimuth < 0.0f) {
+            azimuth += 2.0f * glm::pi<float>();
+        }
+        float steps = std::fmod(azimuth / (2.0f * glm::pi<float>()) * horizonDirectionCount, static_cast<float>(horizonDirectionCount));
+        shader.setVec3("sunDirection", glm::normalize(sunDirection));
+        shader.setVec2("sunHorizon", glm::vec2(steps, localSun.y));
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    if (renderMode == TerrainRenderMode::CDLOD) {
+        cdlodTerrain.render(model, view, projection, localCamera);
+        return;
+    }
+    if (renderMode == TerrainRenderMode::Tessellation) {
+        tessTerrain.render(model, view, projection, localCamera);
+        return;
+    }
+    if (renderMode == TerrainRenderMode::Clipmap) {
+        clipmapTerrain.render(localCamera);
+        return;
+    }
+    if (renderMode == TerrainRenderMode::Streaming) {
+        streamer.update(localCamera);
+        streamer.render(model, view, projection);
+        return;
+    }
+
+    const bool instanced = renderMode == TerrainRenderMode::HeightTexture;
+    if (vertexFormat == TerrainVertexFormat::Packed || instanced) {
+        shader.setFloat("gridSpacing", horizontalScale * sampleStep);
+    }
+    if (vertexFormat == TerrainVertexFormat::Packed) {
+        shader.setFloat("minHeight", minHeight);
+        shader.setFloat("heightRange", maxHeight - minHeight);
+    } else if (instanced) {
+        shader.setFloat("minHeight", 0.0f);
+        shader.setFloat("heightRange", 1.0f);
+    }
+
+    // Pick LOD levels from the camera position in terrain space and the current viewport;
+    // the Adaptive triangles are fixed
+    const bool adaptive = renderMode == TerrainRenderMode::Adaptive;
+    if (!adaptive) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        float pixelsPerUnit = 0.5f * viewport[3] * projection[1][1];
+        selectLodLevels(localCamera, pixelsPerUnit);
+    }
+
+    // Cull chunks against the frustum in model space and draw the survivors in one call
+    frustum.extractPlanes(projection * view * model);
+    drawCounts.clear();
+    drawOffsets.clear();
+    drawBaseVertices.clear();
+    for (auto& group : chunkInstances) {
+        group.clear();
+    }
+    visibleChunks = 0;
+    occludedChunks = 0;
+    drawnTriangles = 0;
+
+    // The occluder lies under the drawn surface, so it only hides what the terrain hides as
+    // long as the camera is above the ground
+    const bool occlusionCulling = occlusionCullingEnabled && occlusion.isBuilt() &&
+        localCamera.y > heightField.sampleBilinear(localCamera.x, localCamera.z);
+    if (occlusionCulling) {
+        occlusion.rasterize(projection * view * model);
+    }
+    for (int cz = 0; cz < chunksZ; ++cz) {
+        for (int cx = 0; cx < chunksX; ++cx) {
+            const TerrainChunk& chunk = chunks[cz * chunksX + cx];
+            if (!frustum.intersectsAABB(chunk.boundsMin, chunk.boundsMax)) {
+                continue;
+            }
+            if (occlusionCulling && occlusion.isOccluded(chunk.boundsMin, chunk.boundsMax)) {
+                ++occludedChunks;
+                continue;
+            }
+            if (adaptive) {
+                const TerrainRtinRange& range = adaptiveRanges[cz * chunksX + cx];
+                drawCounts.push_back(range.indexCount);
+                drawOffsets.push_back(reinterpret_cast<const void*>(range.indexOffset * sizeof(GLushort)));
+                drawBaseVertices.push_back(chunk.baseVertex);
+                ++visibleChunks;
+                drawnTriangles += range.indexCount / 3;
+                continue;
+            }
+
+            int level = chunk.lodLevel;
+            int edgeMask = 0;
+            if (cz > 0 && chunks[(cz - 1) * chunksX + cx].lodLevel > level) edgeMask |= EDGE_TOP;
+            if (cx < chunksX - 1 && chunks[cz * chunksX + cx + 1].lodLevel > level) edgeMask |= EDGE_RIGHT;
+            if (cz < chunksZ - 1 && chunks[(cz + 1) * chunksX + cx].lodLevel > level) edgeMask |= EDGE_BOTTOM;
+            if (cx > 0 && chunks[cz * chunksX + cx - 1].lodLevel > level) edgeMask |= EDGE_LEFT;
+
+            const TerrainIndexRange& range = lodIndices->ranges[level][edgeMask];
+            if (instanced) {
+                chunkInstances[level * 16 + edgeMask].emplace_back(static_cast<float>(cx * chunkSize), static_cast<float>(cz * chunkSize));
+            } else {
+                drawCounts.push_back(range.indexCount);
+                drawOffsets.push_back(reinterpret_cast<const void*>(range.indexOffset * sizeof(GLushort)));
+                drawBaseVertices.push_back(chunk.baseVertex);
+            }
+            ++visibleChunks;
+            drawnTriangles += range.triangleCount;
+        }
+    }
+    if (visibleChunks == 0) {
+        return;
+    }
 
-//    glBindVertexArray(terrainVAO);
-//    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-//    glBindVertexArray(0);
-    
     glBindVertexArray(terrainVAO);
-//    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_SHORT, 0);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-    checkOpenGLError("Terrain::render after glDrawElements");
+    const bool strips = lodIndicesAreStrips && !adaptive;
+    if (strips) {
+        // The restart index is compared before the base vertex is added
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(terrainShortRestartIndex);
+    }
+    GLenum primitive = strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    if (instanced) {
+        drawHeightTextureChunks(primitive);
+    } else {
+        glMultiDrawElementsBaseVertex(primitive, drawCounts.data(), GL_UNSIGNED_SHORT,
+            drawOffsets.data(), static_cast<GLsizei>(drawCounts.size()), drawBaseVertices.data());
+        checkOpenGLError("Terrain::render after glMultiDrawElementsBaseVertex");
+    }
+    if (strips) {
+        glDisable(GL_PRIMITIVE_RESTART);
+    }
     glBindVertexArray(0);
-//
+}
 
+// Upload the visible chunk origins and draw each index range as one instanced call
+void Terrain::drawHeightTextureChunks(GLenum primitive) {
+    instanceData.clear();
+    for (const auto& group : chunkInstances) {
+        instanceData.insert(instanceData.end(), group.begin(), group.end());
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, heightTexture);
+    terrainHeightShader.setInt("heightMap", 0);
+    glBindBuffer(GL_ARRAY_BUFFER, chunkInstanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(glm::vec2), instanceData.data(), GL_STREAM_DRAW);
+
+    size_t firstInstance = 0;
+    for (int level = 0; level < terrainLodLevels; ++level) {
+        for (int edgeMask = 0; edgeMask < 16; ++edgeMask) {
+            GLsizei instances = static_cast<GLsizei>(chunkInstances[level * 16 + edgeMask].size());
+            if (instances == 0) {
+                continue;
+            }
+            const TerrainIndexRange& range = lodIndices->ranges[level][edgeMask];
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)(firstInstance * sizeof(glm::vec2)));
+            glDrawElementsInstanced(primitive, range.indexCount, GL_UNSIGNED_SHORT,
+                reinterpret_cast<const void*>(range.indexOffset * sizeof(GLushort)), instances);
+            firstInstance += instances;
+        }
+    }
+    checkOpenGLError("Terrain::render after glDrawElementsInstanced");
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 float Terrain::getHeightAtPosition(float x, float z) const {
-    if (x < 0 || z < 0 || x >= (width - 1) * horizontalScale || z >= (height - 1) * horizontalScale)
-        return 0.0f;
+    if (renderMode == TerrainRenderMode::Streaming) {
+        return streamer.sampleHeight(x, z);
+    }
+    return heightField.sampleBilinear(x, z);
+}
 
-    x /= horizontalScale;
-    z /= horizontalScale;
+void Terrain::getHeightsAtPositions(const float* xs, const float* zs, size_t count, float* outHeights,
+                                    glm::vec3* outNormals, float* outSlopes) const {
+    if (renderMode != TerrainRenderMode::Streaming) {
+        heightField.sampleBilinear(xs, zs, count, outHeights, outNormals, outSlopes);
+        return;
+    }
+    // Tiles may have to be paged in, so streamed queries stay serial
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec2 gradient;
+        outHeights[i] = streamer.sampleHeight(xs[i], zs[i], &gradient);
+        if (outNormals) {
+            outNormals[i] = glm::normalize(glm::vec3(-gradient.x, 1.0f, -gradient.y));
+        }
+        if (outSlopes) {
+            outSlopes[i] = glm::degrees(std::atan(glm::length(gradient)));
+        }
+    }
+}
 
-    int ix = static_cast<int>(x);
-    int iz = static_cast<int>(z);
+float Terrain::getSlopeAtPosition(float x, float z, float* aspect) const {
+    if (renderMode != TerrainRenderMode::Streaming) {
+        return slopeMap.sample(x, z, aspect);
+    }
+    float slope;
+    getSlopesAtPositions(&x, &z, 1, &slope, aspect);
+    return slope;
+}
 
-    float fx = x - ix;
-    float fz = z - iz;
+void Terrain::getSlopesAtPositions(const float* xs, const float* zs, size_t count, float* outSlopes,
+                                   float* outAspects) const {
+    if (renderMode != TerrainRenderMode::Streaming) {
+        slopeMap.sample(xs, zs, count, outSlopes, outAspects);
+        return;
+    }
+    // No full grid is kept while streaming, so slopes come from the paged tiles' gradients
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec2 gradient;
+        streamer.sampleHeight(xs[i], zs[i], &gradient);
+        outSlopes[i] = glm::degrees(std::atan(glm::length(gradient)));
+        if (outAspects) {
+            float aspect = gradient == glm::vec2(0.0f) ? 0.0f : glm::degrees(std::atan2(-gradient.y, -gradient.x));
+            outAspects[i] = aspect < 0.0f ? aspect + 360.0f : aspect;
+        }
+    }
+}
+
+bool Terrain::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, TerrainRayHit& hit) const {
+    return raycastHeightField(heightField, heightPyramid, origin, direction, maxDistance, hit);
+}
+
+size_t Terrain::raycast(const glm::vec3* origins, const glm::vec3* directions, size_t count, float maxDistance,
+                        TerrainRayHit* hits, bool* didHit) const {
+    std::atomic<size_t> hitCount(0);
+    parallelFor(0, static_cast<int>(count), [&](int begin, int end) {
+        size_t localHits = 0;
+        for (int i = begin; i < end; ++i) {
+            didHit[i] = raycastHeightField(heightField, heightPyramid, origins[i], directions[i], maxDistance, hits[i]);
+            localHits += didHit[i] ? 1 : 0;
+        }
+        hitCount += localHits;
+    }, 64);
+    return hitCount;
+}
+
+// Cosine falloff from full weight inside hardness * radius to zero at the radius
+bool Terrain::applyBrush(float x, float z, const TerrainBrush& brush) {
+    const float spacing = horizontalScale * sampleStep;
+    const float radius = std::max(brush.radius, 0.0f);
+    const float inner = radius * glm::clamp(brush.hardness, 0.0f, 1.0f);
+    // Clamped before converting so brushes far off the grid cannot overflow
+    auto firstSample = [&](float position, int count) {
+        return static_cast<int>(std::ceil(glm::clamp((position - radius) / spacing, -1.0f, static_cast<float>(count))));
+    };
+    auto endSample = [&](float position, int count) {
+        return static_cast<int>(std::floor(glm::clamp((position + radius) / spacing, -1.0f, static_cast<float>(count)))) + 1;
+    };
+
+    return editHeights(firstSample(x, gridWidth), firstSample(z, gridHeight), endSample(x, gridWidth), endSample(z, gridHeight),
+                       [&](int sampleX, int sampleZ, float h) {
+        float distance = glm::length(glm::vec2(sampleX * spacing - x, sampleZ * spacing - z));
+        if (distance >= radius) {
+            return h;
+        }
+        float weight = 1.0f;
+        if (distance > inner) {
+            weight = 0.5f + 0.5f * std::cos(glm::pi<float>() * (distance - inner) / (radius - inner));
+        }
+        switch (brush.mode) {
+        case TerrainBrushMode::Raise:
+            return h + brush.strength * weight;
+        case TerrainBrushMode::Lower:
+            return h - brush.strength * weight;
+        case TerrainBrushMode::Flatten:
+            return h + (brush.targetHeight - h) * glm::clamp(brush.strength * weight, 0.0f, 1.0f);
+        }
+        return h;
+    });
+}
 
-    float h00 = heights[iz * width + ix];
-    float h01 = heights[iz * width + (ix + 1)];
-    float h10 = heights[(iz + 1) * width + ix];
-    float h11 = heights[(iz + 1) * width + (ix + 1)];
+bool Terrain::stampHeights(float x, float z, const float* stamp, int stampWidth, int stampHeight, float scale) {
+    if (!stamp || stampWidth <= 0 || stampHeight <= 0) {
+        std::cerr << "ERROR: Empty terrain height stamp" << std::endl;
+        return false;
+    }
+    const float spacing = horizontalScale * sampleStep;
+    const int x0 = static_cast<int>(std::round(glm::clamp(x / spacing, -1.0f, static_cast<float>(gridWidth)))) - stampWidth / 2;
+    const int z0 = static_cast<int>(std::round(glm::clamp(z / spacing, -1.0f, static_cast<float>(gridHeight)))) - stampHeight / 2;
+    return editHeights(x0, z0, x0 + stampWidth, z0 + stampHeight, [&](int sampleX, int sampleZ, float h) {
+        return h + scale * stamp[static_cast<size_t>(sampleZ - z0) * stampWidth + (sampleX - x0)];
+    });
+}
 
-    float h0 = h00 * (1.0f - fx) + h01 * fx;
-    float h1 = h10 * (1.0f - fx) + h11 * fx;
+bool Terrain::editHeights(int x0, int z0, int x1, int z1, const std::function<float(int, int, float)>& edit) {
+    if (heightField.isEmpty()) {
+        std::cerr << "ERROR: No editable terrain height grid"
+            << (renderMode == TerrainRenderMode::Streaming ? " in Streaming mode" : " loaded") << std::endl;
+        return false;
+    }
+    x0 = std::max(x0, 0);
+    z0 = std::max(z0, 0);
+    x1 = std::min(x1, gridWidth);
+    z1 = std::min(z1, gridHeight);
+    if (x0 >= x1 || z0 >= z1) {
+        return true;
+    }
 
-    return h0 * (1.0f - fz) + h1 * fz;
+    for (int z = z0; z < z1; ++z) {
+        for (int x = x0; x < x1; ++x) {
+            heightField.setSample(x, z, edit(x, z, heightField.getSample(x, z)));
+        }
+    }
+    refreshEditedRegion(x0, z0, x1, z1);
+    return true;
 }
 
+// Heights are the source of truth: the block of chunks around the edit, plus one sample for
+// the normals at its border, is read back from heightField and everything else is derived
+// from that block. Only a packed height range that has to grow touches the whole terrain.
+void Terrain::refreshEditedRegion(int x0, int z0, int x1, int z1) {
+    const float spacing = horizontalScale * sampleStep;
+    ++heightRevision;
+
+    // Normals change up to one sample outside the edit
+    const int normalX0 = std::max(x0 - 1, 0);
+    const int normalZ0 = std::max(z0 - 1, 0);
+    const int normalX1 = std::min(x1 + 1, gridWidth);
+    const int normalZ1 = std::min(z1 + 1, gridHeight);
+
+    // Chunks holding a copy of any sample in [first, end); a sample on a chunk border belongs to both chunks
+    auto chunkRange = [](int first, int end, int chunkCount, int& chunkFirst, int& chunkEnd) {
+        chunkFirst = std::max(first - 1, 0) / chunkSize;
+        chunkEnd = std::min((end - 1) / chunkSize, chunkCount - 1) + 1;
+    };
+    int chunkX0, chunkX1, chunkZ0, chunkZ1;
+    chunkRange(normalX0, normalX1, chunksX, chunkX0, chunkX1);
+    chunkRange(normalZ0, normalZ1, chunksZ, chunkZ0, chunkZ1);
+
+    const int blockX0 = std::max(chunkX0 * chunkSize - 1, 0);
+    const int blockZ0 = std::max(chunkZ0 * chunkSize - 1, 0);
+    const int blockX1 = std::min(chunkX1 * chunkSize + 2, gridWidth);
+    const int blockZ1 = std::min(chunkZ1 * chunkSize + 2, gridHeight);
+    const int blockColumns = blockX1 - blockX0;
+    const int blockRows = blockZ1 - blockZ0;
+    std::vector<float> block(static_cast<size_t>(blockColumns) * blockRows);
+    heightField.copyToRowMajor(blockX0, blockZ0, blockColumns, blockRows, block.data());
+    std::vector<glm::vec3> blockNormals(block.size());
+    computeGridNormals(block.data(), blockColumns, blockRows, spacing, blockNormals.data(),
+                       chunkX0 * chunkSize - blockX0, chunkZ0 * chunkSize - blockZ0,
+                       std::min(chunkX1 * chunkSize + 1, gridWidth) - blockX0, std::min(chunkZ1 * chunkSize + 1, gridHeight) - blockZ0);
+    auto blockIndex = [&](int x, int z) { return static_cast<size_t>(z - blockZ0) * blockColumns + (x - blockX0); };
+
+    heightPyramid.update(block.data(), blockX0, blockZ0, blockColumns, blockRows);
+    if (occlusion.isBuilt()) {
+        buildOccluder();
+    }
+    float newMinHeight, newMaxHeight;
+    heightPyramid.getMinMax(heightPyramid.getLevelCount() - 1, 0, 0, newMinHeight, newMaxHeight);
+    std::vector<float> grid;
+    if (newMinHeight < minHeight || newMaxHeight > maxHeight) {
+        minHeight = std::min(minHeight, newMinHeight);
+        maxHeight = std::max(maxHeight, newMaxHeight);
+        if (vertexFormat == TerrainVertexFormat::Packed && renderMode != TerrainRenderMode::CDLOD &&
+            renderMode != TerrainRenderMode::Tessellation && renderMode != TerrainRenderMode::Clipmap) {
+            // Packed heights are relative to the range, so every one of them is re-encoded
+            std::cout << "INFO: Terrain height range grew to [" << minHeight << ", " << maxHeight
+                << "], re-encoding all packed heights" << std::endl;
+            grid.resize(static_cast<size_t>(gridWidth) * gridHeight);
+            heightField.copyToRowMajor(0, 0, gridWidth, gridHeight, grid.data());
+        }
+    }
+
+    normalMap.update(&blockNormals[blockIndex(normalX0, normalZ0)], blockColumns,
+                     normalX0, normalZ0, normalX1 - normalX0, normalZ1 - normalZ0);
+    horizonMap.update(heightField, x0, z0, x1, z1);
+    slopeMap.update(heightField, x0, z0, x1, z1);
+
+    if (renderMode == TerrainRenderMode::CDLOD || renderMode == TerrainRenderMode::Tessellation ||
+        renderMode == TerrainRenderMode::Clipmap) {
+        std::vector<float> edited(static_cast<size_t>(x1 - x0) * (z1 - z0));
+        heightField.copyToRowMajor(x0, z0, x1 - x0, z1 - z0, edited.data());
+        if (renderMode == TerrainRenderMode::CDLOD) {
+            cdlodTerrain.updateHeights(edited.data(), x0, z0, x1 - x0, z1 - z0);
+        } else if (renderMode == TerrainRenderMode::Tessellation) {
+            tessTerrain.updateHeights(edited.data(), x0, z0, x1 - x0, z1 - z0);
+        } else {
+            clipmapTerrain.updateHeights(edited.data(), x0, z0, x1 - x0, z1 - z0);
+        }
+        return;
+    }
+    if (chunks.empty()) {
+        return;
+    }
+
+    for (int cz = chunkZ0; cz < chunkZ1; ++cz) {
+        for (int cx = chunkX0; cx < chunkX1; ++cx) {
+            measureChunk(chunks[cz * chunksX + cx], &block[blockIndex(cx * chunkSize, cz * chunkSize)], blockColumns);
+        }
+    }
+
+    if (renderMode == TerrainRenderMode::HeightTexture) {
+        if (!grid.empty()) {
+            uploadHeightTexture(grid.data(), gridWidth, 0, 0, gridWidth, gridHeight);
+        } else {
+            uploadHeightTexture(&block[blockIndex(x0, z0)], blockColumns, x0, z0, x1 - x0, z1 - z0);
+        }
+        checkOpenGLError("Terrain::refreshEditedRegion after height texture update");
+        return;
+    }
+
+    // Rewrite the chunk rows holding a changed height or normal
+    const size_t vertexSize = getVertexSize();
+    const size_t rowBytes = (chunkSize + 1) * vertexSize;
+    std::vector<unsigned char> vertexData;
+    glBindBuffer(GL_ARRAY_BUFFER, terrainVBO);
+    if (!grid.empty()) {
+        std::vector<glm::vec3> gridNormals;
+        if (vertexNormals) {
+            gridNormals.resize(grid.size());
+            computeGridNormals(grid.data(), gridWidth, gridHeight, spacing, gridNormals.data());
+        }
+        auto heightAt = [&](int x, int z) { return grid[static_cast<size_t>(z) * gridWidth + x]; };
+        auto normalAt = [&](int x, int z) { return gridNormals[static_cast<size_t>(z) * gridWidth + x]; };
+        vertexData.resize(chunks.size() * (chunkSize + 1) * rowBytes);
+        for (int chunk = 0; chunk < static_cast<int>(chunks.size()); ++chunk) {
+            writeVertexRows(chunk, 0, chunkSize + 1, heightAt, normalAt, &vertexData[chunk * (chunkSize + 1) * rowBytes]);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertexData.size(), vertexData.data());
+    } else {
+        auto heightAt = [&](int x, int z) { return block[blockIndex(x, z)]; };
+        auto normalAt = [&](int x, int z) { return blockNormals[blockIndex(x, z)]; };
+        for (int cz = chunkZ0; cz < chunkZ1; ++cz) {
+            int firstRow = std::max(normalZ0 - cz * chunkSize, 0);
+            int endRow = std::min(normalZ1 - cz * chunkSize, chunkSize + 1);
+            vertexData.resize((endRow - firstRow) * rowBytes);
+            for (int cx = chunkX0; cx < chunkX1; ++cx) {
+                const int chunk = cz * chunksX + cx;
+                writeVertexRows(chunk, firstRow, endRow - firstRow, heightAt, normalAt, vertexData.data());
+                glBufferSubData(GL_ARRAY_BUFFER, chunks[chunk].baseVertex * vertexSize + firstRow * rowBytes,
+                                vertexData.size(), vertexData.data());
+            }
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    checkOpenGLError("Terrain::refreshEditedRegion after vertex update");
 
+    if (renderMode == TerrainRenderMode::Adaptive && rtin.isBuilt()) {
+        // Chunks whose heights changed, plus a ring so border errors merged from the old
+        // heights are recomputed as well
+        int tileX0, tileX1, tileZ0, tileZ1;
+        chunkRange(x0, x1, chunksX, tileX0, tileX1);
+        chunkRange(z0, z1, chunksZ, tileZ0, tileZ1);
+        tileX0 = std::max(tileX0 - 1, 0);
+        tileZ0 = std::max(tileZ0 - 1, 0);
+        tileX1 = std::min(tileX1 + 1, chunksX);
+        tileZ1 = std::min(tileZ1 + 1, chunksZ);
+        const int tileColumns = (tileX1 - tileX0) * chunkSize + 1;
+        const int tileRows = (tileZ1 - tileZ0) * chunkSize + 1;
+        std::vector<float> tileHeights(static_cast<size_t>(tileColumns) * tileRows);
+        heightField.copyToRowMajor(tileX0 * chunkSize, tileZ0 * chunkSize, tileColumns, tileRows, tileHeights.data());
+        std::vector<int> changedTiles;
+        rtin.update(tileHeights.data(), tileColumns, tileX0, tileZ0, tileX1, tileZ1, changedTiles);
+        updateAdaptiveTiles(changedTiles);
+    }
+}
 
 // Cleanup terrain resources
 void Terrain::cleanup() {
+    if (pending.vertexBuffer) glDeleteBuffers(1, &pending.vertexBuffer);
+    pending = PendingLoad();
     if (terrainVAO) glDeleteVertexArrays(1, &terrainVAO);
     if (terrainVBO) glDeleteBuffers(1, &terrainVBO);
     if (terrainEBO) glDeleteBuffers(1, &terrainEBO);
@@ -231,6 +1761,28 @@ void Terrain::cleanup() {
     terrainVAO = 0;
     terrainVBO = 0;
     terrainEBO = 0;
+    lodIndices = nullptr;
+    chunks.clear();
+    occlusion.clear();
+    if (heightTexture) glDeleteTextures(1, &heightTexture);
+    if (chunkInstanceVBO) glDeleteBuffers(1, &chunkInstanceVBO);
+    heightTexture = 0;
+    chunkInstanceVBO = 0;
+    if (adaptiveEBO) glDeleteBuffers(1, &adaptiveEBO);
+    adaptiveEBO = 0;
+    adaptiveRanges.clear();
+    adaptiveIndices.clear();
+    adaptiveIndexCapacity = adaptiveIndexGarbage = 0;
+    rtin.clear();
+    cdlodTerrain.cleanup();
+    tessTerrain.cleanup();
+    clipmapTerrain.cleanup();
+    normalMap.cleanup();
+    horizonMap.cleanup();
+    streamer.close();
+    heightPyramid.clear();
+    heightField.clear();
+    slopeMap.clear();
 
     std::cout << "INFO: Terrain resources cleaned up." << std::endl;
 }
@@ -238,10 +1790,69 @@ void Terrain::cleanup() {
 // Getters
 int Terrain::getWidth() const { return width; }
 int Terrain::getHeight() const { return height; }
-Shader& Terrain::getShader() { return terrainShader; }
+Shader& Terrain::getShader() {
+    if (renderMode == TerrainRenderMode::CDLOD) {
+        return cdlodTerrain.getShader();
+    }
+    if (renderMode == TerrainRenderMode::Tessellation) {
+        return tessTerrain.getShader();
+    }
+    if (renderMode == TerrainRenderMode::Clipmap) {
+        return clipmapTerrain.getShader();
+    }
+    if (renderMode == TerrainRenderMode::HeightTexture) {
+        return terrainHeightShader;
+    }
+    return vertexFormat == TerrainVertexFormat::Packed ? terrainPackedShader : terrainShader;
+}
+TerrainRenderMode Terrain::getRenderMode() const { return renderMode; }
+TerrainVertexFormat Terrain::getVertexFormat() const { return vertexFormat; }
 float Terrain::getHeightScale() const { return heightScale; }
 float Terrain::getHorizontalScale() const { return horizontalScale; }
+const HeightField& Terrain::getHeightField() const { return heightField; }
+size_t Terrain::getChunkCount() const { return chunks.size(); }
+size_t Terrain::getVisibleChunkCount() const { return visibleChunks; }
+size_t Terrain::getOccludedChunkCount() const { return occludedChunks; }
+size_t Terrain::getDrawnTriangleCount() const {
+    if (renderMode == TerrainRenderMode::Clipmap) {
+        return clipmapTerrain.getDrawnTriangleCount();
+    }
+    return renderMode == TerrainRenderMode::Streaming ? streamer.getDrawnTriangleCount() : drawnTriangles;
+}
+TerrainStreamer& Terrain::getStreamer() { return streamer; }
+const ClipmapTerrain& Terrain::getClipmapTerrain() const { return clipmapTerrain; }
+const TerrainNormalMap& Terrain::getNormalMap() const { return normalMap; }
+const TerrainHorizonMap& Terrain::getHorizonMap() const { return horizonMap; }
+glm::vec3 Terrain::getSunDirection() const { return sunDirection; }
+float Terrain::getAdaptiveMaxError() const { return adaptiveMaxError; }
+int Terrain::getSampleStep() const { return sampleStep; }
+HeightFilter Terrain::getHeightFilter() const { return heightFilter; }
+unsigned int Terrain::getHeightRevision() const { return heightRevision; }
 
 // Setters
 void Terrain::setHeightScale(float scale) { heightScale = scale; }
 void Terrain::setHorizontalScale(float scale) { horizontalScale = scale; }
+void Terrain::setSampleStep(int step) { sampleStep = std::max(step, 1); }
+void Terrain::setPreviewResolution(int samples) { previewResolution = std::max(samples, 0); }
+void Terrain::setHeightFilter(HeightFilter filter) { heightFilter = filter; }
+void Terrain::setPixelErrorThreshold(float pixels) { pixelErrorThreshold = std::max(pixels, 0.1f); }
+void Terrain::setRenderMode(TerrainRenderMode mode) { renderMode = mode; }
+void Terrain::setVertexFormat(TerrainVertexFormat format) { vertexFormat = format; }
+void Terrain::setCacheEnabled(bool enabled) { cacheEnabled = enabled; }
+void Terrain::setTriangleStrips(bool enabled) { triangleStrips = enabled; }
+void Terrain::setNormalMapEnabled(bool enabled) { normalMapEnabled = enabled; }
+void Terrain::setHorizonMapEnabled(bool enabled) { horizonMapEnabled = enabled; }
+void Terrain::setOcclusionCullingEnabled(bool enabled) { occlusionCullingEnabled = enabled; }
+void Terrain::setAdaptiveMaxError(float error) {
+    adaptiveMaxError = std::max(error, 0.0f);
+    if (renderMode == TerrainRenderMode::Adaptive && rtin.isBuilt() && terrainVAO) {
+        glBindVertexArray(terrainVAO);
+        bindAdaptiveIndexBuffer();
+        glBindVertexArray(0);
+    }
+}
+void Terrain::setSunDirection(const glm::vec3& direction) {
+    if (glm::length(direction) > 0.0f) {
+        sunDirection = glm::normalize(direction);
+    }
+}
@@ -0,0 +1,262 @@
+#include "terrainCache.h"
+#include "terrain.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const char cacheMagic[8] = { 'T', 'R', 'N', 'C', 'A', 'C', 'H', 'E' };
+    const uint64_t sectionAlignment = 64;
+
+    bool statFile(const std::string& path, uint64_t& size, int64_t& modified) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        size = static_cast<uint64_t>(info.st_size);
+        modified = static_cast<int64_t>(info.st_mtime);
+        return true;
+    }
+
+    // FNV-1a over the whole file
+    bool hashFile(const std::string& path, uint64_t& hash) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        hash = 14695981039346656037ull;
+        std::vector<char> buffer(1 << 16);
+        while (file) {
+            file.read(buffer.data(), buffer.size());
+            std::streamsize count = file.gcount();
+            for (std::streamsize i = 0; i < count; ++i) {
+                hash ^= static_cast<unsigned char>(buffer[i]);
+                hash *= 1099511628211ull;
+            }
+        }
+        return true;
+    }
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+    }
+
+    bool keysMatch(const TerrainCacheKey& a, const TerrainCacheKey& b) {
+        return a.sampleStep == b.sampleStep && a.chunkSize == b.chunkSize &&
+            a.vertexFormat == b.vertexFormat && a.includesMesh == b.includesMesh &&
+            a.vertexNormals == b.vertexNormals && a.heightFilter == b.heightFilter &&
+            a.heightScale == b.heightScale && a.horizontalScale == b.horizontalScale;
+    }
+}
+
+// Constructor
+TerrainCache::TerrainCache()
+    : mapping(nullptr), mappingSize(0), mappedFromDisk(false) {}
+
+// Destructor
+TerrainCache::~TerrainCache() {
+    close();
+}
+
+std::string TerrainCache::cachePathFor(const std::string& sourcePath) {
+    return sourcePath + ".terraincache";
+}
+
+bool TerrainCache::open(const std::string& cachePath, const std::string& sourcePath, const TerrainCacheKey& key) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(TerrainCacheHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+    mapping = static_cast<const unsigned char*>(address);
+    mappingSize = static_cast<size_t>(info.st_size);
+    mappedFromDisk = true;
+#else
+    // No mmap here; read the file into memory instead
+    std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    mappingSize = static_cast<size_t>(file.tellg());
+    if (mappingSize < sizeof(TerrainCacheHeader)) {
+        mappingSize = 0;
+        return false;
+    }
+    unsigned char* buffer = new unsigned char[mappingSize];
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer), mappingSize);
+    mapping = buffer;
+    mappedFromDisk = false;
+#endif
+
+    const TerrainCacheHeader& header = getHeader();
+    if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+        header.version != TERRAIN_CACHE_VERSION || header.headerSize != sizeof(TerrainCacheHeader)) {
+        std::cout << "INFO: Ignoring terrain cache with unknown format: " << cachePath << std::endl;
+        close();
+        return false;
+    }
+    if (!keysMatch(header.key, key)) {
+        std::cout << "INFO: Terrain cache was built with different settings: " << cachePath << std::endl;
+        close();
+        return false;
+    }
+
+    // Size and timestamp are enough when unchanged; otherwise fall back to the content hash
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    if (!statFile(sourcePath, sourceSize, sourceModified)) {
+        close();
+        return false;
+    }
+    if (sourceSize != header.sourceSize || sourceModified != header.sourceModified) {
+        uint64_t sourceHash;
+        if (!hashFile(sourcePath, sourceHash) || sourceHash != header.sourceHash) {
+            std::cout << "INFO: Terrain cache is out of date: " << cachePath << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    uint64_t gridSamples = static_cast<uint64_t>(header.gridWidth) * header.gridHeight;
+    uint64_t chunkCount = static_cast<uint64_t>(header.chunksX) * header.chunksZ;
+    bool valid = sectionFits(header.heightsOffset, gridSamples * sizeof(float));
+    if (header.key.includesMesh) {
+        valid = valid && sectionFits(header.vertexOffset, header.vertexBytes) &&
+            sectionFits(header.chunkOffset, chunkCount * sizeof(TerrainChunk));
+    }
+    if (!valid) {
+        std::cerr << "WARNING: Terrain cache is truncated: " << cachePath << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TerrainCache::close() {
+    if (mapping) {
+#ifndef _WIN32
+        if (mappedFromDisk) {
+            munmap(const_cast<unsigned char*>(mapping), mappingSize);
+        } else
+#endif
+        {
+            delete[] mapping;
+        }
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    mappedFromDisk = false;
+}
+
+// Write header and sections to a temporary file, then rename it over the old cache so a
+// reader never maps a half-written file.
+bool TerrainCache::write(const std::string& cachePath, const std::string& sourcePath,
+                         const TerrainCacheKey& key, const TerrainCacheContents& contents) {
+    TerrainCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = TERRAIN_CACHE_VERSION;
+    header.headerSize = sizeof(TerrainCacheHeader);
+    if (!statFile(sourcePath, header.sourceSize, header.sourceModified) || !hashFile(sourcePath, header.sourceHash)) {
+        return false;
+    }
+    header.key = key;
+    header.imageWidth = contents.imageWidth;
+    header.imageHeight = contents.imageHeight;
+    header.gridWidth = contents.gridWidth;
+    header.gridHeight = contents.gridHeight;
+    header.chunksX = contents.chunksX;
+    header.chunksZ = contents.chunksZ;
+    header.minHeight = contents.minHeight;
+    header.maxHeight = contents.maxHeight;
+
+    uint64_t heightsBytes = static_cast<uint64_t>(contents.gridWidth) * contents.gridHeight * sizeof(float);
+    uint64_t chunkBytes = static_cast<uint64_t>(contents.chunksX) * contents.chunksZ * sizeof(TerrainChunk);
+
+    header.heightsOffset = alignUp(sizeof(TerrainCacheHeader));
+    uint64_t end = header.heightsOffset + heightsBytes;
+    if (key.includesMesh) {
+        header.vertexOffset = alignUp(end);
+        header.vertexBytes = contents.vertexBytes;
+        header.chunkOffset = alignUp(header.vertexOffset + header.vertexBytes);
+        end = header.chunkOffset + chunkBytes;
+    }
+
+    std::string temporaryPath = cachePath + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "WARNING: Failed to create terrain cache: " << temporaryPath << std::endl;
+        return false;
+    }
+
+    auto writeSection = [&](uint64_t offset, const void* data, uint64_t bytes) {
+        static const char padding[sectionAlignment] = {};
+        uint64_t position = static_cast<uint64_t>(file.tellp());
+        file.write(padding, static_cast<std::streamsize>(offset - position));
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeSection(header.heightsOffset, contents.heights, heightsBytes);
+    if (key.includesMesh) {
+        writeSection(header.vertexOffset, contents.vertexData, header.vertexBytes);
+        writeSection(header.chunkOffset, contents.chunks, chunkBytes);
+    }
+    file.close();
+
+    if (!file || static_cast<uint64_t>(std::ifstream(temporaryPath, std::ios::binary | std::ios::ate).tellg()) != end) {
+        std::cerr << "WARNING: Failed to write terrain cache: " << temporaryPath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    // rename replaces the old file atomically on POSIX; Windows refuses an existing target
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0
+        && (std::remove(cachePath.c_str()) != 0 || std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0)) {
+        std::cerr << "WARNING: Failed to replace terrain cache: " << cachePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TerrainCache::sectionFits(uint64_t offset, uint64_t bytes) const {
+    return offset <= mappingSize && bytes <= mappingSize - offset;
+}
+
+// Getters
+const TerrainCacheHeader& TerrainCache::getHeader() const {
+    return *reinterpret_cast<const TerrainCacheHeader*>(mapping);
+}
+
+const float* TerrainCache::getHeights() const {
+    return reinterpret_cast<const float*>(mapping + getHeader().heightsOffset);
+}
+
+const void* TerrainCache::getVertexData() const {
+    return mapping + getHeader().vertexOffset;
+}
+
+const TerrainChunk* TerrainCache::getChunks() const {
+    return reinterpret_cast<const TerrainChunk*>(mapping + getHeader().chunkOffset);
+}
@@ -0,0 +1,90 @@
+#ifndef TERRAINHORIZONMAP_H
+#define TERRAINHORIZONMAP_H
+
+#include <GL/glew.h>
+#include <vector>
+
+class HeightField;
+
+/// Azimuths the horizon is stored for, 45 degrees apart starting at +X and turning towards +Z.
+const int horizonDirectionCount = 8;
+
+/**
+ * @class TerrainHorizonMap
+ * @brief Horizon elevation of every height sample in horizonDirectionCount directions.
+ *
+ * Each direction is swept along the grid lines (or diagonals) it follows, keeping the upper
+ * convex hull of the samples already passed, so the exact horizon over the whole grid costs
+ * amortized O(1) per sample rather than a ray march. Lines are split across worker threads
+ * and the tangents are converted to sines four at a time. The sines are stored as 8-bit
+ * unorm values in a two-layer RGBA array texture (directions 0-3, then 4-7): a fragment is
+ * in sun light when the sun's elevation sine exceeds the horizon sine towards it, and the
+ * mean of the squared sines is the cosine-weighted share of the sky that is hidden.
+ *
+ * An edit changes the horizon of every sample looking across it, so update() re-sweeps the
+ * whole lines through the edited rectangle in each direction and uploads the bounding box of
+ * the texels whose value changed.
+ */
+class TerrainHorizonMap {
+public:
+    /**
+     * @brief Constructor.
+     */
+    TerrainHorizonMap();
+
+    /**
+     * @brief Computes the horizons and uploads them, replacing any previous texture.
+     * @param heights Row-major height grid.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @return True if successful, false otherwise.
+     */
+    bool build(const float* heights, int gridWidth, int gridHeight, float spacing);
+
+    /**
+     * @brief The CPU half of build: sweeps every direction without touching OpenGL, so it may
+     *        run on a worker thread. The previous texture stays until upload().
+     * @param heights Row-major height grid.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @return False if the grid exceeds the maximum texture size.
+     */
+    bool bake(const float* heights, int gridWidth, int gridHeight, float spacing);
+
+    /**
+     * @brief The OpenGL half of build: creates the texture and its mip chain from the baked
+     *        horizons, replacing any previous one. Does nothing if nothing is baked.
+     */
+    void upload();
+
+    /**
+     * @brief Recomputes the horizons affected by an edit and uploads the texels that changed.
+     * @param heights Height grid after the edit, with the dimensions and spacing of the bake.
+     * @param x0 First edited column.
+     * @param z0 First edited row.
+     * @param x1 One past the last edited column.
+     * @param z1 One past the last edited row.
+     */
+    void update(const HeightField& heights, int x0, int z0, int x1, int z1);
+
+    /**
+     * @brief Cleans up OpenGL resources.
+     */
+    void cleanup();
+
+    // Getters
+    GLuint getTexture() const;   ///< GL_TEXTURE_2D_ARRAY with horizonDirectionCount / 4 layers.
+    bool isBuilt() const;
+    bool isBaked() const;        ///< Horizons are computed, whether or not they are uploaded yet.
+
+private:
+    GLuint texture;                    ///< RGBA8 array texture with a full mip chain.
+    int gridWidth, gridHeight;         ///< Dimensions of the baked grid.
+    float spacing;                     ///< Sample spacing of the baked grid.
+    std::vector<unsigned char> texels; ///< CPU copy of level 0, layer after layer.
+    GLint maxTextureSize;              ///< Queried at construction so bake() needs no context.
+};
+
+#endif // TERRAINHORIZONMAP_H
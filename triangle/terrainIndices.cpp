@@ -0,0 +1,198 @@
+#include "terrainIndices.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    const float lastTriangleScore = 0.75f;
+    const float cacheDecayPower = 1.5f;
+    const float valenceBoostScale = 2.0f;
+    const float valenceBoostPower = 0.5f;
+
+    float vertexScore(int cachePosition, int liveTriangles, int cacheSize) {
+        if (liveTriangles == 0) {
+            return -1.0f;
+        }
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                score = lastTriangleScore;
+            } else {
+                float scaler = 1.0f / (cacheSize - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, cacheDecayPower);
+            }
+        }
+        return score + valenceBoostScale * std::pow(static_cast<float>(liveTriangles), -valenceBoostPower);
+    }
+
+    // True if triangle (t0, t1, t2) is (a, b, c) up to rotation; sets c
+    bool matchesEdge(const GLuint* t, GLuint a, GLuint b, GLuint& c) {
+        for (int r = 0; r < 3; ++r) {
+            if (t[r] == a && t[(r + 1) % 3] == b) {
+                c = t[(r + 2) % 3];
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void optimizeVertexCache(GLuint* indices, size_t indexCount, int cacheSize) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Remap to dense vertex ids so per-vertex state can live in flat arrays
+    std::vector<GLuint> uniqueVertices(indices, indices + indexCount);
+    std::sort(uniqueVertices.begin(), uniqueVertices.end());
+    uniqueVertices.erase(std::unique(uniqueVertices.begin(), uniqueVertices.end()), uniqueVertices.end());
+    const size_t vertexCount = uniqueVertices.size();
+    std::vector<int> local(indexCount);
+    for (size_t i = 0; i < indexCount; ++i) {
+        local[i] = static_cast<int>(std::lower_bound(uniqueVertices.begin(), uniqueVertices.end(), indices[i]) - uniqueVertices.begin());
+    }
+
+    // Vertex -> triangle adjacency
+    std::vector<int> liveTriangles(vertexCount, 0);
+    for (int v : local) {
+        ++liveTriangles[v];
+    }
+    std::vector<int> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    }
+    std::vector<int> adjacency(indexCount);
+    std::vector<int> adjacencyFill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            adjacency[adjacencyFill[local[t * 3 + k]]++] = static_cast<int>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScores[v] = vertexScore(-1, liveTriangles[v], cacheSize);
+    }
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScores[t] = vertexScores[local[t * 3]] + vertexScores[local[t * 3 + 1]] + vertexScores[local[t * 3 + 2]];
+    }
+
+    std::vector<int> cache, nextCache;
+    cache.reserve(cacheSize + 3);
+    nextCache.reserve(cacheSize + 3);
+    std::vector<GLuint> output;
+    output.reserve(indexCount);
+
+    int bestTriangle = static_cast<int>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    size_t scanCursor = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        if (bestTriangle < 0) {
+            // Nothing in the cache has live triangles left; take the best remaining one
+            float bestScore = -1.0f;
+            while (scanCursor < triangleCount && emitted[scanCursor]) {
+                ++scanCursor;
+            }
+            for (size_t t = scanCursor; t < triangleCount; ++t) {
+                if (!emitted[t] && triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = static_cast<int>(t);
+                }
+            }
+        }
+
+        const int* tri = &local[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        for (int k = 0; k < 3; ++k) {
+            output.push_back(indices[bestTriangle * 3 + k]);
+            int v = tri[k];
+            int* begin = &adjacency[adjacencyOffset[v]];
+            int* end = begin + liveTriangles[v];
+            *std::find(begin, end, bestTriangle) = *(end - 1);
+            --liveTriangles[v];
+        }
+
+        // The emitted triangle moves to the front of the LRU cache
+        nextCache.assign(tri, tri + 3);
+        for (int v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            cachePosition[nextCache[i]] = static_cast<int>(i) < cacheSize ? static_cast<int>(i) : -1;
+        }
+
+        // Rescore everything that was or is in the cache and look for the next best triangle
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (int v : nextCache) {
+            vertexScores[v] = vertexScore(cachePosition[v], liveTriangles[v], cacheSize);
+        }
+        for (int v : nextCache) {
+            for (int a = adjacencyOffset[v]; a < adjacencyOffset[v] + liveTriangles[v]; ++a) {
+                int t = adjacency[a];
+                float score = vertexScores[local[t * 3]] + vertexScores[local[t * 3 + 1]] + vertexScores[local[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (static_cast<int>(nextCache.size()) > cacheSize) {
+            nextCache.resize(cacheSize);
+        }
+        cache.swap(nextCache);
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void buildTriangleStrips(const GLuint* triangles, size_t indexCount, std::vector<GLuint>& strips) {
+    size_t stripLength = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const GLuint* tri = triangles + i;
+        GLuint next;
+        if (stripLength >= 3) {
+            // Triangle k of a strip is (s[k], s[k+1], s[k+2]) with odd ones flipped
+            GLuint a = strips[strips.size() - 2];
+            GLuint b = strips[strips.size() - 1];
+            bool odd = (stripLength - 2) % 2 == 1;
+            if (odd ? matchesEdge(tri, b, a, next) : matchesEdge(tri, a, b, next)) {
+                strips.push_back(next);
+                ++stripLength;
+                continue;
+            }
+            strips.push_back(terrainRestartIndex);
+        }
+        strips.insert(strips.end(), tri, tri + 3);
+        stripLength = 3;
+    }
+}
+
+void measureVertexCache(const GLuint* indices, size_t indexCount, bool strips, VertexCacheStats& stats, int cacheSize) {
+    std::vector<GLuint> fifo(cacheSize, terrainRestartIndex);
+    size_t head = 0;
+    size_t stripLength = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        GLuint index = indices[i];
+        if (strips && index == terrainRestartIndex) {
+            stripLength = 0;
+            continue;
+        }
+        if (std::find(fifo.begin(), fifo.end(), index) == fifo.end()) {
+            fifo[head] = index;
+            head = (head + 1) % cacheSize;
+            ++stats.transforms;
+        }
+        ++stripLength;
+        if (strips ? stripLength >= 3 : stripLength % 3 == 0) {
+            ++stats.triangles;
+        }
+    }
+}
@@ -0,0 +1,205 @@
+#include "terrainNormalMap.h"
+#include "terrainNormals.h"
+#include "parallel.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+void checkOpenGLError(const std::string& location); // Defined in terrain.cpp
+
+namespace {
+    // X and Z scaled to the full signed 16-bit range
+    void encodeNormal(const glm::vec3& normal, GLshort* texel) {
+        texel[0] = static_cast<GLshort>(std::round(glm::clamp(normal.x, -1.0f, 1.0f) * 32767.0f));
+        texel[1] = static_cast<GLshort>(std::round(glm::clamp(normal.z, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    // Inverse of encodeNormal, rebuilding Y like the shader
+    glm::vec3 decodeNormal(const GLshort* texel) {
+        float x = texel[0] / 32767.0f;
+        float z = texel[1] / 32767.0f;
+        return glm::vec3(x, std::sqrt(std::max(1.0f - x * x - z * z, 0.0f)), z);
+    }
+
+    void encodeLevel(const std::vector<glm::vec3>& normals, std::vector<GLshort>& encoded) {
+        encoded.resize(normals.size() * 2);
+        parallelFor(0, static_cast<int>(normals.size()), [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                encodeNormal(normals[i], &encoded[static_cast<size_t>(i) * 2]);
+            }
+        }, 16384);
+    }
+
+    // Box filter onto a level of half the size; odd edges reuse the last row or column
+    void downsample(const std::vector<glm::vec3>& source, int sourceWidth, int sourceHeight,
+                    std::vector<glm::vec3>& target, int targetWidth, int targetHeight) {
+        target.resize(static_cast<size_t>(targetWidth) * targetHeight);
+        parallelFor(0, targetHeight, [&](int rowBegin, int rowEnd) {
+            for (int z = rowBegin; z < rowEnd; ++z) {
+                int z0 = std::min(z * 2, sourceHeight - 1);
+                int z1 = std::min(z * 2 + 1, sourceHeight - 1);
+                for (int x = 0; x < targetWidth; ++x) {
+                    int x0 = std::min(x * 2, sourceWidth - 1);
+                    int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+                    glm::vec3 sum = source[z0 * sourceWidth + x0] + source[z0 * sourceWidth + x1] +
+                        source[z1 * sourceWidth + x0] + source[z1 * sourceWidth + x1];
+                    float length = glm::length(sum);
+                    target[z * targetWidth + x] = length > 0.0f ? sum / length : glm::vec3(0.0f, 1.0f, 0.0f);
+                }
+            }
+        }, 16);
+    }
+}
+
+// Constructor
+TerrainNormalMap::TerrainNormalMap()
+    : texture(0), levelCount(0), maxTextureSize(0) {
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+}
+
+bool TerrainNormalMap::build(const float* heights, int gridWidth, int gridHeight, float spacing) {
+    if (!bake(heights, gridWidth, gridHeight, spacing)) {
+        cleanup();
+        return false;
+    }
+    upload();
+    return true;
+}
+
+bool TerrainNormalMap::bake(const float* heights, int gridWidth, int gridHeight, float spacing) {
+    levels.clear();
+    if (gridWidth > maxTextureSize || gridHeight > maxTextureSize) {
+        std::cerr << "ERROR: Height grid " << gridWidth << " x " << gridHeight
+            << " exceeds the maximum texture size " << maxTextureSize << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> level(static_cast<size_t>(gridWidth) * gridHeight);
+    computeGridNormals(heights, gridWidth, gridHeight, spacing, level.data());
+
+    std::vector<glm::vec3> nextLevel;
+    int width = gridWidth;
+    int height = gridHeight;
+    for (;;) {
+        levels.push_back(Level{ width, height, std::vector<GLshort>() });
+        encodeLevel(level, levels.back().texels);
+        if (width == 1 && height == 1) {
+            break;
+        }
+        int nextWidth = std::max(width / 2, 1);
+        int nextHeight = std::max(height / 2, 1);
+        downsample(level, width, height, nextLevel, nextWidth, nextHeight);
+        level.swap(nextLevel);
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    std::cout << "INFO: Baked terrain normal map " << gridWidth << " x " << gridHeight
+        << " (" << levels.size() << " levels)" << std::endl;
+    return true;
+}
+
+void TerrainNormalMap::upload() {
+    if (levels.empty()) {
+        return;
+    }
+    if (texture) glDeleteTextures(1, &texture);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    levelCount = static_cast<int>(levels.size());
+    for (int levelIndex = 0; levelIndex < levelCount; ++levelIndex) {
+        const Level& level = levels[levelIndex];
+        glTexImage2D(GL_TEXTURE_2D, levelIndex, GL_RG16_SNORM, level.width, level.height, 0, GL_RG, GL_SHORT, level.texels.data());
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkOpenGLError("TerrainNormalMap::upload");
+}
+
+// Each coarser level only changes over the parents of the texels changed below it. Coarser
+// texels are filtered from the stored (quantized) level instead of the float normals the bake
+// used, which differs by well under one unit of the 16-bit encoding.
+void TerrainNormalMap::update(const glm::vec3* normals, size_t rowStride, int x0, int z0, int width, int height) {
+    if (!texture || levels.empty()) {
+        return;
+    }
+    int x1 = std::min(x0 + width, levels[0].width);
+    int z1 = std::min(z0 + height, levels[0].height);
+    int firstX = std::max(x0, 0);
+    int firstZ = std::max(z0, 0);
+    if (firstX >= x1 || firstZ >= z1) {
+        return;
+    }
+
+    Level& base = levels[0];
+    for (int z = firstZ; z < z1; ++z) {
+        for (int x = firstX; x < x1; ++x) {
+            encodeNormal(normals[(z - z0) * rowStride + (x - x0)],
+                         &base.texels[(static_cast<size_t>(z) * base.width + x) * 2]);
+        }
+    }
+    x0 = firstX;
+    z0 = firstZ;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int levelIndex = 0; levelIndex < levelCount; ++levelIndex) {
+        Level& level = levels[levelIndex];
+        if (levelIndex > 0) {
+            // Box filter of the four children, clamped at odd edges like the bake
+            const Level& fine = levels[levelIndex - 1];
+            x0 >>= 1;
+            z0 >>= 1;
+            x1 = std::min(((x1 - 1) >> 1) + 1, level.width);
+            z1 = std::min(((z1 - 1) >> 1) + 1, level.height);
+            if (x0 >= x1 || z0 >= z1) {
+                break;
+            }
+            for (int z = z0; z < z1; ++z) {
+                int fz0 = std::min(z * 2, fine.height - 1);
+                int fz1 = std::min(z * 2 + 1, fine.height - 1);
+                for (int x = x0; x < x1; ++x) {
+                    int fx0 = std::min(x * 2, fine.width - 1);
+                    int fx1 = std::min(x * 2 + 1, fine.width - 1);
+                    glm::vec3 sum = decodeNormal(&fine.texels[(static_cast<size_t>(fz0) * fine.width + fx0) * 2]) +
+                        decodeNormal(&fine.texels[(static_cast<size_t>(fz0) * fine.width + fx1) * 2]) +
+                        decodeNormal(&fine.texels[(static_cast<size_t>(fz1) * fine.width + fx0) * 2]) +
+                        decodeNormal(&fine.texels[(static_cast<size_t>(fz1) * fine.width + fx1) * 2]);
+                    float length = glm::length(sum);
+                    encodeNormal(length > 0.0f ? sum / length : glm::vec3(0.0f, 1.0f, 0.0f),
+                                 &level.texels[(static_cast<size_t>(z) * level.width + x) * 2]);
+                }
+            }
+        }
+        // Upload the rectangle straight out of the level's rows
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, level.width);
+        glTexSubImage2D(GL_TEXTURE_2D, levelIndex, x0, z0, x1 - x0, z1 - z0, GL_RG, GL_SHORT,
+                        &level.texels[(static_cast<size_t>(z0) * level.width + x0) * 2]);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    checkOpenGLError("TerrainNormalMap::update");
+}
+
+// Cleanup
+void TerrainNormalMap::cleanup() {
+    if (texture) glDeleteTextures(1, &texture);
+    texture = 0;
+    levelCount = 0;
+    levels.clear();
+}
+
+// Getters
+GLuint TerrainNormalMap::getTexture() const { return texture; }
+bool TerrainNormalMap::isBuilt() const { return texture != 0; }
+bool TerrainNormalMap::isBaked() const { return !levels.empty(); }
+int TerrainNormalMap::getLevelCount() const { return levelCount; }
@@ -0,0 +1,35 @@
+#ifndef TERRAINNORMALS_H
+#define TERRAINNORMALS_H
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief Computes vertex normals of a regular height grid from central differences.
+ *
+ * Each normal is normalize(h[x-1] - h[x+1], 2 * spacing, h[z-1] - h[z+1]); samples outside
+ * the grid are clamped to the border, so edge normals use one-sided differences. Rows are
+ * split across worker threads and each row is processed four vertices at a time.
+ *
+ * Only the rectangle [x0, x1) x [z0, z1) is written, which lets edits refresh just the
+ * region they touched.
+ *
+ * @param heights Row-major height grid.
+ * @param gridWidth Number of samples along X.
+ * @param gridHeight Number of samples along Z.
+ * @param spacing World distance between neighbouring samples.
+ * @param normals Output array of gridWidth * gridHeight normals.
+ * @param x0 First column to update.
+ * @param z0 First row to update.
+ * @param x1 One past the last column to update.
+ * @param z1 One past the last row to update.
+ */
+void computeGridNormals(const float* heights, int gridWidth, int gridHeight, float spacing,
+                        glm::vec3* normals, int x0, int z0, int x1, int z1);
+
+/**
+ * @brief Computes the normals of the whole grid.
+ */
+void computeGridNormals(const float* heights, int gridWidth, int gridHeight, float spacing,
+                        glm::vec3* normals);
+
+#endif // TERRAINNORMALS_H
@@ -0,0 +1,311 @@
+#include "terrainRtin.h"
+#include "terrainIndices.h"
+#include "parallel.h"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+    /// Corners of one tree triangle; a-b is the hypotenuse, c the right angle.
+    struct RtinTriangle {
+        short ax, ay, bx, by, cx, cy;
+    };
+
+    // Triangle id 2 and 3 are the two halves of the tile; the children of id are 2 * id and
+    // 2 * id + 1. Stored so that children come after their parent.
+    std::vector<RtinTriangle> buildTriangleTable(int tileSize) {
+        int triangleCount = tileSize * tileSize * 2 - 2;
+        std::vector<RtinTriangle> table(triangleCount);
+        for (int i = 0; i < triangleCount; ++i) {
+            int id = i + 2;
+            int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+            if (id & 1) {
+                bx = by = cx = tileSize;
+            } else {
+                ax = ay = cy = tileSize;
+            }
+            // Walk down from the root, one bit of the id per level
+            while ((id >>= 1) > 1) {
+                int mx = (ax + bx) >> 1;
+                int my = (ay + by) >> 1;
+                if (id & 1) {
+                    bx = ax; by = ay;
+                    ax = cx; ay = cy;
+                } else {
+                    ax = bx; ay = by;
+                    bx = cx; by = cy;
+                }
+                cx = mx; cy = my;
+            }
+            table[i] = { static_cast<short>(ax), static_cast<short>(ay), static_cast<short>(bx),
+                         static_cast<short>(by), static_cast<short>(cx), static_cast<short>(cy) };
+        }
+        return table;
+    }
+
+    // Largest vertical distance between the triangle's plane and the samples it covers
+    float triangleError(const RtinTriangle& t, const float* heights, size_t rowStride) {
+        const float ha = heights[t.ay * rowStride + t.ax];
+        const float hb = heights[t.by * rowStride + t.bx];
+        const float hc = heights[t.cy * rowStride + t.cx];
+        const int area = (t.bx - t.ax) * (t.cy - t.ay) - (t.by - t.ay) * (t.cx - t.ax);
+        const float inverseArea = 1.0f / area;
+        const int minX = std::min({ t.ax, t.bx, t.cx }), maxX = std::max({ t.ax, t.bx, t.cx });
+        const int minY = std::min({ t.ay, t.by, t.cy }), maxY = std::max({ t.ay, t.by, t.cy });
+
+        float maxError = 0.0f;
+        for (int y = minY; y <= maxY; ++y) {
+            for (int x = minX; x <= maxX; ++x) {
+                // Twice the signed areas opposite a, b and c
+                int wa = (t.bx - x) * (t.cy - y) - (t.by - y) * (t.cx - x);
+                int wb = (t.cx - x) * (t.ay - y) - (t.cy - y) * (t.ax - x);
+                int wc = area - wa - wb;
+                if (area > 0 ? (wa < 0 || wb < 0 || wc < 0) : (wa > 0 || wb > 0 || wc > 0)) {
+                    continue;
+                }
+                float interpolated = (wa * ha + wb * hb + wc * hc) * inverseArea;
+                maxError = std::max(maxError, std::fabs(interpolated - heights[y * rowStride + x]));
+            }
+        }
+        return maxError;
+    }
+
+    // Error of every triangle, stored at its hypotenuse midpoint, and raised to the errors of
+    // its subtree; with heights null only the subtree step runs. The midpoint is shared by the
+    // two triangles on either side of the hypotenuse, so it holds the larger of their errors.
+    // Children are visited before their parents.
+    void propagateTileErrors(const std::vector<RtinTriangle>& table, int tileSize, const float* heights,
+                             size_t rowStride, float* errors) {
+        const int size = tileSize + 1;
+        const int parentCount = static_cast<int>(table.size()) - tileSize * tileSize;
+        for (int i = static_cast<int>(table.size()) - 1; i >= 0; --i) {
+            const RtinTriangle& t = table[i];
+            int mx = (t.ax + t.bx) >> 1;
+            int my = (t.ay + t.by) >> 1;
+            float& error = errors[my * size + mx];
+            if (heights) {
+                error = std::max(error, triangleError(t, heights, rowStride));
+            }
+            if (i < parentCount) {
+                float left = errors[((t.ay + t.cy) >> 1) * size + ((t.ax + t.cx) >> 1)];
+                float right = errors[((t.by + t.cy) >> 1) * size + ((t.bx + t.cx) >> 1)];
+                error = std::max(error, std::max(left, right));
+            }
+        }
+    }
+
+    // Raises both copies of a shared border vertex to the larger error
+    bool mergeBorderError(float& a, float& b) {
+        if (a == b) {
+            return false;
+        }
+        a = b = std::max(a, b);
+        return true;
+    }
+
+    // Merges the borders of every tile pair that involves an active tile and re-propagates the
+    // tiles that changed, until no border changes. Each tile merges its right and bottom
+    // borders, so no vertex is touched by two ranges; corners are always part of the mesh and
+    // are skipped. Tiles whose errors changed are flagged in touched. Returns the pass count.
+    int settleBorders(const std::vector<RtinTriangle>& table, int tilesX, int tilesZ, int tileSize,
+                      float* errors, std::vector<unsigned char>& active, std::vector<unsigned char>& touched) {
+        const int vertexSize = tileSize + 1;
+        const int tileCount = tilesX * tilesZ;
+        const size_t tileStride = static_cast<size_t>(vertexSize) * vertexSize;
+        std::vector<unsigned char> rightChanged(tileCount), belowChanged(tileCount);
+        int passes = 0;
+        for (;;) {
+            parallelFor(0, tileCount, [&](int begin, int end) {
+                for (int tile = begin; tile < end; ++tile) {
+                    float* own = errors + tile * tileStride;
+                    rightChanged[tile] = belowChanged[tile] = 0;
+                    if (tile % tilesX < tilesX - 1 && (active[tile] || active[tile + 1])) {
+                        float* right = own + tileStride;
+                        for (int y = 1; y < tileSize; ++y) {
+                            rightChanged[tile] |= mergeBorderError(own[y * vertexSize + tileSize], right[y * vertexSize]);
+                        }
+                    }
+                    if (tile / tilesX < tilesZ - 1 && (active[tile] || active[tile + tilesX])) {
+                        float* below = own + tilesX * tileStride;
+                        for (int x = 1; x < tileSize; ++x) {
+                            belowChanged[tile] |= mergeBorderError(own[tileSize * vertexSize + x], below[x]);
+                        }
+                    }
+                }
+            }, 16);
+
+            bool changed = false;
+            for (int tile = 0; tile < tileCount; ++tile) {
+                active[tile] = rightChanged[tile] || belowChanged[tile] ||
+                    (tile % tilesX > 0 && rightChanged[tile - 1]) ||
+                    (tile >= tilesX && belowChanged[tile - tilesX]);
+                touched[tile] |= active[tile];
+                changed |= active[tile] != 0;
+            }
+            if (!changed) {
+                return passes;
+            }
+            ++passes;
+            parallelFor(0, tileCount, [&](int begin, int end) {
+                for (int tile = begin; tile < end; ++tile) {
+                    if (active[tile]) {
+                        propagateTileErrors(table, tileSize, nullptr, 0, errors + tile * tileStride);
+                    }
+                }
+            }, 4);
+        }
+    }
+
+    // Splits a triangle while the error at its hypotenuse midpoint is above maxError
+    template <typename Emit>
+    void processTriangle(const float* errors, int size, float maxError, int ax, int ay, int bx, int by, int cx, int cy, Emit& emit) {
+        int mx = (ax + bx) >> 1;
+        int my = (ay + by) >> 1;
+        if (std::abs(ax - cx) + std::abs(ay - cy) > 1 && errors[my * size + mx] > maxError) {
+            processTriangle(errors, size, maxError, cx, cy, ax, ay, mx, my, emit);
+            processTriangle(errors, size, maxError, bx, by, cx, cy, mx, my, emit);
+        } else {
+            emit(ax, ay, bx, by, cx, cy);
+        }
+    }
+
+    template <typename Emit>
+    void processTile(const float* errors, int tileSize, float maxError, Emit& emit) {
+        processTriangle(errors, tileSize + 1, maxError, 0, 0, tileSize, tileSize, tileSize, 0, emit);
+        processTriangle(errors, tileSize + 1, maxError, tileSize, tileSize, 0, 0, 0, tileSize, emit);
+    }
+}
+
+// Constructor
+TerrainRtin::TerrainRtin()
+    : tilesX(0), tilesZ(0), tileSize(0) {}
+
+bool TerrainRtin::build(const float* heights, int tilesCountX, int tilesCountZ, int size) {
+    if (size < 2 || size > 128 || (size & (size - 1)) != 0 || tilesCountX <= 0 || tilesCountZ <= 0) {
+        std::cerr << "ERROR: Invalid RTIN tiling (" << tilesCountX << " x " << tilesCountZ
+            << " tiles of " << size << " cells)" << std::endl;
+        return false;
+    }
+    tilesX = tilesCountX;
+    tilesZ = tilesCountZ;
+    tileSize = size;
+    const int vertexSize = tileSize + 1;
+    const size_t gridWidth = static_cast<size_t>(tilesX) * tileSize + 1;
+    const int tileCount = tilesX * tilesZ;
+    errors.assign(static_cast<size_t>(tileCount) * vertexSize * vertexSize, 0.0f);
+
+    const std::vector<RtinTriangle> table = buildTriangleTable(tileSize);
+    parallelFor(0, tileCount, [&](int begin, int end) {
+        for (int tile = begin; tile < end; ++tile) {
+            const float* tileHeights = heights + static_cast<size_t>(tile / tilesX) * tileSize * gridWidth +
+                static_cast<size_t>(tile % tilesX) * tileSize;
+            propagateTileErrors(table, tileSize, tileHeights, gridWidth, tileErrors(tile));
+        }
+    }, 4);
+
+    std::vector<unsigned char> active(tileCount, 1), touched(tileCount, 0);
+    int passes = settleBorders(table, tilesX, tilesZ, tileSize, errors.data(), active, touched);
+
+    std::cout << "INFO: RTIN errors for " << tilesX << " x " << tilesZ << " tiles of " << tileSize
+        << " cells (" << passes << " border passes)" << std::endl;
+    return true;
+}
+
+// The rebuilt tiles start from zero so errors of the old heights do not linger; their
+// neighbours still hold border errors merged from them, which only over-refines.
+void TerrainRtin::update(const float* heights, size_t rowStride, int tileX0, int tileZ0, int tileX1, int tileZ1,
+                         std::vector<int>& changedTiles) {
+    changedTiles.clear();
+    tileX0 = std::max(tileX0, 0);
+    tileZ0 = std::max(tileZ0, 0);
+    tileX1 = std::min(tileX1, tilesX);
+    tileZ1 = std::min(tileZ1, tilesZ);
+    if (errors.empty() || tileX0 >= tileX1 || tileZ0 >= tileZ1) {
+        return;
+    }
+    const int vertexSize = tileSize + 1;
+    const int columns = tileX1 - tileX0;
+    const int tileCount = tilesX * tilesZ;
+    std::vector<unsigned char> active(tileCount, 0), touched(tileCount, 0);
+
+    const std::vector<RtinTriangle> table = buildTriangleTable(tileSize);
+    parallelFor(0, columns * (tileZ1 - tileZ0), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            int x = i % columns, z = i / columns;
+            int tile = (tileZ0 + z) * tilesX + tileX0 + x;
+            float* tileErrorGrid = tileErrors(tile);
+            std::fill(tileErrorGrid, tileErrorGrid + vertexSize * vertexSize, 0.0f);
+            propagateTileErrors(table, tileSize, heights + static_cast<size_t>(z) * tileSize * rowStride + x * tileSize,
+                                rowStride, tileErrorGrid);
+            active[tile] = touched[tile] = 1;
+        }
+    }, 1);
+
+    settleBorders(table, tilesX, tilesZ, tileSize, errors.data(), active, touched);
+    for (int tile = 0; tile < tileCount; ++tile) {
+        if (touched[tile]) {
+            changedTiles.push_back(tile);
+        }
+    }
+}
+
+void TerrainRtin::clear() {
+    errors.clear();
+    errors.shrink_to_fit();
+    tilesX = tilesZ = tileSize = 0;
+}
+
+size_t TerrainRtin::extract(float maxError, std::vector<GLushort>& indices, std::vector<TerrainRtinRange>& ranges) const {
+    const int tileCount = tilesX * tilesZ;
+    std::vector<std::vector<GLushort>> tileIndices(tileCount);
+    parallelFor(0, tileCount, [&](int begin, int end) {
+        for (int tile = begin; tile < end; ++tile) {
+            extractTile(tile, maxError, tileIndices[tile]);
+        }
+    }, 4);
+
+    indices.clear();
+    ranges.resize(tileCount);
+    for (int tile = 0; tile < tileCount; ++tile) {
+        ranges[tile].indexOffset = indices.size();
+        ranges[tile].indexCount = static_cast<GLsizei>(tileIndices[tile].size());
+        indices.insert(indices.end(), tileIndices[tile].begin(), tileIndices[tile].end());
+    }
+    return indices.size() / 3;
+}
+
+void TerrainRtin::extractTile(int tile, float maxError, std::vector<GLushort>& indices) const {
+    const int vertexSize = tileSize + 1;
+    std::vector<GLuint> triangles;
+    // Same winding as the regular grid (normal pointing up)
+    auto emit = [&](int ax, int ay, int bx, int by, int cx, int cy) {
+        if ((by - ay) * (cx - ax) - (bx - ax) * (cy - ay) < 0) {
+            std::swap(bx, cx);
+            std::swap(by, cy);
+        }
+        triangles.push_back(static_cast<GLuint>(ay * vertexSize + ax));
+        triangles.push_back(static_cast<GLuint>(by * vertexSize + bx));
+        triangles.push_back(static_cast<GLuint>(cy * vertexSize + cx));
+    };
+    processTile(tileErrors(tile), tileSize, maxError, emit);
+    optimizeVertexCache(triangles.data(), triangles.size());
+    indices.assign(triangles.begin(), triangles.end());
+}
+
+size_t TerrainRtin::countTriangles(float maxError) const {
+    std::atomic<size_t> total(0);
+    parallelFor(0, tilesX * tilesZ, [&](int begin, int end) {
+        size_t count = 0;
+        auto emit = [&](int, int, int, int, int, int) { ++count; };
+        for (int tile = begin; tile < end; ++tile) {
+            processTile(tileErrors(tile), tileSize, maxError, emit);
+        }
+        total += count;
+    }, 16);
+    return total;
+}
+
+// Getters
+bool TerrainRtin::isBuilt() const { return !errors.empty(); }
+int TerrainRtin::getTileSize() const { return tileSize; }
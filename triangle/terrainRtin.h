@@ -0,0 +1,104 @@
+#ifndef TERRAINRTIN_H
+#define TERRAINRTIN_H
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+/**
+ * @struct TerrainRtinRange
+ * @brief Location of one tile's triangles inside the index list built by TerrainRtin::extract.
+ */
+struct TerrainRtinRange {
+    size_t indexOffset;      ///< Offset of the first index.
+    GLsizei indexCount;      ///< Number of indices (three per triangle).
+};
+
+/**
+ * @class TerrainRtin
+ * @brief Right-triangulated irregular network over a grid split into square tiles.
+ *
+ * Every tile of tileSize (a power of two) cells is a binary tree of right triangles, split
+ * while the plane of a triangle is further than the maximum error from a height sample it
+ * covers, so the bound holds at every sample. The errors are computed once, tiles in
+ * parallel, and propagated up the tree so any maximum error yields a conforming mesh. Vertices on a tile border take the larger error of
+ * the two tiles sharing them, re-propagated until stable, so neighbouring tiles always pick
+ * the same border vertices and the mesh has no cracks. Extracting a mesh for a given error
+ * is a cheap traversal and can be repeated without rebuilding.
+ */
+class TerrainRtin {
+public:
+    /**
+     * @brief Constructor.
+     */
+    TerrainRtin();
+
+    /**
+     * @brief Computes the vertex errors of every tile.
+     * @param heights Row-major height grid of (tilesX * tileSize + 1) x (tilesZ * tileSize + 1) samples.
+     * @param tilesX Number of tiles along X.
+     * @param tilesZ Number of tiles along Z.
+     * @param tileSize Cells per tile side, a power of two no larger than 128.
+     * @return True if successful, false otherwise.
+     */
+    bool build(const float* heights, int tilesX, int tilesZ, int tileSize);
+
+    /**
+     * @brief Recomputes the errors of a block of tiles after their heights changed and
+     *        re-merges the borders they share. Include a ring of unchanged tiles around an
+     *        edit so border errors merged from the old heights are recomputed too.
+     * @param heights Heights of the block, starting at the first sample of tile (tileX0, tileZ0).
+     * @param rowStride Distance between rows of heights, in samples.
+     * @param tileX0 First tile column.
+     * @param tileZ0 First tile row.
+     * @param tileX1 One past the last tile column.
+     * @param tileZ1 One past the last tile row.
+     * @param changedTiles Receives every tile whose errors may have changed, in row-major order.
+     */
+    void update(const float* heights, size_t rowStride, int tileX0, int tileZ0, int tileX1, int tileZ1,
+                std::vector<int>& changedTiles);
+
+    /**
+     * @brief Releases the error grids.
+     */
+    void clear();
+
+    /**
+     * @brief Builds the triangles of every tile for a maximum vertical error. Indices address
+     *        a tile's (tileSize + 1)^2 samples in row order and are cache-optimized per tile.
+     * @param maxError Largest allowed distance between the mesh and a height sample.
+     * @param indices Receives the triangle lists of all tiles back to back.
+     * @param ranges Receives one range per tile, in row-major tile order.
+     * @return Number of triangles.
+     */
+    size_t extract(float maxError, std::vector<GLushort>& indices, std::vector<TerrainRtinRange>& ranges) const;
+
+    /**
+     * @brief Builds the triangles of one tile, as extract() does for every tile.
+     * @param tile Tile index in row-major order.
+     * @param maxError Largest allowed vertical error.
+     * @param indices Replaced with the tile's triangle list.
+     */
+    void extractTile(int tile, float maxError, std::vector<GLushort>& indices) const;
+
+    /**
+     * @brief Counts the triangles extract() would produce, without building them.
+     * @param maxError Largest allowed vertical error.
+     * @return Number of triangles.
+     */
+    size_t countTriangles(float maxError) const;
+
+    // Getters
+    bool isBuilt() const;
+    int getTileSize() const;
+
+private:
+    int tilesX, tilesZ;
+    int tileSize;
+    std::vector<float> errors;   ///< (tileSize + 1)^2 vertex errors per tile, tiles in row-major order.
+
+    const float* tileErrors(int tile) const { return &errors[static_cast<size_t>(tile) * (tileSize + 1) * (tileSize + 1)]; }
+    float* tileErrors(int tile) { return &errors[static_cast<size_t>(tile) * (tileSize + 1) * (tileSize + 1)]; }
+};
+
+#endif // TERRAINRTIN_H
@@ -0,0 +1,56 @@
+#ifndef TERRAINSETTINGS_H
+#define TERRAINSETTINGS_H
+
+#include <string>
+#include "heightMips.h"
+
+/**
+ * @struct TerrainSettings
+ * @brief Load settings that can be tuned per deployment without rebuilding.
+ *
+ * Read from a "key = value" file ('#' starts a comment) next to the heightmap, or from the
+ * file named by TERRAIN_CONFIG, then overridden by environment variables:
+ *
+ *     sample_step = 2      # TERRAIN_SAMPLE_STEP: heightmap pixels between grid vertices
+ *     filter = lanczos     # TERRAIN_FILTER: point, box or lanczos
+ *
+ * Settings that appear nowhere keep the values set in code.
+ */
+struct TerrainSettings {
+    int sampleStep = 0;                     ///< Heightmap pixels between grid vertices, 0 if unset.
+    bool hasFilter = false;                 ///< True if filter was set.
+    HeightFilter filter = HeightFilter::Box;
+
+    /**
+     * @brief Reads the settings for a heightmap from its file and the environment.
+     * @param heightmapPath Path to the heightmap image.
+     * @return Settings found; a missing file is not an error.
+     */
+    static TerrainSettings load(const std::string& heightmapPath);
+
+    /**
+     * @brief Path of the settings file read for a heightmap (heightmap path + ".cfg").
+     */
+    static std::string settingsPathFor(const std::string& heightmapPath);
+
+    /**
+     * @brief Reads settings from a file. Malformed lines and unknown keys are reported and skipped.
+     * @param path Settings file.
+     * @return False if the file could not be opened.
+     */
+    bool loadFile(const std::string& path);
+
+    /**
+     * @brief Applies TERRAIN_SAMPLE_STEP and TERRAIN_FILTER if they are set.
+     */
+    void applyEnvironment();
+
+private:
+    /**
+     * @brief Applies one setting.
+     * @return False if the key or value is not recognized.
+     */
+    bool set(const std::string& key, const std::string& value);
+};
+
+#endif // TERRAINSETTINGS_H
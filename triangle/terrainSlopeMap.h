@@ -0,0 +1,95 @@
+#ifndef TERRAINSLOPEMAP_H
+#define TERRAINSLOPEMAP_H
+
+#include <cstddef>
+#include <vector>
+#include "heightField.h"
+
+/**
+ * @class TerrainSlopeMap
+ * @brief Slope and aspect of every sample of a height grid, precomputed for ground queries.
+ *
+ * Both rasters come from central differences of the heights (one-sided on the border), the
+ * same gradient the vertex normals use. They are computed four samples at a time with rows
+ * split across threads, arctangents included, so a query is a single lookup of the nearest
+ * sample. Slope is the angle from horizontal in degrees. Aspect is the downhill direction in
+ * degrees, measured in the XZ plane from +X towards +Z in [0, 360), and 0 on flat ground.
+ */
+class TerrainSlopeMap {
+public:
+    /**
+     * @brief Constructor. Creates an empty map.
+     */
+    TerrainSlopeMap();
+
+    /**
+     * @brief Computes both rasters, replacing any previous ones.
+     * @param heights Row-major height grid in world units.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     */
+    void build(const float* heights, int gridWidth, int gridHeight, float spacing);
+
+    /**
+     * @brief Recomputes the samples whose gradient an edit changed.
+     * @param heights Height grid after the edit, with the dimensions and spacing of the build.
+     * @param x0 First edited column.
+     * @param z0 First edited row.
+     * @param x1 One past the last edited column.
+     * @param z1 One past the last edited row.
+     */
+    void update(const HeightField& heights, int x0, int z0, int x1, int z1);
+
+    /**
+     * @brief Releases both rasters.
+     */
+    void clear();
+
+    /**
+     * @brief Slope and aspect of the sample nearest to a position.
+     * @param x World X-coordinate.
+     * @param z World Z-coordinate.
+     * @param aspect Optional; receives the aspect in degrees.
+     * @return Slope in degrees, or 0 (with aspect 0) outside the grid.
+     */
+    float sample(float x, float z, float* aspect = nullptr) const;
+
+    /**
+     * @brief Batched sample, vectorized and split across threads for large batches.
+     * @param xs World X-coordinates.
+     * @param zs World Z-coordinates.
+     * @param count Number of positions.
+     * @param outSlopes Receives count slopes in degrees.
+     * @param outAspects Optional; receives count aspects in degrees.
+     */
+    void sample(const float* xs, const float* zs, size_t count, float* outSlopes, float* outAspects = nullptr) const;
+
+    // Getters
+    bool isBuilt() const;
+    int getWidth() const;
+    int getHeight() const;
+
+private:
+    std::vector<float> slopes;    ///< Slope per sample in degrees, row-major.
+    std::vector<float> aspects;   ///< Aspect per sample in degrees, row-major.
+    int gridWidth, gridHeight;    ///< Dimensions of the grid.
+    float spacing;                ///< World distance between samples.
+
+    /**
+     * @brief Computes a rectangle of both rasters from a window of heights that holds the
+     *        rectangle and its direct neighbours inside the grid.
+     * @param window Row-major heights of the window.
+     * @param windowX0 Grid column of the first window column.
+     * @param windowZ0 Grid row of the first window row.
+     * @param windowColumns Number of window columns.
+     * @param x0 First column to compute.
+     * @param z0 First row to compute.
+     * @param x1 One past the last column to compute.
+     * @param z1 One past the last row to compute.
+     */
+    void computeRegion(const float* window, int windowX0, int windowZ0, int windowColumns,
+                       int x0, int z0, int x1, int z1);
+};
+
+#endif // TERRAINSLOPEMAP_H
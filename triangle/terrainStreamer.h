@@ -0,0 +1,187 @@
+#ifndef TERRAINSTREAMER_H
+#define TERRAINSTREAMER_H
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "frustum.h"
+#include "terrainTiles.h"
+#include "vertexArena.h"
+
+/**
+ * @class TerrainStreamer
+ * @brief Pages terrain tiles in and out around the camera.
+ *
+ * Background workers read and decode tiles from a TerrainTileFile and build their vertex
+ * data. Every tile owns a slot of one VertexArena; when the arena is persistently mapped the
+ * workers write vertices straight into it and the render thread only publishes finished
+ * tiles, otherwise it copies a few per frame. The least recently used tiles are evicted once
+ * more than the resident limit are loaded. All tiles share one 16-bit index buffer and one
+ * vertex array. Only the GL calls and the tile table are touched on the render thread.
+ */
+class TerrainStreamer {
+public:
+    /**
+     * @brief Constructor.
+     */
+    TerrainStreamer();
+
+    /**
+     * @brief Destructor. Stops the workers; GL resources must be released with close() first.
+     */
+    ~TerrainStreamer();
+
+    TerrainStreamer(const TerrainStreamer&) = delete;
+    TerrainStreamer& operator=(const TerrainStreamer&) = delete;
+
+    /**
+     * @brief Opens a tile file and starts the worker threads.
+     * @param tilePath Path to the tile file.
+     * @param sourcePath Heightmap the tile file must be up to date with, or empty to skip the check.
+     * @param heightScale Height scale the tile file must have been built with.
+     * @param spacing World distance between neighbouring samples.
+     * @return True if successful, false otherwise.
+     */
+    bool open(const std::string& tilePath, const std::string& sourcePath, float heightScale, float spacing);
+
+    /**
+     * @brief Stops the workers and releases every tile and GL resource.
+     */
+    void close();
+
+    /**
+     * @brief Requests the tiles around the camera, uploads finished ones and evicts old ones.
+     *        Call once per frame on the render thread.
+     * @param localCamera Camera position in terrain (model) space.
+     */
+    void update(const glm::vec3& localCamera);
+
+    /**
+     * @brief Draws the resident tiles inside the frustum and fences the frame. The shader
+     *        must already be in use with the model, view, projection and lighting uniforms set.
+     */
+    void render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection);
+
+    /**
+     * @brief Bilinear height and gradient at a position. Tiles that are not resident are read
+     *        synchronously and kept in the cache.
+     * @param x X-coordinate in terrain space.
+     * @param z Z-coordinate in terrain space.
+     * @param gradient Optional; receives (dh/dx, dh/dz).
+     * @return Height, or 0 outside the terrain.
+     */
+    float sampleHeight(float x, float z, glm::vec2* gradient = nullptr);
+
+    /**
+     * @brief Sets the distance around the camera within which tiles are requested.
+     */
+    void setStreamingRadius(float radius);
+
+    /**
+     * @brief Sets how many tiles may stay resident before the least recently used are evicted.
+     *        The vertex arena is sized from it, so it takes effect on the next open().
+     */
+    void setMaxResidentTiles(size_t count);
+
+    /**
+     * @brief Sets how many finished tiles are made drawable per update, to bound frame hitches.
+     */
+    void setUploadsPerFrame(int count);
+
+    // Getters
+    bool isOpen() const;
+    const TerrainTileFile& getTileFile() const;
+    size_t getResidentTileCount() const;
+    size_t getPendingTileCount() const;
+    size_t getVisibleTileCount() const;
+    size_t getDrawnTriangleCount() const;
+
+private:
+    /// Tile the workers should build, with the arena slot reserved for its vertices.
+    struct TileRequest {
+        int64_t key;
+        int slot;
+    };
+
+    /// Tile built by a worker, waiting for upload.
+    struct LoadedTile {
+        int64_t key;
+        int slot;                        ///< Arena slot, or -1 for a height-only load.
+        std::vector<float> heights;      ///< (tileSize + 1)^2 heights without the apron.
+        std::vector<float> vertexData;   ///< Interleaved positions and normals, unless written to the slot.
+        glm::vec3 boundsMin, boundsMax;
+        bool valid;
+    };
+
+    /// Tile in the cache. It is drawable once it owns an arena slot.
+    struct Tile {
+        std::vector<float> heights;
+        glm::vec3 boundsMin, boundsMax;
+        int slot;                        ///< Arena slot holding its vertices, or -1.
+        uint64_t lastUsed;               ///< Update count when the tile was last wanted or queried.
+    };
+
+    TerrainTileFile tileFile;
+    float spacing;
+    float streamingRadius;
+    size_t maxResidentTiles;
+    int uploadsPerFrame;
+    uint64_t frameIndex;
+
+    std::unordered_map<int64_t, Tile> tiles;      ///< Resident tiles by key.
+    GLuint indexBuffer;                           ///< Shared 16-bit tile index list.
+    GLsizei indexCount;
+    VertexArena arena;                            ///< One vertex slot per tile.
+    GLuint vao;                                   ///< Arena and index buffer; tiles differ by base vertex.
+    GLint tileVertexCount;                        ///< (tileSize + 1)^2.
+
+    // Shared with the workers; guarded by queueMutex
+    std::vector<std::thread> workers;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<TileRequest> requests;             ///< Wanted tiles, nearest first.
+    std::unordered_set<int64_t> inFlight;         ///< Requested or being built.
+    std::vector<LoadedTile> completed;            ///< Built tiles waiting for upload.
+    bool stopping;
+
+    Frustum frustum;
+    size_t visibleTiles;
+    size_t drawnTriangles;
+
+    static int64_t makeKey(int tileX, int tileZ) { return (static_cast<int64_t>(tileZ) << 32) | static_cast<uint32_t>(tileX); }
+
+    /**
+     * @brief Worker loop: takes requests and builds tiles until stopping is set.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Reads a tile and builds its heights and bounds, and its vertex data if
+     *        loaded.slot is set, into the slot's mapping when there is one.
+     */
+    void buildTile(LoadedTile& loaded) const;
+
+    /**
+     * @brief Makes a built tile drawable and adds it to the cache.
+     */
+    void uploadTile(LoadedTile& loaded);
+
+    /**
+     * @brief Returns a tile's arena slot once the GPU is done with it.
+     */
+    void releaseTile(Tile& tile);
+
+    /**
+     * @brief Evicts least recently used tiles beyond the resident limit.
+     */
+    void evictTiles();
+};
+
+#endif // TERRAINSTREAMER_H
@@ -0,0 +1,226 @@
+#include "terrainTiles.h"
+#include "stb_image.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <cstdio>
+#include <sys/stat.h>
+
+namespace {
+    const char tileMagic[8] = { 'T', 'R', 'N', 'T', 'I', 'L', 'E', 'S' };
+
+    bool statFile(const std::string& path, uint64_t& size, int64_t& modified) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        size = static_cast<uint64_t>(info.st_size);
+        modified = static_cast<int64_t>(info.st_mtime);
+        return true;
+    }
+
+    size_t tileSampleCount(int tileSize) {
+        return static_cast<size_t>(tileSize + 3) * (tileSize + 3);
+    }
+}
+
+// Constructor
+TerrainTileFile::TerrainTileFile() : opened(false) {
+    std::memset(&header, 0, sizeof(header));
+}
+
+std::string TerrainTileFile::tilePathFor(const std::string& sourcePath) {
+    return sourcePath + ".tiles";
+}
+
+// The image is decoded in one piece here; only the runtime side streams.
+bool TerrainTileFile::build(const std::string& sourcePath, const std::string& tilePath, int tileSize, float heightScale) {
+    int width, height, channels;
+    bool is16Bit = stbi_is_16_bit(sourcePath.c_str()) != 0;
+    void* pixels = is16Bit
+        ? static_cast<void*>(stbi_load_16(sourcePath.c_str(), &width, &height, &channels, STBI_grey))
+        : static_cast<void*>(stbi_load(sourcePath.c_str(), &width, &height, &channels, STBI_grey));
+    if (!pixels) {
+        std::cerr << "ERROR: Failed to load heightmap from: " << sourcePath << std::endl;
+        return false;
+    }
+
+    TerrainTileHeader fileHeader;
+    std::memset(&fileHeader, 0, sizeof(fileHeader));
+    std::memcpy(fileHeader.magic, tileMagic, sizeof(tileMagic));
+    fileHeader.version = TERRAIN_TILES_VERSION;
+    fileHeader.headerSize = sizeof(TerrainTileHeader);
+    fileHeader.heightScale = heightScale;
+    fileHeader.tileSize = tileSize;
+    // Like the chunked mesh, the grid is cropped to whole tiles
+    fileHeader.tilesX = (width - 1) / tileSize;
+    fileHeader.tilesZ = (height - 1) / tileSize;
+    fileHeader.imageWidth = width;
+    fileHeader.imageHeight = height;
+    if (fileHeader.tilesX < 1 || fileHeader.tilesZ < 1 ||
+        !statFile(sourcePath, fileHeader.sourceSize, fileHeader.sourceModified)) {
+        std::cerr << "ERROR: Heightmap too small for " << tileSize << " cell terrain tiles: " << sourcePath << std::endl;
+        stbi_image_free(pixels);
+        return false;
+    }
+
+    const int gridWidth = fileHeader.tilesX * tileSize + 1;
+    const int gridHeight = fileHeader.tilesZ * tileSize + 1;
+    auto heightAt = [&](int x, int z) {
+        x = std::clamp(x, 0, gridWidth - 1);
+        z = std::clamp(z, 0, gridHeight - 1);
+        size_t index = static_cast<size_t>(z) * width + x;
+        float sample = is16Bit ? static_cast<stbi_us*>(pixels)[index] / 65535.0f
+                               : static_cast<unsigned char*>(pixels)[index] / 255.0f;
+        return sample * heightScale * 3.0f;  // Same amplification as Terrain
+    };
+
+    const int tileCount = fileHeader.tilesX * fileHeader.tilesZ;
+    std::vector<float> bounds(tileCount * 2);
+    fileHeader.minHeight = std::numeric_limits<float>::max();
+    fileHeader.maxHeight = std::numeric_limits<float>::lowest();
+    for (int tz = 0; tz < fileHeader.tilesZ; ++tz) {
+        for (int tx = 0; tx < fileHeader.tilesX; ++tx) {
+            float tileMin = std::numeric_limits<float>::max();
+            float tileMax = std::numeric_limits<float>::lowest();
+            for (int z = tz * tileSize; z <= (tz + 1) * tileSize; ++z) {
+                for (int x = tx * tileSize; x <= (tx + 1) * tileSize; ++x) {
+                    float h = heightAt(x, z);
+                    tileMin = std::min(tileMin, h);
+                    tileMax = std::max(tileMax, h);
+                }
+            }
+            bounds[(tz * fileHeader.tilesX + tx) * 2] = tileMin;
+            bounds[(tz * fileHeader.tilesX + tx) * 2 + 1] = tileMax;
+            fileHeader.minHeight = std::min(fileHeader.minHeight, tileMin);
+            fileHeader.maxHeight = std::max(fileHeader.maxHeight, tileMax);
+        }
+    }
+    fileHeader.boundsOffset = sizeof(TerrainTileHeader);
+    fileHeader.tileOffset = fileHeader.boundsOffset + bounds.size() * sizeof(float);
+
+    std::string temporaryPath = tilePath + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to create terrain tile file: " << temporaryPath << std::endl;
+        stbi_image_free(pixels);
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(reinterpret_cast<const char*>(bounds.data()), bounds.size() * sizeof(float));
+
+    float range = std::max(fileHeader.maxHeight - fileHeader.minHeight, 1e-6f);
+    std::vector<uint16_t> tile(tileSampleCount(tileSize));
+    for (int tz = 0; tz < fileHeader.tilesZ; ++tz) {
+        for (int tx = 0; tx < fileHeader.tilesX; ++tx) {
+            uint16_t* out = tile.data();
+            for (int z = tz * tileSize - 1; z <= (tz + 1) * tileSize + 1; ++z) {
+                for (int x = tx * tileSize - 1; x <= (tx + 1) * tileSize + 1; ++x) {
+                    float normalized = (heightAt(x, z) - fileHeader.minHeight) / range;
+                    *out++ = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+                }
+            }
+            file.write(reinterpret_cast<const char*>(tile.data()), tile.size() * sizeof(uint16_t));
+        }
+    }
+    stbi_image_free(pixels);
+    file.close();
+
+    if (!file) {
+        std::cerr << "ERROR: Failed to write terrain tile file: " << temporaryPath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    // Renamed straight over the old tiles; only Windows needs them removed first
+    if (std::rename(temporaryPath.c_str(), tilePath.c_str()) != 0
+        && (std::remove(tilePath.c_str()) != 0 || std::rename(temporaryPath.c_str(), tilePath.c_str()) != 0)) {
+        std::cerr << "ERROR: Failed to replace terrain tile file: " << tilePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    std::cout << "INFO: Terrain split into " << tileCount << " tiles of " << tileSize << " cells: " << tilePath << std::endl;
+    return true;
+}
+
+bool TerrainTileFile::open(const std::string& tilePath, const std::string& sourcePath, float heightScale) {
+    opened = false;
+    std::ifstream file(tilePath, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, tileMagic, sizeof(tileMagic)) != 0 ||
+        header.version != TERRAIN_TILES_VERSION || header.headerSize != sizeof(TerrainTileHeader) ||
+        header.tileSize < 1 || header.tilesX < 1 || header.tilesZ < 1) {
+        std::cout << "INFO: Ignoring terrain tile file with unknown format: " << tilePath << std::endl;
+        return false;
+    }
+    if (header.heightScale != heightScale) {
+        std::cout << "INFO: Terrain tile file was built with a different height scale: " << tilePath << std::endl;
+        return false;
+    }
+    if (!sourcePath.empty()) {
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        if (!statFile(sourcePath, sourceSize, sourceModified) ||
+            sourceSize != header.sourceSize || sourceModified != header.sourceModified) {
+            std::cout << "INFO: Terrain tile file is out of date: " << tilePath << std::endl;
+            return false;
+        }
+    }
+
+    tileBounds.resize(static_cast<size_t>(header.tilesX) * header.tilesZ * 2);
+    file.seekg(static_cast<std::streamoff>(header.boundsOffset));
+    file.read(reinterpret_cast<char*>(tileBounds.data()), tileBounds.size() * sizeof(float));
+    if (!file) {
+        std::cerr << "WARNING: Terrain tile file is truncated: " << tilePath << std::endl;
+        return false;
+    }
+
+    path = tilePath;
+    opened = true;
+    return true;
+}
+
+bool TerrainTileFile::readTile(int tileX, int tileZ, std::vector<float>& heights) const {
+    if (!opened || tileX < 0 || tileZ < 0 || tileX >= header.tilesX || tileZ >= header.tilesZ) {
+        return false;
+    }
+    // A handle per read keeps concurrent readers independent
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    size_t sampleCount = tileSampleCount(header.tileSize);
+    uint64_t offset = header.tileOffset + static_cast<uint64_t>(tileZ * header.tilesX + tileX) * sampleCount * sizeof(uint16_t);
+    std::vector<uint16_t> samples(sampleCount);
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(reinterpret_cast<char*>(samples.data()), sampleCount * sizeof(uint16_t));
+    if (!file) {
+        std::cerr << "ERROR: Failed to read terrain tile (" << tileX << ", " << tileZ << ") from " << path << std::endl;
+        return false;
+    }
+
+    float scale = (header.maxHeight - header.minHeight) / 65535.0f;
+    heights.resize(sampleCount);
+    for (size_t i = 0; i < sampleCount; ++i) {
+        heights[i] = header.minHeight + samples[i] * scale;
+    }
+    return true;
+}
+
+void TerrainTileFile::getTileBounds(int tileX, int tileZ, float& minHeight, float& maxHeight) const {
+    size_t index = (static_cast<size_t>(tileZ) * header.tilesX + tileX) * 2;
+    minHeight = tileBounds[index];
+    maxHeight = tileBounds[index + 1];
+}
+
+// Getters
+bool TerrainTileFile::isOpen() const { return opened; }
+const TerrainTileHeader& TerrainTileFile::getHeader() const { return header; }
+int TerrainTileFile::getTileSize() const { return header.tileSize; }
+int TerrainTileFile::getTilesX() const { return header.tilesX; }
+int TerrainTileFile::getTilesZ() const { return header.tilesZ; }
@@ -0,0 +1,101 @@
+#ifndef TESSTERRAIN_H
+#define TESSTERRAIN_H
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "frustum.h"
+#include "heightPyramid.h"
+
+/**
+ * @class TessTerrain
+ * @brief Hardware tessellation renderer for a height grid (OpenGL 4.1 and later).
+ *
+ * The terrain is covered by a coarse grid of square patches, each sent as a single control
+ * point. The control shader sizes every patch edge from its projected length on screen and
+ * the evaluation shader displaces the generated vertices from a height texture, so the CPU
+ * only keeps the list of patches that survive frustum culling.
+ */
+class TessTerrain {
+public:
+    /**
+     * @brief Constructor. The shader stays unloaded on contexts without tessellation.
+     */
+    TessTerrain();
+
+    /**
+     * @brief Checks whether the current context can run the tessellation shaders (OpenGL 4.1).
+     */
+    static bool isSupported();
+
+    /**
+     * @brief Uploads the height texture and the patch buffer.
+     * @param heights Row-major height grid in world units.
+     * @param gridWidth Number of samples along X.
+     * @param gridHeight Number of samples along Z.
+     * @param spacing World distance between neighbouring samples.
+     * @param pyramid Min/max pyramid built from the same grid; must outlive this object.
+     * @return True if successful, false otherwise.
+     */
+    bool initialize(const float* heights, int gridWidth, int gridHeight,
+                    float spacing, const HeightPyramid& pyramid);
+
+    /**
+     * @brief Uploads the heights of an edited rectangle. Bounds come from the pyramid, which
+     *        the caller updates.
+     * @param heights Row-major heights of the rectangle, width * height values.
+     * @param x0 First column.
+     * @param z0 First row.
+     * @param width Number of columns.
+     * @param height Number of rows.
+     */
+    void updateHeights(const float* heights, int x0, int z0, int width, int height);
+
+    /**
+     * @brief Culls patches and draws the rest. The shader must already be in use with the
+     *        model, view, projection and lighting uniforms set.
+     * @param model Model matrix.
+     * @param view View matrix.
+     * @param projection Projection matrix.
+     * @param localCamera Camera position in terrain (model) space.
+     */
+    void render(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection,
+                const glm::vec3& localCamera);
+
+    /**
+     * @brief Cleans up OpenGL resources.
+     */
+    void cleanup();
+
+    /**
+     * @brief Sets the triangle edge length, in pixels on screen, the tessellator aims for.
+     * @param pixels Target edge length.
+     */
+    void setEdgePixels(float pixels);
+
+    // Getters
+    Shader& getShader();
+    bool isInitialized() const;
+    size_t getVisiblePatchCount() const;
+
+private:
+    static const int patchCells = 64;        ///< Grid cells per patch side (power of two).
+
+    Shader tessShader;                       ///< Patch pass-through, tessellation stages and the shared terrain fragment shader.
+    GLuint patchVAO, patchVBO;               ///< Visible patch indices, refilled every frame.
+    GLuint heightTexture;                    ///< Height grid as a single-channel float texture.
+
+    const HeightPyramid* pyramid;            ///< Patch bounds source.
+    int gridWidth, gridHeight;               ///< Dimensions of the height grid.
+    float spacing;                           ///< World distance between samples.
+    int patchLevel;                          ///< Pyramid level whose blocks match the patches.
+    int patchesX, patchesZ;                  ///< Patch counts.
+    float edgePixels;                        ///< Target projected triangle edge length.
+    float maxTessLevel;                      ///< Highest factor worth using: one step per grid cell.
+
+    Frustum frustum;                         ///< Frustum used to reject patches.
+    std::vector<glm::vec2> visiblePatches;   ///< Column and row of each patch drawn this frame.
+};
+
+#endif // TESSTERRAIN_H
@@ -0,0 +1,123 @@
+#include "vertexArena.h"
+#include <iostream>
+
+void checkOpenGLError(const std::string& location);
+
+// Constructor
+VertexArena::VertexArena()
+    : buffer(0), mapping(nullptr), slotBytes(0) {}
+
+bool VertexArena::create(size_t bytesPerSlot, int slotCount) {
+    destroy();
+    if (bytesPerSlot == 0 || slotCount <= 0) {
+        return false;
+    }
+    slotBytes = bytesPerSlot;
+    GLsizeiptr totalBytes = static_cast<GLsizeiptr>(slotBytes * slotCount);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (GLEW_ARB_buffer_storage) {
+        // Coherent writes become visible to draws issued after them without explicit flushes
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, totalBytes, nullptr, flags);
+        mapping = static_cast<unsigned char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalBytes, flags));
+        if (!mapping) {
+            std::cerr << "WARNING: Failed to map vertex arena persistently, falling back to buffer updates" << std::endl;
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        }
+    }
+    if (!mapping) {
+        glBufferData(GL_ARRAY_BUFFER, totalBytes, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    checkOpenGLError("VertexArena::create");
+
+    // Hand out low slots first
+    freeSlots.clear();
+    for (int slot = slotCount - 1; slot >= 0; --slot) {
+        freeSlots.push_back(slot);
+    }
+    return true;
+}
+
+void VertexArena::destroy() {
+    for (auto& entry : retired) {
+        glDeleteSync(entry.fence);
+    }
+    retired.clear();
+    releasedSlots.clear();
+    freeSlots.clear();
+    if (buffer) {
+        if (mapping) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    mapping = nullptr;
+    slotBytes = 0;
+}
+
+void VertexArena::recycleSlots() {
+    while (!retired.empty()) {
+        GLenum status = glClientWaitSync(retired.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return;
+        }
+        glDeleteSync(retired.front().fence);
+        freeSlots.insert(freeSlots.end(), retired.front().slots.begin(), retired.front().slots.end());
+        retired.pop_front();
+    }
+}
+
+int VertexArena::acquireSlot() {
+    if (freeSlots.empty()) {
+        recycleSlots();
+    }
+    if (freeSlots.empty()) {
+        return -1;
+    }
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+}
+
+void VertexArena::releaseSlot(int slot) {
+    releasedSlots.push_back(slot);
+}
+
+void VertexArena::cancelSlot(int slot) {
+    freeSlots.push_back(slot);
+}
+
+void VertexArena::writeSlot(int slot, const void* data, size_t bytes) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(slot * slotBytes), static_cast<GLsizeiptr>(bytes), data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexArena::endFrame() {
+    if (releasedSlots.empty()) {
+        return;
+    }
+    RetiredSlots entry;
+    entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    entry.slots.swap(releasedSlots);
+    retired.push_back(std::move(entry));
+}
+
+void* VertexArena::getSlotPointer(int slot) const {
+    return mapping ? mapping + slot * slotBytes : nullptr;
+}
+
+// Getters
+GLuint VertexArena::getBuffer() const { return buffer; }
+bool VertexArena::isPersistent() const { return mapping != nullptr; }
+size_t VertexArena::getSlotBytes() const { return slotBytes; }
+int VertexArena::getFreeSlotCount() const { return static_cast<int>(freeSlots.size()); }
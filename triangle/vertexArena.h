@@ -0,0 +1,107 @@
+#ifndef VERTEXARENA_H
+#define VERTEXARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <GL/glew.h>
+
+/**
+ * @class VertexArena
+ * @brief One vertex buffer split into equal slots that are handed out and recycled.
+ *
+ * With ARB_buffer_storage the buffer is persistently and coherently mapped, so any thread
+ * can write a slot's vertices straight into GPU-visible memory through getSlotPointer() and
+ * the render thread never copies or blocks. Without it (e.g. OpenGL 4.1 on macOS) slots are
+ * filled with writeSlot() instead. Released slots are only reused once a fence shows the GPU
+ * has finished the frames that may still draw from them. All calls except writing through a
+ * slot pointer belong on the render thread.
+ */
+class VertexArena {
+public:
+    /**
+     * @brief Constructor.
+     */
+    VertexArena();
+
+    /**
+     * @brief Destructor. GL resources must be released with destroy() first.
+     */
+    ~VertexArena() = default;
+
+    VertexArena(const VertexArena&) = delete;
+    VertexArena& operator=(const VertexArena&) = delete;
+
+    /**
+     * @brief Allocates the buffer, mapping it persistently when the driver supports it.
+     * @param slotBytes Size of one slot in bytes.
+     * @param slotCount Number of slots.
+     * @return True if successful, false otherwise.
+     */
+    bool create(size_t slotBytes, int slotCount);
+
+    /**
+     * @brief Unmaps and deletes the buffer and any pending fences.
+     */
+    void destroy();
+
+    /**
+     * @brief Takes a free slot, first recycling released slots whose fences have passed.
+     * @return Slot index, or -1 if every slot is in use.
+     */
+    int acquireSlot();
+
+    /**
+     * @brief Returns a slot that may have been drawn from; it is reused after the current
+     *        frame's fence has passed.
+     */
+    void releaseSlot(int slot);
+
+    /**
+     * @brief Returns a slot that was never drawn from, making it free immediately.
+     */
+    void cancelSlot(int slot);
+
+    /**
+     * @brief Copies data into a slot with glBufferSubData. Used when the arena is not mapped.
+     */
+    void writeSlot(int slot, const void* data, size_t bytes);
+
+    /**
+     * @brief Marks the end of the draws of a frame by inserting a fence.
+     */
+    void endFrame();
+
+    /**
+     * @brief Mapped memory of a slot, safe to write from any thread while the slot is held.
+     * @return Pointer to the slot, or nullptr if the arena is not persistently mapped.
+     */
+    void* getSlotPointer(int slot) const;
+
+    // Getters
+    GLuint getBuffer() const;
+    bool isPersistent() const;
+    size_t getSlotBytes() const;
+    int getFreeSlotCount() const;
+
+private:
+    /// Slots released before a fence, waiting for the GPU to pass it.
+    struct RetiredSlots {
+        GLsync fence;
+        std::vector<int> slots;
+    };
+
+    GLuint buffer;
+    unsigned char* mapping;              ///< Persistent mapping, or nullptr.
+    size_t slotBytes;
+    std::vector<int> freeSlots;
+    std::vector<int> releasedSlots;      ///< Released since the last endFrame().
+    std::deque<RetiredSlots> retired;    ///< Oldest fence first.
+
+    /**
+     * @brief Moves slots whose fences have signalled back to the free list.
+     */
+    void recycleSlots();
+};
+
+#endif // VERTEXARENA_H